@@ -29,6 +29,21 @@
 /* Define as 1 to use hashing */
 #define HASHING 1
 
+/* Define as 1 to undo moves from a log instead of copying the board */
+#define UNDO_LOG 1
+
+/* Define as 1 to trust 64 bit hash values and store no positions */
+#define HASH_SIGNATURES 0
+
+/* Define as 1 to keep read results in cache line sized buckets */
+#define HASH_BUCKETS 0
+
+/* Define as 1 to give every thread its own engine state */
+#define ENGINE_THREADS 0
+
+/* Define as 1 to match patterns with a decision tree, or 2 to check it */
+#define TREE_MATCHER 0
+
 /* Define if the preprocessor recognizes __FUNCTION__ */
 #undef HAVE___FUNCTION__
 
@@ -26,13 +26,7 @@ static void ensureStart()
 static void hash_alloc(int memory)
 {
 #if HASHING
-  {
-    float nodes;
-    
-    nodes = (float)( (memory * 1024 * 1024)
-	     / (sizeof(Hashnode) + sizeof(Read_result) * 1.4));
-    movehash = hashtable_new((int) (1.5 * nodes), (int)(nodes), (int)(nodes * 1.4) );
-  } 
+  movehash = hashtable_allocate(memory);
 #endif
 }
 
@@ -73,6 +67,20 @@ Java_io_github_karino2_goengine_gnugo2_GnuGo2Native_setDepth (
   depth = d;  
 }
 
+/*
+  reading nodes and ms for each genMove, 0 means no limit.
+*/
+void
+Java_io_github_karino2_goengine_gnugo2_GnuGo2Native_setMoveBudget (
+	JNIEnv*	env,
+	jclass clasz,
+	jint nodes,
+	jint msec
+	)
+{
+  set_move_budget(nodes, msec);
+}
+
 
 void
 Java_io_github_karino2_goengine_gnugo2_GnuGo2Native_clearBoard (
@@ -40,6 +40,41 @@
 static int active_defense(int m, int n, int color);
 
 
+/* A candidate move of defender() or attacker(), and the readings
+ * about it, which are done by read_candidate().
+ */
+
+struct candidate {
+  int m, n;            /* origin of the string */
+  int ti, tj;          /* the move */
+  int color;           /* color of the move */
+  int active_color;    /* color for active_defense(), EMPTY if not needed */
+  int snapi, snapj;    /* move to check for snapback(), -1 if none */
+  int snap_color;      /* color of that move */
+  int active;          /* result of active_defense() */
+  int safe;            /* result of confirm_safety() */
+  int snapback;        /* result of snapback() */
+};
+
+
+/* Do the readings for the candidate[k]. This is a reading job for
+ * parallel_reading() and must not change anything but candidate[k].
+ */
+
+static void
+read_candidate(int k, void *data)
+{
+  struct candidate *c = (struct candidate *) data + k;
+
+  if (c->active_color != EMPTY)
+    c->active = active_defense(c->m, c->n, c->active_color);
+  c->safe = confirm_safety(c->ti, c->tj, c->color, worm[c->m][c->n].value);
+  c->snapback = (c->snapi != -1
+		 && snapback(c->snapi, c->snapj, c->snapi, c->snapj,
+			     c->snap_color));
+}
+
+
 /* defender() looks for strings of my color which you can kill and
  * recommends defending them.
  */
@@ -51,11 +86,16 @@ defender (int *i, int *j, int *val, int *equal_moves, int color,
   int m, n, tval;
   int found_one=0;
   int ti, tj;
+  struct candidate candidate[MAX_BOARD*MAX_BOARD];
+  int num_candidates=0;
+  int done;
+  int k;
   
   TRACE("Defender is THINKING for %s!\n", color==WHITE ? "white" : "black");
   
   for (m=0;m<board_size;m++) 
     for (n=0;n<board_size;n++) {
+      struct candidate *c;
 
       if (p[m][n] != color                 /* our piece */
 	  || worm[m][n].origini != m       /* origin of ... */
@@ -68,74 +108,101 @@ defender (int *i, int *j, int *val, int *equal_moves, int color,
 	continue;
 
       /* Considered move */
-      ti = worm[m][n].defendi;
-      tj = worm[m][n].defendj;
-	  
-      /* bonus if the string has fewer liberties, since capturing
-       * leaves less aji
-       */
-      tval = worm[m][n].value + 3 - 2*worm[m][n].liberties;
-
-      /* penalty if the string is nearly surrounded. */
-      if (dragon[m][n].escape_route <= 4)
-	tval -= 2;
-      if (dragon[m][n].escape_route <= 2)
-	tval -= 2;
-
-      /* Severe penalty if we are passively running away inside
-       * enemy territory.
-       */
-      if ((terri_color(ti, tj) == OTHER_COLOR(color))
-	  && !active_defense(m, n, color)) {
-	tval -= 15;
-	/* And still more if the group is also classified as dead. */
-	if (dragon[m][n].status == DEAD)
-	  tval = tval/2;
+      c = &candidate[num_candidates++];
+      c->m = m;
+      c->n = n;
+      c->ti = worm[m][n].defendi;
+      c->tj = worm[m][n].defendj;
+      c->color = color;
+
+      /* Are we running away inside enemy territory? */
+      if (terri_color(c->ti, c->tj) == OTHER_COLOR(color))
+	c->active_color = color;
+      else
+	c->active_color = EMPTY;
+
+      if (worm[m][n].size==1) {
+	c->snapi = worm[m][n].attacki;
+	c->snapj = worm[m][n].attackj;
+	c->snap_color = OTHER_COLOR(color);
       }
+      else
+	c->snapi = -1;
+    }
+
+  /* The readings may be done by several threads (see threads.c). */
+  done = parallel_reading(num_candidates, read_candidate, candidate);
+
+  for (k=0; k<num_candidates; k++) {
+    struct candidate *c = &candidate[k];
+    m = c->m;
+    n = c->n;
+    ti = c->ti;
+    tj = c->tj;
+    if (!done)
+      read_candidate(k, candidate);
+
+    /* bonus if the string has fewer liberties, since capturing
+     * leaves less aji
+     */
+    tval = worm[m][n].value + 3 - 2*worm[m][n].liberties;
+
+    /* penalty if the string is nearly surrounded. */
+    if (dragon[m][n].escape_route <= 4)
+      tval -= 2;
+    if (dragon[m][n].escape_route <= 2)
+      tval -= 2;
+
+    /* Severe penalty if we are passively running away inside
+     * enemy territory.
+     */
+    if ((c->active_color != EMPTY) && !c->active) {
+      tval -= 15;
+      /* And still more if the group is also classified as dead. */
+      if (dragon[m][n].status == DEAD)
+	tval = tval/2;
+    }
 	  
-      if (tval<0)
-	tval=0;
+    if (tval<0)
+      tval=0;
 	  
-      if (!confirm_safety(ti, tj, color, worm[m][n].value))
-	tval=0;
-
-      TRACE("Defender found %m to defend %m for value %d\n", 
-	    ti, tj, m, n, tval);
-      if ((worm[m][n].size==1) 
-	  && (snapback(worm[m][n].attacki, worm[m][n].attackj, 
-		       worm[m][n].attacki, worm[m][n].attackj,
-		       OTHER_COLOR(color)))) {
-	TRACE("But it is a snapback\n");
-      }
-      else {
-	if ((tval >= *val)
-	    && (ti != shapei || tj != shapej)
-	    && (shapei != -1)) {
-	  /* Check if shape seer's move works too. To avoid horizon effect
-	   * we must increase depth and backfill_depth so that the reading
-	   * code is at the same depth as when we ran make_worms().
-	   */
-	  depth++;
-	  backfill_depth++;
-	  fourlib_depth++;
-	  ko_depth++;
-	  if (does_defend(shapei, shapej, m, n)) {
-	    TRACE("But %m does too\n", shapei, shapej);
-	    change_defense(m, n, shapei, shapej);
-	  }
-	  depth--;
-	  backfill_depth--;
-	  fourlib_depth--;
-	  ko_depth--;
-	}
-	move_considered(worm[m][n].defendi, worm[m][n].defendj, tval);
-	if (BETTER_MOVE(tval, *val, *equal_moves)) {
-	  *i=worm[m][n].defendi;
-	  *j=worm[m][n].defendj;
-	  found_one=1;
+    if (!c->safe)
+      tval=0;
+
+    TRACE("Defender found %m to defend %m for value %d\n", 
+	  ti, tj, m, n, tval);
+    if (c->snapback) {
+      TRACE("But it is a snapback\n");
+    }
+    else {
+      if ((tval >= *val)
+	  && (ti != shapei || tj != shapej)
+	  && (shapei != -1)) {
+	/* Check if shape seer's move works too. To avoid horizon effect
+	 * we must increase depth and backfill_depth so that the reading
+	 * code is at the same depth as when we ran make_worms().
+	 */
+	depth++;
+	backfill_depth++;
+	fourlib_depth++;
+	ko_depth++;
+	if (does_defend(shapei, shapej, m, n)) {
+	  TRACE("But %m does too\n", shapei, shapej);
+	  change_defense(m, n, shapei, shapej);
 	}
+	depth--;
+	backfill_depth--;
+	fourlib_depth--;
+	ko_depth--;
+      }
+      move_considered(worm[m][n].defendi, worm[m][n].defendj, tval);
+      if (BETTER_MOVE(tval, *val, *equal_moves)) {
+	*i=worm[m][n].defendi;
+	*j=worm[m][n].defendj;
+	found_one=1;
       }
     }
+  }
 
   return found_one;
 }
@@ -153,11 +220,16 @@ attacker (int *i, int *j, int *val, int *equal_moves, int color,
   int other = OTHER_COLOR(color);  /* color of the pieces we are attacking */
   int found_one=0;
   int ti, tj, acode, dcode;
+  struct candidate candidate[MAX_BOARD*MAX_BOARD];
+  int num_candidates=0;
+  int done;
+  int k;
   
   TRACE("Attacker is THINKING for %s!\n", color==WHITE ? "white" : "black");
 
   for (m=0; m<board_size; m++) 
     for (n=0; n<board_size; n++) {
+      struct candidate *c;
 
       if (p[m][n] != other                 /* your piece */
 	  || worm[m][n].origini != m       /* origin of ... */
@@ -171,79 +243,109 @@ attacker (int *i, int *j, int *val, int *equal_moves, int color,
 	continue;
 
       /* Considered move */
-      ti = worm[m][n].attacki;
-      tj = worm[m][n].attackj;
-      acode=worm[m][n].attack_code;
-      dcode=worm[m][n].defend_code;
-	  
-      /* bonus if the string has fewer liberties, since capturing
-       * leaves less aji.
-       */
-      tval = worm[m][n].value + 3 - 2*worm[m][n].liberties;
-
-      /* penalty if the string is nearly surrounded. */
-      if (dragon[m][n].escape_route <= 4)
-	tval -= 2;
-      if (dragon[m][n].escape_route <= 2)
-	tval -= 2;
-
-      /* Severe penalty if enemy would be passively running away
-       * inside our territory.
-       */
-      if ((terri_color(worm[m][n].defendi, worm[m][n].defendj) == color)
-	  && !active_defense(m, n, other)) {
-	tval -= 15;
-
-	/* And still more if the group is also classified as dead. */
-	if (dragon[m][n].status == DEAD)
-	  tval = tval/2;
+      c = &candidate[num_candidates++];
+      c->m = m;
+      c->n = n;
+      c->ti = worm[m][n].attacki;
+      c->tj = worm[m][n].attackj;
+      c->color = color;
+
+      /* Would the enemy be running away inside our territory? */
+      if (terri_color(worm[m][n].defendi, worm[m][n].defendj) == color)
+	c->active_color = other;
+      else
+	c->active_color = EMPTY;
+
+      if (worm[m][n].size==1) {
+	c->snapi = c->ti;
+	c->snapj = c->tj;
+	c->snap_color = color;
       }
+      else
+	c->snapi = -1;
+    }
+
+  /* The readings may be done by several threads (see threads.c). */
+  done = parallel_reading(num_candidates, read_candidate, candidate);
+
+  for (k=0; k<num_candidates; k++) {
+    struct candidate *c = &candidate[k];
+    m = c->m;
+    n = c->n;
+    ti = c->ti;
+    tj = c->tj;
+    acode=worm[m][n].attack_code;
+    dcode=worm[m][n].defend_code;
+    if (!done)
+      read_candidate(k, candidate);
 	  
-      if (acode != 1) tval -= 10;
-      if (dcode != 1) tval -= 10;
-
-      if (tval<0)
-	tval=0;
-
-      if (!confirm_safety(ti, tj, color, worm[m][n].value))
-	tval=0;
-
-      TRACE("Attacker found %m to capture %m for value %d\n", 
-	    ti, tj, m, n, tval);
-      if ((worm[m][n].size==1) && snapback(ti, tj, ti, tj, color)) 
-	TRACE("But it is a snapback\n");
-      else {
-	if ((tval >= *val)
-	    && (ti != shapei || tj != shapej)
-	    && (shapei != -1)) {
-
-	  /* Check if shape seer's move works too. To avoid horizon effect
-	   * we must increase depth and backfill_depth so that the reading
-	   * code is at the same depth as when we ran make_worms().
-	   */
-	  depth++;
-	  backfill_depth++;
-	  fourlib_depth++;
-	  ko_depth++;
-	  if (does_attack(shapei, shapej, m, n)) {
-	    TRACE("But %m does too\n", shapei, shapej);
-	    change_attack(m, n, shapei, shapej);
-	  }
-	  depth--;
-	  backfill_depth--;
-	  fourlib_depth--;
-	  ko_depth--;
+    /* bonus if the string has fewer liberties, since capturing
+     * leaves less aji.
+     */
+    tval = worm[m][n].value + 3 - 2*worm[m][n].liberties;
+
+    /* penalty if the string is nearly surrounded. */
+    if (dragon[m][n].escape_route <= 4)
+      tval -= 2;
+    if (dragon[m][n].escape_route <= 2)
+      tval -= 2;
+
+    /* Severe penalty if enemy would be passively running away
+     * inside our territory.
+     */
+    if ((c->active_color != EMPTY) && !c->active) {
+      tval -= 15;
+
+      /* And still more if the group is also classified as dead. */
+      if (dragon[m][n].status == DEAD)
+	tval = tval/2;
+    }
+	  
+    if (acode != 1) tval -= 10;
+    if (dcode != 1) tval -= 10;
+
+    if (tval<0)
+      tval=0;
+
+    if (!c->safe)
+      tval=0;
+
+    TRACE("Attacker found %m to capture %m for value %d\n", 
+	  ti, tj, m, n, tval);
+    if (c->snapback) 
+      TRACE("But it is a snapback\n");
+    else {
+      if ((tval >= *val)
+	  && (ti != shapei || tj != shapej)
+	  && (shapei != -1)) {
+
+	/* Check if shape seer's move works too. To avoid horizon effect
+	 * we must increase depth and backfill_depth so that the reading
+	 * code is at the same depth as when we ran make_worms().
+	 */
+	depth++;
+	backfill_depth++;
+	fourlib_depth++;
+	ko_depth++;
+	if (does_attack(shapei, shapej, m, n)) {
+	  TRACE("But %m does too\n", shapei, shapej);
+	  change_attack(m, n, shapei, shapej);
 	}
+	depth--;
+	backfill_depth--;
+	fourlib_depth--;
+	ko_depth--;
+      }
 	  
-	move_considered(worm[m][n].attacki, worm[m][n].attackj, tval);
+      move_considered(worm[m][n].attacki, worm[m][n].attackj, tval);
 	    
-	if (BETTER_MOVE(tval, *val, *equal_moves)) {
-	  *i=worm[m][n].attacki;
-	  *j=worm[m][n].attackj;
-	  found_one=1;
-	}
+      if (BETTER_MOVE(tval, *val, *equal_moves)) {
+	*i=worm[m][n].attacki;
+	*j=worm[m][n].attackj;
+	found_one=1;
       }
     }
+  }
 
   return found_one;
 }
@@ -0,0 +1,278 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *\
+ * This is GNU GO, a Go program. Contact gnugo@gnu.org, or see   *
+ * http://www.gnu.org/software/gnugo/ for more information.      *
+ *                                                               *
+ * Copyright 1999 and 2000 by the Free Software Foundation.      *
+ *                                                               *
+ * This program is free software; you can redistribute it and/or *
+ * modify it under the terms of the GNU General Public License   *
+ * as published by the Free Software Foundation - version 2.     *
+ *                                                               *
+ * This program is distributed in the hope that it will be       *
+ * useful, but WITHOUT ANY WARRANTY; without even the implied    *
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR       *
+ * PURPOSE.  See the GNU General Public License in file COPYING  *
+ * for more details.                                             *
+ *                                                               *
+ * You should have received a copy of the GNU General Public     *
+ * License along with this program; if not, write to the Free    *
+ * Software Foundation, Inc., 59 Temple Place - Suite 330,       *
+ * Boston, MA 02111, USA                                         *
+\* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/*
+ * Bitboards.
+ *
+ * A Bitboard is a set of intersections with one word for each row of
+ * the board, bit j of row i standing for (i, j). Operations on whole
+ * sets, like taking the neighbors of a string or flood filling a
+ * region, work on a row at a time, that is on up to 32 intersections
+ * at once. The loops are simple enough for the compiler to vectorize.
+ *
+ * strings.c keeps a Bitboard of the stones of each color and of the
+ * liberties of each string. See the Texinfo documentation
+ * (Overview/Data Structures) for more information.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "liberty.h"
+
+#if MAX_BOARD > 32
+#error "A Bitboard row must fit in 32 bits."
+#endif
+
+
+/* The bits of a row which are on the board. */
+#define ROW_MASK  ((unsigned int) ((1UL << board_size) - 1))
+
+
+/* Empty the set. */
+
+void
+bitboard_clear(Bitboard *b)
+{
+  memset(b, 0, sizeof(*b));
+}
+
+
+/* Set b to all intersections on the board. */
+
+void
+bitboard_fill(Bitboard *b)
+{
+  int i;
+
+  bitboard_clear(b);
+  for (i = 0; i < board_size; i++)
+    b->row[i] = ROW_MASK;
+}
+
+
+/* a = a | b */
+
+void
+bitboard_or(Bitboard *a, const Bitboard *b)
+{
+  int i;
+
+  for (i = 0; i < board_size; i++)
+    a->row[i] |= b->row[i];
+}
+
+
+/* a = a & b */
+
+void
+bitboard_and(Bitboard *a, const Bitboard *b)
+{
+  int i;
+
+  for (i = 0; i < board_size; i++)
+    a->row[i] &= b->row[i];
+}
+
+
+/* a = a & ~b */
+
+void
+bitboard_andnot(Bitboard *a, const Bitboard *b)
+{
+  int i;
+
+  for (i = 0; i < board_size; i++)
+    a->row[i] &= ~b->row[i];
+}
+
+
+/*
+ * Set out to the intersections of in and their neighbors on the
+ * board. out and in may be the same.
+ */
+
+void
+bitboard_dilate(Bitboard *out, const Bitboard *in)
+{
+  unsigned int above = 0;
+  unsigned int this;
+  int i;
+
+  for (i = 0; i < board_size; i++) {
+    this = in->row[i];
+    out->row[i] = (this | (this << 1) | (this >> 1) | above
+		   | (i < board_size-1 ? in->row[i+1] : 0)) & ROW_MASK;
+    above = this;
+  }
+}
+
+
+/*
+ * Set out to the intersections next to in but not in it, e.g. the
+ * liberties and the neighboring strings of a string.
+ */
+
+void
+bitboard_neighbors(Bitboard *out, const Bitboard *in)
+{
+  Bitboard b;
+
+  bitboard_dilate(&b, in);
+  bitboard_andnot(&b, in);
+  *out = b;
+}
+
+
+/*
+ * Set out to the part of region which is connected to (i, j), e.g.
+ * the string at (i, j) if region is the stones of its color. (i, j)
+ * must be in region.
+ *
+ * The set is grown one row at a time, going down and then up the
+ * board, until it no longer changes. Within a row it is grown by
+ * shifting until it fills the runs of region it touches.
+ */
+
+void
+bitboard_flood(Bitboard *out, int i, int j, const Bitboard *region)
+{
+  unsigned int x, y;
+  int changed;
+  int r;
+
+  bitboard_clear(out);
+  out->row[i] = BB_MASK(j);
+
+  do {
+    changed = 0;
+    for (r = 0; r < board_size; r++) {
+      x = out->row[r];
+      if (r > 0)
+	x |= out->row[r-1];
+      x &= region->row[r];
+      do {
+	y = x;
+	x |= ((x << 1) | (x >> 1)) & region->row[r];
+      } while (x != y);
+      if (x != out->row[r]) {
+	out->row[r] = x;
+	changed = 1;
+      }
+    }
+    for (r = board_size-2; r >= 0; r--) {
+      x = (out->row[r] | out->row[r+1]) & region->row[r];
+      do {
+	y = x;
+	x |= ((x << 1) | (x >> 1)) & region->row[r];
+      } while (x != y);
+      if (x != out->row[r]) {
+	out->row[r] = x;
+	changed = 1;
+      }
+    }
+  } while (changed);
+}
+
+
+/* Number of bits set in a row. */
+
+#ifdef __GNUC__
+#define popcount(x)  __builtin_popcount(x)
+#else
+static int
+popcount(unsigned int x)
+{
+  x = x - ((x >> 1) & 0x55555555U);
+  x = (x & 0x33333333U) + ((x >> 2) & 0x33333333U);
+  x = (x + (x >> 4)) & 0x0f0f0f0fU;
+  return (int) ((x * 0x01010101U) >> 24);
+}
+#endif
+
+
+/* Number of intersections in the set. */
+
+int
+bitboard_count(const Bitboard *b)
+{
+  int count = 0;
+  int i;
+
+  for (i = 0; i < board_size; i++)
+    if (b->row[i])
+      count += popcount(b->row[i]);
+
+  return count;
+}
+
+
+/* Number of the lowest bit set in a nonzero row. */
+
+#ifdef __GNUC__
+#define lowest_bit(x)  __builtin_ctz(x)
+#else
+static int
+lowest_bit(unsigned int x)
+{
+  int j = 0;
+
+  while (!(x & 1)) {
+    x >>= 1;
+    j++;
+  }
+  return j;
+}
+#endif
+
+
+/*
+ * Store up to max intersections of the set in pi[] and pj[], row by
+ * row, and return how many were stored. The first one is the origin
+ * of the set in the sense of find_origin().
+ */
+
+int
+bitboard_points(const Bitboard *b, int max, int pi[], int pj[])
+{
+  unsigned int x;
+  int n = 0;
+  int i;
+
+  for (i = 0; i < board_size && n < max; i++)
+    for (x = b->row[i]; x && n < max; x &= x - 1) {
+      pi[n] = i;
+      pj[n] = lowest_bit(x);
+      n++;
+    }
+
+  return n;
+}
+
+
+/*
+ * Local Variables:
+ * tab-width: 8
+ * c-basic-offset: 2
+ * End:
+ */
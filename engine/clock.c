@@ -0,0 +1,196 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *\
+ * This is GNU GO, a Go program. Contact gnugo@gnu.org, or see   *
+ * http://www.gnu.org/software/gnugo/ for more information.      *
+ *                                                               *
+ * Copyright 1999 and 2000 by the Free Software Foundation.      *
+ *                                                               *
+ * This program is free software; you can redistribute it and/or *
+ * modify it under the terms of the GNU General Public License   *
+ * as published by the Free Software Foundation - version 2.     *
+ *                                                               *
+ * This program is distributed in the hope that it will be       *
+ * useful, but WITHOUT ANY WARRANTY; without even the implied    *
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR       *
+ * PURPOSE.  See the GNU General Public License in file COPYING  *
+ * for more details.                                             *
+ *                                                               *
+ * You should have received a copy of the GNU General Public     *
+ * License along with this program; if not, write to the Free    *
+ * Software Foundation, Inc., 59 Temple Place - Suite 330,       *
+ * Boston, MA 02111, USA                                         *
+\* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/*
+ * The clock.
+ *
+ * Under time control, as set by the GTP commands time_settings and
+ * kgs-time_settings, genmove() asks clock_time_budget() how many
+ * milliseconds it may read (see start_read_budget() in reading.c).
+ * The main time left is divided by the number of moves we still
+ * expect to play, and in byo-yomi the time of the period by the
+ * stones left in it. Only part of that share is given, since a move
+ * takes some time after the reading has been cut off, and the
+ * controller needs some time too.
+ *
+ * The time left is updated by the GTP command time_left, and between
+ * those by the time genmove() itself takes, in clock_spent().
+ *
+ * Most moves take much less than their share. To use the time, the
+ * reading depths are raised by one, up to CLOCK_MAX_DEEPER, after a
+ * move which took less than a quarter of what it was given, and
+ * lowered by one again after a move which took all of it (see
+ * clock_depth_offset()).
+ */
+
+#include <stdio.h>
+
+#include "liberty.h"
+
+
+#define CLOCK_SHARE      0.6   /* part of its share given to a move */
+#define CLOCK_MARGIN     0.1   /* seconds kept back from each move */
+#define CLOCK_MIN_MOVES  10    /* never expect fewer moves than this */
+#define CLOCK_MAX_DEEPER 4     /* most the depths are raised by */
+
+static int    clock_on = 0;
+static double main_time;        /* seconds */
+static double byo_yomi_time;    /* seconds for each period */
+static int    byo_yomi_stones;  /* moves in each period, 0 for none */
+
+static struct {
+  double time_left;             /* seconds left in main time or period */
+  int    stones_left;           /* moves left in the period, 0 in main time */
+  int    budget;                /* ms given to the last move, 0 for none */
+  int    deeper;                /* raise of the depths */
+} clocks[2];                    /* clocks[color == BLACK] */
+
+
+/* Set the time control and reset the clocks. With main_secs < 0
+ * there is no time limit. byo_stones is 0 for absolute time.
+ */
+
+void
+clock_settings(int main_secs, int byo_secs, int byo_stones)
+{
+  int k;
+
+  clock_on = (main_secs >= 0);
+  main_time = main_secs;
+  byo_yomi_time = byo_secs;
+  byo_yomi_stones = byo_stones;
+  for (k = 0; k < 2; k++) {
+    clocks[k].time_left = main_time;
+    clocks[k].stones_left = 0;
+    clocks[k].budget = 0;
+    clocks[k].deeper = 0;
+    if (main_time <= 0 && byo_yomi_stones > 0) {
+      clocks[k].time_left = byo_yomi_time;
+      clocks[k].stones_left = byo_yomi_stones;
+    }
+  }
+}
+
+
+/* The time left for color, in main time if stones is 0. */
+
+void
+clock_time_left(int color, int seconds, int stones)
+{
+  clocks[color == BLACK].time_left = seconds;
+  clocks[color == BLACK].stones_left = stones;
+}
+
+
+/* Charge the seconds genmove() took for a move of color. */
+
+void
+clock_spent(int color, double seconds)
+{
+  int k = (color == BLACK);
+
+  if (!clock_on)
+    return;
+
+  if (clocks[k].budget > 0) {
+    if (1000 * seconds < clocks[k].budget / 4) {
+      if (clocks[k].deeper < CLOCK_MAX_DEEPER)
+	clocks[k].deeper++;
+    }
+    else if (1000 * seconds >= clocks[k].budget && clocks[k].deeper > 0)
+      clocks[k].deeper--;
+  }
+
+  clocks[k].time_left -= seconds;
+  if (clocks[k].stones_left > 0) {
+    if (--clocks[k].stones_left == 0) {
+      clocks[k].time_left = byo_yomi_time;
+      clocks[k].stones_left = byo_yomi_stones;
+    }
+  }
+  else if (clocks[k].time_left <= 0 && byo_yomi_stones > 0) {
+    clocks[k].time_left = byo_yomi_time;
+    clocks[k].stones_left = byo_yomi_stones;
+  }
+  if (clocks[k].time_left < 0)
+    clocks[k].time_left = 0;
+}
+
+
+/* Return the milliseconds color may read for the next move, or 0 if
+ * there is no time limit.
+ */
+
+int
+clock_time_budget(int color)
+{
+  int k = (color == BLACK);
+  double share;
+  int moves;
+
+  if (!clock_on || (main_time <= 0 && byo_yomi_stones == 0)) {
+    clocks[k].budget = 0;
+    return 0;
+  }
+
+  if (clocks[k].stones_left > 0)
+    share = clocks[k].time_left / clocks[k].stones_left;
+  else {
+    moves = (board_size * board_size / 2 - movenum) / 2;
+    if (moves < CLOCK_MIN_MOVES)
+      moves = CLOCK_MIN_MOVES;
+    share = clocks[k].time_left / moves;
+
+    /* The byo-yomi is still to come. */
+    if (byo_yomi_stones > 0)
+      share += byo_yomi_time / byo_yomi_stones;
+  }
+
+  share = CLOCK_SHARE * share - CLOCK_MARGIN;
+  if (share < 0.001)
+    clocks[k].budget = 1;
+  else
+    clocks[k].budget = (int) (1000 * share);
+  return clocks[k].budget;
+}
+
+
+/* Return how much to raise the reading depths for the next move of
+ * color, 0 if there is no time limit.
+ */
+
+int
+clock_depth_offset(int color)
+{
+  if (!clock_on)
+    return 0;
+  return clocks[color == BLACK].deeper;
+}
+
+
+/*
+ * Local Variables:
+ * tab-width: 8
+ * c-basic-offset: 2
+ * End:
+ */
@@ -0,0 +1,344 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *\
+ * This is GNU GO, a Go program. Contact gnugo@gnu.org, or see   *
+ * http://www.gnu.org/software/gnugo/ for more information.      *
+ *                                                               *
+ * Copyright 1999 and 2000 by the Free Software Foundation.      *
+ *                                                               *
+ * This program is free software; you can redistribute it and/or *
+ * modify it under the terms of the GNU General Public License   *
+ * as published by the Free Software Foundation - version 2.     *
+ *                                                               *
+ * This program is distributed in the hope that it will be       *
+ * useful, but WITHOUT ANY WARRANTY; without even the implied    *
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR       *
+ * PURPOSE.  See the GNU General Public License in file COPYING  *
+ * for more details.                                             *
+ *                                                               *
+ * You should have received a copy of the GNU General Public     *
+ * License along with this program; if not, write to the Free    *
+ * Software Foundation, Inc., 59 Temple Place - Suite 330,       *
+ * Boston, MA 02111, USA                                         *
+\* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/*
+ * Engine contexts let one process play several games.
+ *
+ * The engine works on its ENGINE_LOCAL variables (the board, the
+ * worms and dragons, the reading stack, the caches and so on).
+ * Without any context these are simply the global state of the
+ * program, which is how the interfaces have always used the engine.
+ *
+ * An engine context holds the part of this state which lasts from
+ * one move to the next: the position, the move number, the captures,
+ * the reading depths, the fuseki state, a random number generator
+ * and a hash table, with the hash flags adapted to it. The hash
+ * table is its own, unless it shares the one of another engine (see
+ * engine_context_copy()).
+ * engine_context_enter() loads a context into the engine of the
+ * calling thread and engine_context_leave() saves it back.
+ * Everything else is computed again by genmove() anyway.
+ *
+ * Configured with ENGINE_THREADS every thread has its own engine, so
+ * different threads can work on different contexts at the same time.
+ * A context must only be entered by one thread at a time.  Options
+ * like verbose are shared by all engines, and so are the
+ * patterns: hash_init() and the first genmove() should happen before
+ * other threads start, and contexts read at the same time should use
+ * the same board size, since the patterns are fitted to the board
+ * size of the last genmove().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "liberty.h"
+
+
+struct engine_context {
+  board_t              p[MAX_BOARD][MAX_BOARD];
+  int                  ko_i;
+  int                  ko_j;
+  int                  board_size;
+  int                  movenum;
+  int                  black_captured;
+  int                  white_captured;
+  int                  last_move_i;
+  int                  last_move_j;
+  int                  color_has_played;
+  int                  depth;
+  int                  backfill_depth;
+  int                  fourlib_depth;
+  int                  ko_depth;
+  struct fuseki_state  fuseki;
+  struct hashflags_state hashflags;
+  unsigned int         random_state;
+  Hashtable          * movehash;
+  Hashtable          * own_movehash;   /* to free, or NULL */
+};
+
+
+/* The context last entered by this thread. The caches of the engine
+ * belong to it.
+ */
+static ENGINE_LOCAL struct engine_context *current_context = NULL;
+
+
+/*
+ * Create a context for a new game on an empty board of the given
+ * size, with a hash table of memory megabytes. With memory 0 it gets
+ * no hash table, and must be given one by engine_context_copy()
+ * before it is entered. The reading depths and the hash flags are
+ * taken from the engine of the calling thread.
+ *
+ * Return NULL if there is insufficient memory.
+ */
+
+struct engine_context *
+engine_context_new(int boardsize, int memory)
+{
+  struct engine_context *ctx;
+
+  ctx = (struct engine_context *) malloc(sizeof(struct engine_context));
+  if (ctx == NULL)
+    return NULL;
+
+  memset(ctx->p, EMPTY, sizeof(ctx->p));
+  ctx->ko_i = -1;
+  ctx->ko_j = -1;
+  ctx->board_size = boardsize;
+  ctx->movenum = 0;
+  ctx->black_captured = 0;
+  ctx->white_captured = 0;
+  ctx->last_move_i = -1;
+  ctx->last_move_j = -1;
+  ctx->color_has_played = 0;
+  ctx->depth = depth;
+  ctx->backfill_depth = backfill_depth;
+  ctx->fourlib_depth = fourlib_depth;
+  ctx->ko_depth = ko_depth;
+  memset(&ctx->fuseki, 0, sizeof(ctx->fuseki));
+  ctx->fuseki.firstmove = 1;
+  get_hashflags_state(&ctx->hashflags);
+  ctx->random_state = (unsigned int) rand() | 1;
+
+  ctx->movehash = NULL;
+#if HASHING
+  if (memory > 0) {
+    ctx->movehash = hashtable_allocate(memory);
+    if (ctx->movehash == NULL) {
+      free(ctx);
+      return NULL;
+    }
+  }
+#endif
+  ctx->own_movehash = ctx->movehash;
+
+  return ctx;
+}
+
+
+/*
+ * Free a context and its own hash table.
+ */
+
+void
+engine_context_free(struct engine_context *ctx)
+{
+#if HASHING
+  if (ctx->own_movehash != NULL)
+    hashtable_free(ctx->own_movehash);
+#endif
+  if (current_context == ctx)
+    current_context = NULL;
+  free(ctx);
+}
+
+
+/*
+ * Load a context into the engine of the calling thread. If the
+ * engine last worked on another context, its caches are cleared.
+ */
+
+void
+engine_context_enter(struct engine_context *ctx)
+{
+  assert(stackp == 0);
+
+  memcpy(p, ctx->p, sizeof(p));
+  ko_i = ctx->ko_i;
+  ko_j = ctx->ko_j;
+  board_size = ctx->board_size;
+  movenum = ctx->movenum;
+  black_captured = ctx->black_captured;
+  white_captured = ctx->white_captured;
+  last_move_i = ctx->last_move_i;
+  last_move_j = ctx->last_move_j;
+  color_has_played = ctx->color_has_played;
+  depth = ctx->depth;
+  backfill_depth = ctx->backfill_depth;
+  fourlib_depth = ctx->fourlib_depth;
+  ko_depth = ctx->ko_depth;
+  set_fuseki_state(&ctx->fuseki);
+  set_hashflags_state(&ctx->hashflags);
+  movehash = ctx->movehash;
+  hashdata_init(&hashdata);
+
+  if (current_context != ctx) {
+    init_moyo();
+    clear_wind_cache();
+    clear_safe_move_cache();
+    current_context = ctx;
+  }
+}
+
+
+/*
+ * Save the state of the engine of the calling thread back into the
+ * context it has entered.
+ */
+
+void
+engine_context_leave(struct engine_context *ctx)
+{
+  assert(stackp == 0);
+  assert(current_context == ctx);
+
+  memcpy(ctx->p, p, sizeof(p));
+  ctx->ko_i = ko_i;
+  ctx->ko_j = ko_j;
+  ctx->board_size = board_size;
+  ctx->movenum = movenum;
+  ctx->black_captured = black_captured;
+  ctx->white_captured = white_captured;
+  ctx->last_move_i = last_move_i;
+  ctx->last_move_j = last_move_j;
+  ctx->color_has_played = color_has_played;
+  ctx->depth = depth;
+  ctx->backfill_depth = backfill_depth;
+  ctx->fourlib_depth = fourlib_depth;
+  ctx->ko_depth = ko_depth;
+  get_fuseki_state(&ctx->fuseki);
+  get_hashflags_state(&ctx->hashflags);
+}
+
+
+/*
+ * Copy the position, the depths, the hash flags and the fuseki state
+ * of the engine of the calling thread into ctx, which another thread
+ * may then enter to read ahead (see ponder.c). The random generator
+ * of ctx is kept. The hash table is shared rather than copied: ctx
+ * uses the one of the calling thread from now on, so that what is
+ * read in one engine is found by the other. The two must then not
+ * read at the same time.
+ */
+
+void
+engine_context_copy(struct engine_context *ctx)
+{
+  assert(stackp == 0);
+
+  memcpy(ctx->p, p, sizeof(p));
+  ctx->ko_i = ko_i;
+  ctx->ko_j = ko_j;
+  ctx->board_size = board_size;
+  ctx->movenum = movenum;
+  ctx->black_captured = black_captured;
+  ctx->white_captured = white_captured;
+  ctx->last_move_i = last_move_i;
+  ctx->last_move_j = last_move_j;
+  ctx->color_has_played = color_has_played;
+  ctx->depth = depth;
+  ctx->backfill_depth = backfill_depth;
+  ctx->fourlib_depth = fourlib_depth;
+  ctx->ko_depth = ko_depth;
+  get_fuseki_state(&ctx->fuseki);
+  get_hashflags_state(&ctx->hashflags);
+  ctx->movehash = movehash;
+}
+
+
+/*
+ * The random numbers used for fuseki and for the randomness of the
+ * patterns. A context has its own generator (xorshift) seeded by
+ * rand() when it is created, so that a game played in a context does
+ * not depend on what other threads are doing. Without a context this
+ * is just rand() as before.
+ */
+
+int
+engine_random(void)
+{
+  unsigned int x;
+
+  if (current_context == NULL)
+    return rand();
+
+  x = current_context->random_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  current_context->random_state = x;
+
+  return (int) (x % ((unsigned int) RAND_MAX + 1));
+}
+
+
+/*
+ * The public functions of the engine, working on a context. They
+ * enter the context, call the function of the same name and leave
+ * the context again.
+ */
+
+int
+context_genmove(struct engine_context *ctx, int *i, int *j, int color)
+{
+  int val;
+
+  engine_context_enter(ctx);
+  val = genmove(i, j, color);
+  engine_context_leave(ctx);
+
+  return val;
+}
+
+
+/* Play a move. Like the interfaces, this also advances the move
+ * number.
+ */
+
+int
+context_updateboard(struct engine_context *ctx, int i, int j, int color)
+{
+  int captures;
+
+  engine_context_enter(ctx);
+  captures = updateboard(i, j, color);
+  movenum++;
+  engine_context_leave(ctx);
+
+  return captures;
+}
+
+
+int
+context_legal(struct engine_context *ctx, int i, int j, int color)
+{
+  int result;
+
+  engine_context_enter(ctx);
+  result = legal(i, j, color);
+  engine_context_leave(ctx);
+
+  return result;
+}
+
+
+/*
+ * Local Variables:
+ * tab-width: 8
+ * c-basic-offset: 2
+ * End:
+ */
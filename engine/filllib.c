@@ -247,13 +247,13 @@ fill_liberty(int *i, int *j, int *val, int color)
  * function. Currently we only do a half-hearted attempt to find
  * opponent moves.
  */
-static int adji[MAXCHAIN];
-static int adjj[MAXCHAIN];
-static int adjsize[MAXCHAIN];
-static int adjlib[MAXCHAIN];
+static ENGINE_LOCAL int adji[MAXCHAIN];
+static ENGINE_LOCAL int adjj[MAXCHAIN];
+static ENGINE_LOCAL int adjsize[MAXCHAIN];
+static ENGINE_LOCAL int adjlib[MAXCHAIN];
 
-static int mylibi[MAXLIBS]; /* libi and libj are occupied by globals */
-static int mylibj[MAXLIBS];
+static ENGINE_LOCAL int mylibi[MAXLIBS]; /* libi and libj are occupied by globals */
+static ENGINE_LOCAL int mylibj[MAXLIBS];
 
 static int
 find_backfilling_move(int m, int n, int color, int *i, int *j)
@@ -279,7 +279,7 @@ find_backfilling_move(int m, int n, int color, int *i, int *j)
   assert(acode != 0 && ai>=0 && aj>=0);
   
   /* Find liberties. */
-  libs = countlib(m, n, color);
+  libs = approxlib(m, n, color, MAXLIBS);
   /* Copy the list of liberties from globals, they may become lost in
    * later reading.
    */
@@ -25,6 +25,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include "liberty.h"
@@ -76,19 +77,11 @@ static const int gray_4 = 25;
 static const int played_5 = 26;
 
 
-static int corner_done, fuseki_ended;
-static int firstmove = 1;
+static ENGINE_LOCAL int corner_done, fuseki_ended;
+static ENGINE_LOCAL int firstmove = 1;
 
-typedef struct {
-  int nb_stone;
-  int color;
-  int closed;
-  int kado;
-  int coord[4];
-} corner_status;
-
-static corner_status angle[4];	/*initialized here to 0 */
-static corner_status short_angle[4];	/* initialized here to 0 */
+static ENGINE_LOCAL corner_status angle[4];	/*initialized here to 0 */
+static ENGINE_LOCAL corner_status short_angle[4];	/* initialized here to 0 */
 
 /*****************************************************************/
 static int where(int i);
@@ -785,7 +778,7 @@ choose_second(corner_status * ang, int corner, int *m, int *n, int color, int sy
 	    return v;
 	  } else {		/*empty on left */
 	    /* play enclosure, merely high one */
-	    if ((3.0 * rand() / (RAND_MAX + 1.0)) == 1)
+	    if ((3.0 * engine_random() / (RAND_MAX + 1.0)) == 1)
 	      decompose(SYM(503), corner, m, n);
 	    else
 	      decompose(SYM(504), corner, m, n);
@@ -807,7 +800,7 @@ choose_second(corner_status * ang, int corner, int *m, int *n, int color, int sy
 	    return v;
 	  } else {		/* empty on left */
 	    /* play enclosure, merely high one */
-	    if ((3.0 * rand() / (RAND_MAX + 1.0)) == 1)
+	    if ((3.0 * engine_random() / (RAND_MAX + 1.0)) == 1)
 	      decompose(SYM(503), corner, m, n);
 	    else
 	      decompose(SYM(504), corner, m, n);
@@ -819,7 +812,7 @@ choose_second(corner_status * ang, int corner, int *m, int *n, int color, int sy
 	  if (left == color) {
 	    if (area_color_c(SYM(414), corner) == color) {
 	      /* play high enclosure, more high */
-	      if ((4.0 * rand() / (RAND_MAX + 1.0)) == 1)
+	      if ((4.0 * engine_random() / (RAND_MAX + 1.0)) == 1)
 		decompose(SYM(503), corner, m, n);
 	      else
 		decompose(SYM(504), corner, m, n);
@@ -833,7 +826,7 @@ choose_second(corner_status * ang, int corner, int *m, int *n, int color, int sy
 	    decompose(SYM(503), corner, m, n);
 	    return v + 1;
 	  } else {		/* empty on both sides */
-	    if ((3.0 * rand() / (RAND_MAX + 1.0)) == 1)
+	    if ((3.0 * engine_random() / (RAND_MAX + 1.0)) == 1)
 	      decompose(SYM(503), corner, m, n);
 	    else
 	      decompose(SYM(504), corner, m, n);
@@ -929,14 +922,14 @@ choose_second(corner_status * ang, int corner, int *m, int *n, int color, int sy
 	
 	if (upper == color && left == color) {
 	  /* we have both sides, maybe play high */
-	  if ((int) (3.0 * rand() / (RAND_MAX + 1.0)) == 1)
+	  if ((int) (3.0 * engine_random() / (RAND_MAX + 1.0)) == 1)
 	    decompose(SYM(504), corner, m, n);
 	  else
 	    decompose(SYM(503), corner, m, n);
 	  return v + 11;
 	} else if (upper == color && left == other) {
 	  /* we have only upper side, play high */
-	  if ((int) (3.0 * rand() / (RAND_MAX + 1.0)) == 1)
+	  if ((int) (3.0 * engine_random() / (RAND_MAX + 1.0)) == 1)
 	    decompose(SYM(503), corner, m, n);
 	  else
 	    decompose(SYM(504), corner, m, n);
@@ -970,14 +963,14 @@ choose_second(corner_status * ang, int corner, int *m, int *n, int color, int sy
 	    return appro_val - 8;
 	  } else {		/* chose by random, move less urgent */
 	    /* play sometimes high approach move */
-	    if ((int) (2.0 * rand() / (RAND_MAX + 1.0)) == 1) {
-	      if ((int) (5.0 * rand() / (RAND_MAX + 1.0)) == 1)
+	    if ((int) (2.0 * engine_random() / (RAND_MAX + 1.0)) == 1) {
+	      if ((int) (5.0 * engine_random() / (RAND_MAX + 1.0)) == 1)
 		decompose(604, corner, m, n);
 	      else
 		decompose(603, corner, m, n);
 	      return appro_val - 20;
 	    } else {
-	      if ((int) (5.0 * rand() / (RAND_MAX + 1.0)) == 1)
+	      if ((int) (5.0 * engine_random() / (RAND_MAX + 1.0)) == 1)
 		decompose(406, corner, m, n);
 	      else
 		decompose(306, corner, m, n);
@@ -1006,7 +999,7 @@ choose_second(corner_status * ang, int corner, int *m, int *n, int color, int sy
 	      /* play left */
 	      decompose(603, corner, m, n);
 	      return appro_val - 30;
-	    } else if ((int) (2.0 * rand() / (RAND_MAX + 1.0)) == 1) {
+	    } else if ((int) (2.0 * engine_random() / (RAND_MAX + 1.0)) == 1) {
 	      decompose(306, corner, m, n);
 	      return appro_val - 30;
 	    } else {
@@ -1031,7 +1024,7 @@ choose_second(corner_status * ang, int corner, int *m, int *n, int color, int sy
 	  } else if (area_stone(il, jl) > area_stone(iu, ju)) {
 	    decompose(603, corner, m, n);
 	    return appro_val - 12;
-	  } else if ((int) (2.0 * rand() / (RAND_MAX + 1.0)) == 1) {
+	  } else if ((int) (2.0 * engine_random() / (RAND_MAX + 1.0)) == 1) {
 	    decompose(306, corner, m, n);
 	    return appro_val - 13;
 	  } else {
@@ -1058,7 +1051,7 @@ choose_second(corner_status * ang, int corner, int *m, int *n, int color, int sy
     
     case 405:{
       /* standard kakari is 4-3, but 3-3 is possible */
-      if ((int) (5.0 * rand() / (RAND_MAX + 1.0)) == 1)
+      if ((int) (5.0 * engine_random() / (RAND_MAX + 1.0)) == 1)
 	decompose(303, corner, m, n);
       else
 	decompose(SYM(403), corner, m, n);
@@ -1151,7 +1144,7 @@ choose_corner_move(int corner, int *m, int *n)
   for (i=0; i<8 ;i++)
     sum_of_weights += table[i];
   
-  q = rand() % sum_of_weights;
+  q = engine_random() % sum_of_weights;
   for (i=0; i<8; i++) {
     q -= table[i];
     if (q<0)
@@ -1522,6 +1515,30 @@ void init_fuseki(void)
   fuseki_ended = 0;
 }
 
+/* The fuseki state lasts over the whole game, so an engine context
+ * has to save and restore it (see context.c). This includes angle[]
+ * and short_angle[], since readcorner() finds the new stones in a
+ * corner by comparing with what it saw at the last move.
+ */
+
+void get_fuseki_state(struct fuseki_state *state)
+{
+  state->firstmove = firstmove;
+  state->corner_done = corner_done;
+  state->fuseki_ended = fuseki_ended;
+  memcpy(state->angle, angle, sizeof(angle));
+  memcpy(state->short_angle, short_angle, sizeof(short_angle));
+}
+
+void set_fuseki_state(const struct fuseki_state *state)
+{
+  firstmove = state->firstmove;
+  corner_done = state->corner_done;
+  fuseki_ended = state->fuseki_ended;
+  memcpy(angle, state->angle, sizeof(angle));
+  memcpy(short_angle, state->short_angle, sizeof(short_angle));
+}
+
 
 /***********************************************************************
 
@@ -1595,7 +1612,7 @@ play_empty_corner(int *m, int *n, int *val, int *equal_moves, int color)
 	
 	for (i = 0; i < 8; i++)
 	  sum_of_weights += table[i];
-	q = (int) ((double) sum_of_weights *rand() / (RAND_MAX + 1.0));
+	q = (int) ((double) sum_of_weights *engine_random() / (RAND_MAX + 1.0));
 	
 	for (i = 0; i < 8; i++) {
 	  q -= table[i];
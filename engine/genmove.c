@@ -37,6 +37,22 @@
 
 void sgfShowConsideredMoves(void);
 
+const char *const phase_name[NUM_PHASES] = {
+  "make_worms", "make_dragons", "make_moyo", "fuseki", "semeai",
+  "shapes", "attacker", "defender", "eye_finder"
+};
+
+
+/* Charge the time since *start to the phase and restart the clock. */
+
+static void
+time_phase(int phase, double *start)
+{
+  double now = gg_gettimeofday();
+  stats.phase_time[phase] += now - *start;
+  *start = now;
+}
+
 /* 
  * Generate computer move for COLOR.
  *
@@ -50,19 +66,49 @@ genmove(int *i, int *j, int color)
   int equal_moves;
   int m,n;
   int shapei, shapej;
+  int msec;
+  int deeper;
+  double start;
+  double move_start;
 
   /* prepare our table of moves considered */
   memset(potential_moves, 0, sizeof(potential_moves));
 
   /* Reset all the statistics for each move. */
-  stats.nodes = 0;
+  memset(&stats, 0, sizeof(stats));
+
+  /* The move may have been read while the opponent was thinking. */
+  move_start = gg_gettimeofday();
+  if (pondered_move(i, j, color, &val)) {
+    clock_spent(color, gg_gettimeofday() - move_start);
+    return val;
+  }
+
+  /* Limit the reading of this move, if there is a budget, and to
+   * the time the clock allows. The time of pondering is free. */
+  msec = pondering ? 0 : clock_time_budget(color);
+  if (msec > 0)
+    TRACE("The clock allows %d ms for this move.\n", msec);
+  if (move_time_budget > 0 && (msec == 0 || move_time_budget < msec))
+    msec = move_time_budget;
+  start_read_budget(move_node_budget, msec);
+
+  /* Read deeper if the clock has time to spare. */
+  deeper = pondering ? 0 : clock_depth_offset(color);
+  if (deeper > 0) {
+    TRACE("Reading %d deeper.\n", deeper);
+    depth += deeper;
+    backfill_depth += deeper;
+    fourlib_depth += deeper;
+    ko_depth += deeper;
+  }
 
   /* prepare matchpat for use */
   compile_for_match();
 
 #if HASHING
   /* Initialize things for hashing of positions. */
-  hashtable_clear(movehash);
+  hashtable_age(movehash);
   board_to_position(p, ko_i, ko_j, /*color,*/ &(hashdata.hashpos));
   hashdata.hashval = board_hash(p, ko_i, ko_j/*, color*/);
 #endif
@@ -75,20 +121,26 @@ genmove(int *i, int *j, int color)
   /* Used to give every equal move the same chance to be chosen. */
   equal_moves = 2;
 
+  start = gg_gettimeofday();
   {
     /* Don't print reading traces during make_worms and make_dragons unless 
        the user really wants it (verbose == 3). */
 
     int save_verbose=verbose;
+    int board_not_empty;
     if ((verbose==1) || (verbose==2)) --verbose;
-    if (make_worms()) {
+    board_not_empty = make_worms();
+    time_phase(PHASE_WORMS, &start);
+    if (board_not_empty) {
       make_dragons();
+      time_phase(PHASE_DRAGONS, &start);
     }
     verbose=save_verbose;
   }
 
   /* Map the moyos for both sides. */
   make_moyo(color);
+  time_phase(PHASE_MOYO, &start);
   
   if (printworms) {
     show_dragons();
@@ -116,6 +168,7 @@ genmove(int *i, int *j, int color)
   assert(stackp == 0);  /* stack empty */
 
   /* Try to find nice fuseki moves. */
+  start = gg_gettimeofday();
 
   if (fuseki(i, j, &val, &equal_moves, color))
   {
@@ -123,6 +176,7 @@ genmove(int *i, int *j, int color)
       if(analyzerflag&ANALYZE_RECOMMENDED)
           sgfBoardText(0,*i,*j,"F");
   }
+  time_phase(PHASE_FUSEKI, &start);
   assert(stackp == 0);
 
   /* Try to catch your stones in semeai. */
@@ -132,6 +186,7 @@ genmove(int *i, int *j, int color)
      if(analyzerflag&ANALYZE_RECOMMENDED)
        sgfBoardText(0,*i,*j,"S");
   }
+  time_phase(PHASE_SEMEAI, &start);
   assert(stackp == 0);  /* stack empty */
   
   /* pattern matcher */
@@ -141,6 +196,7 @@ genmove(int *i, int *j, int color)
      if(analyzerflag&ANALYZE_RECOMMENDED)
        sgfBoardText(0,*i,*j,"P");
   }
+  time_phase(PHASE_SHAPES, &start);
   shapei = *i;
   shapej = *j;
 
@@ -153,6 +209,7 @@ genmove(int *i, int *j, int color)
      if(analyzerflag&ANALYZE_RECOMMENDED)
        sgfBoardText(0,*i,*j,"A");
   }
+  time_phase(PHASE_ATTACKER, &start);
   assert(stackp == 0);  /* stack empty */
   
   /* Try to save my stones if you can attack them. */
@@ -161,6 +218,7 @@ genmove(int *i, int *j, int color)
      if(analyzerflag&ANALYZE_RECOMMENDED)
        sgfBoardText(0,*i,*j,"D");
   }
+  time_phase(PHASE_DEFENDER, &start);
   assert(stackp == 0);  /* stack empty */
 
   /* Look for eye stealing moves. */
@@ -169,6 +227,7 @@ genmove(int *i, int *j, int color)
      if(analyzerflag&ANALYZE_RECOMMENDED)
        sgfBoardText(0,*i,*j,"E");
   }
+  time_phase(PHASE_EYE_FINDER, &start);
   assert(stackp == 0);  /* stack empty */
   
   /* If no move found yet, revisit any semeai and change the
@@ -184,6 +243,7 @@ genmove(int *i, int *j, int color)
        if(analyzerflag&ANALYZE_RECOMMENDED)
          sgfBoardText(0,*i,*j,"p");
     }
+  time_phase(PHASE_SHAPES, &start);
   if ((val < 0) && fill_liberty(i, j, &val, color))
   {
      TRACE("Filling a liberty at %m\n", *i, *j);
@@ -228,13 +288,85 @@ genmove(int *i, int *j, int color)
   } else
     TRACE("genmove() recommends %m with value %d\n", *i, *j, val);
   
+  /* The budget and the depths are only for this move. */
+  start_read_budget(0, 0);
+  depth -= deeper;
+  backfill_depth -= deeper;
+  fourlib_depth -= deeper;
+  ko_depth -= deeper;
+  if (pondering)
+    return val;
+  clock_spent(color, gg_gettimeofday() - move_start);
+
+  /* Decide which reading routines to hash in the next move. */
+  adapt_hashflags();
+
   /* If statistics is turned on, this is the place to show it. */
   if (showstatistics) {
-    char text[120];
+    char text[200];
     sprintf(text,"Nodes: %d\n", stats.nodes);
     sgfAddComment(0,text);
     gprintf("Nodes: %d\n", stats.nodes);
-      
+#if HASHING
+    sprintf(text, "Read results: %d hits in %d lookups (%.1f%%), "
+	    "%d entered, %d replaced\n",
+	    stats.read_result_hits, stats.read_result_lookups,
+	    stats.read_result_lookups 
+	    ? 100.0 * stats.read_result_hits / stats.read_result_lookups : 0.0,
+	    stats.read_result_entered, stats.read_result_replaced);
+    sgfAddComment(0, text);
+    gprintf("%s", text);
+    for (m = 0; m < NUM_READ_ROUTINES; m++)
+      if (stats.read_lookups[m] > 0) {
+	sprintf(text, "  %-12s %d hits in %d lookups (%.1f%%)\n",
+		read_routine_name[m], stats.read_hits[m], stats.read_lookups[m],
+		100.0 * stats.read_hits[m] / stats.read_lookups[m]);
+	sgfAddComment(0, text);
+	gprintf("%s", text);
+      }
+    sprintf(text, "Hash flags for the next move: 0x%x%s\n", hashflags,
+	    adaptive_hashflags ? " (adaptive)" : "");
+    sgfAddComment(0, text);
+    gprintf("%s", text);
+    if (stats.read_result_shallow > 0) {
+      sprintf(text, "Read results read again with a higher depth: %d\n",
+	      stats.read_result_shallow);
+      sgfAddComment(0, text);
+      gprintf("%s", text);
+    }
+#endif
+    if (stats.budget_cutoffs > 0) {
+      sprintf(text, "Budget used up: %d attacks given up\n",
+	      stats.budget_cutoffs);
+      sgfAddComment(0, text);
+      gprintf("%s", text);
+    }
+    if (stats.deepening_calls > 0) {
+      sprintf(text, "Iterative deepening: %d iterations in %d calls\n",
+	      stats.deepening_iterations, stats.deepening_calls);
+      sgfAddComment(0, text);
+      gprintf("%s", text);
+    }
+    sprintf(text, "Patterns: %d tried, %d past anchor, %d past grid, "
+	    "%d past edge, %d matched, %d accepted\n",
+	    stats.matcher[MATCH_TRIED], stats.matcher[MATCH_ANCHOR],
+	    stats.matcher[MATCH_GRID], stats.matcher[MATCH_EDGE],
+	    stats.matcher[MATCH_ELEMENTS], stats.matcher[MATCH_HELPER]);
+    sgfAddComment(0, text);
+    gprintf("%s", text);
+    for (m = 0; m < STATS_DEPTHS; m++)
+      if (stats.safe_move_lookups[m] > 0) {
+	sprintf(text, "safe_move at stackp %d%s: %d hits in %d lookups (%.1f%%)\n",
+		m, m == STATS_DEPTHS - 1 ? "+" : "",
+		stats.safe_move_hits[m], stats.safe_move_lookups[m],
+		100.0 * stats.safe_move_hits[m] / stats.safe_move_lookups[m]);
+	sgfAddComment(0, text);
+	gprintf("%s", text);
+      }
+    for (m = 0; m < NUM_PHASES; m++) {
+      sprintf(text, "%-12s %.3f s\n", phase_name[m], stats.phase_time[m]);
+      gprintf("%s", text);
+    }
   }
 
   return val;
@@ -33,44 +33,68 @@
 
 
 /* The go board and position. */
-board_t  p[MAX_BOARD][MAX_BOARD];
-int      ko_i;
-int      ko_j;
+ENGINE_LOCAL board_t  p[MAX_BOARD][MAX_BOARD];
+ENGINE_LOCAL int      ko_i;
+ENGINE_LOCAL int      ko_j;
+
+/* The same position on the padded board, kept by strings.c. */
+ENGINE_LOCAL board_t  board[BOARDMAX];
+const int             delta[4] = { -NS, NS, -WE, WE };
 
 /* Hashing of positions. */
-Hashtable  * movehash;
-Hash_data    hashdata;
+ENGINE_LOCAL Hashtable  * movehash;
+ENGINE_LOCAL Hash_data    hashdata;
 /* 
  * A study showed that this is the optimal setting for when hashing only 
  * a few functions.  Hashing all functions saves time, but wastes table
  * space.  This is bad when the reading is complicated.  This is a 
- * compromise.
+ * compromise, and adapt_hashflags() stops hashing the least useful
+ * of them when the table fills up anyway, unless --hash is given.
+ */
+ENGINE_LOCAL int hashflags =
+  HASH_ATTACK3 | HASH_ATTACK2 | HASH_DEFEND4 | HASH_SAFE_MOVE;
+int adaptive_hashflags = 1;
+
+/* Budgets for iterative_attack() and iterative_find_defense() in
+ * make_worms(). With both 0 the worms are read to the fixed depth.
+ */
+int read_node_budget = 0;
+int read_time_budget = 0;
+
+/* Order the moves tried in reading.c by the killer and history
+ * heuristics. Turned off with --ordering 0, to compare the nodes.
+ */
+int move_ordering = 1;
+
+/* The reading nodes and milliseconds genmove() may spend on a move.
+ * When they are used up the reading gives up, see start_read_budget().
  */
-int hashflags = HASH_ATTACK3 | HASH_ATTACK2 | HASH_DEFEND4;
+int move_node_budget = 0;
+int move_time_budget = 0;
 
-int last_move_i;           /* The position of the last move */
-int last_move_j;           /* -""-                          */
+ENGINE_LOCAL int last_move_i;           /* The position of the last move */
+ENGINE_LOCAL int last_move_j;           /* -""-                          */
 
-board_t potential_moves[MAX_BOARD][MAX_BOARD];
+ENGINE_LOCAL board_t potential_moves[MAX_BOARD][MAX_BOARD];
 
-int  black_captured;
-int  white_captured;                /* num. of black and white stones captured */
-int  black_captured_backup;
-int  white_captured_backup; 
+ENGINE_LOCAL int  black_captured;
+ENGINE_LOCAL int  white_captured;                /* num. of black and white stones captured */
+ENGINE_LOCAL int  black_captured_backup;
+ENGINE_LOCAL int  white_captured_backup; 
 
 /* These variables are used by count(). */
-int  lib;               /* current stone liberty written by count() */
-int  libi[MAXLIBS];     /* array of liberties found : filled by count() */
-int  libj[MAXLIBS];
-int  size;              /* cardinality of a group : written by count() */
+ENGINE_LOCAL int  lib;               /* current stone liberty written by count() */
+ENGINE_LOCAL int  libi[MAXLIBS];     /* array of liberties found : filled by count() */
+ENGINE_LOCAL int  libj[MAXLIBS];
+ENGINE_LOCAL int  size;              /* cardinality of a group : written by count() */
 
 /* Used by reading. */
-int stackp;             /* stack pointer */
-int movenum;            /* movenumber */
-int depth;              /* deep reading cut off */
-int backfill_depth;     /* deep reading cut off */
-int fourlib_depth;      /* deep reading cut off */
-int ko_depth;           /* deep reading cut off */
+ENGINE_LOCAL int stackp;             /* stack pointer */
+ENGINE_LOCAL int movenum;            /* movenumber */
+ENGINE_LOCAL int depth;              /* deep reading cut off */
+ENGINE_LOCAL int backfill_depth;     /* deep reading cut off */
+ENGINE_LOCAL int fourlib_depth;      /* deep reading cut off */
+ENGINE_LOCAL int ko_depth;           /* deep reading cut off */
 
 /* Miscellaneous. */
 int showstack;          /* debug stack pointer */
@@ -79,27 +103,27 @@ int allpats;            /* generate all patterns, even small ones */
 int printworms;         /* print full data on each string */
 int printmoyo;          /* print moyo board each move*/
 int printboard;         /* print board each move */
-int board_size=19;      /* board size */
-int count_variations=0; /* used by decide_string */
-int sgf_dump=0;         /* used by decide_string*/
-int loading=0;          /* TRUE indicates last loaded move comes from file*/
+ENGINE_LOCAL int board_size=19;      /* board size */
+ENGINE_LOCAL int count_variations=0; /* used by decide_string */
+ENGINE_LOCAL int sgf_dump=0;         /* used by decide_string*/
+ENGINE_LOCAL int loading=0;          /* TRUE indicates last loaded move comes from file*/
 int style=STY_DEFAULT;  /* style of play */
 
 /* Various statistics are collected here. */
-struct stats_data stats;
+ENGINE_LOCAL struct stats_data stats;
 
-struct worm_data      worm[MAX_BOARD][MAX_BOARD];
-struct dragon_data    dragon[MAX_BOARD][MAX_BOARD];
-struct half_eye_data  half_eye[MAX_BOARD][MAX_BOARD];
-struct eye_data       black_eye[MAX_BOARD][MAX_BOARD];
-struct eye_data       white_eye[MAX_BOARD][MAX_BOARD];
+ENGINE_LOCAL struct worm_data      worm[MAX_BOARD][MAX_BOARD];
+ENGINE_LOCAL struct dragon_data    dragon[MAX_BOARD][MAX_BOARD];
+ENGINE_LOCAL struct half_eye_data  half_eye[MAX_BOARD][MAX_BOARD];
+ENGINE_LOCAL struct eye_data       black_eye[MAX_BOARD][MAX_BOARD];
+ENGINE_LOCAL struct eye_data       white_eye[MAX_BOARD][MAX_BOARD];
 
-int  distance_to_black[MAX_BOARD][MAX_BOARD];
-int  distance_to_white[MAX_BOARD][MAX_BOARD];
-int  strategic_distance_to_black[MAX_BOARD][MAX_BOARD];
-int  strategic_distance_to_white[MAX_BOARD][MAX_BOARD];
-int  black_domain[MAX_BOARD][MAX_BOARD];
-int  white_domain[MAX_BOARD][MAX_BOARD];
+ENGINE_LOCAL int  distance_to_black[MAX_BOARD][MAX_BOARD];
+ENGINE_LOCAL int  distance_to_white[MAX_BOARD][MAX_BOARD];
+ENGINE_LOCAL int  strategic_distance_to_black[MAX_BOARD][MAX_BOARD];
+ENGINE_LOCAL int  strategic_distance_to_white[MAX_BOARD][MAX_BOARD];
+ENGINE_LOCAL int  black_domain[MAX_BOARD][MAX_BOARD];
+ENGINE_LOCAL int  white_domain[MAX_BOARD][MAX_BOARD];
 
 int debug          = 0;
 int verbose        = 0;  /* trace level                                     */
@@ -108,7 +132,7 @@ int showstatistics = 0;
 int printworms     = 0;  /* print full data about each string on the board  */
 int printmoyo      = 0;  /* print moyo board each move                      */
 int allpats        = 0;  /* compute and print value of all patterns.        */
-int color_has_played = 0;  /* whether color has placed a stone yet          */
+ENGINE_LOCAL int color_has_played = 0;  /* whether color has placed a stone yet          */
 
 SGFNodeP sgf_root = NULL;
 char *analyzerfile = NULL;
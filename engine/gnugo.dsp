@@ -92,6 +92,18 @@ SOURCE=.\attdef.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\bitboard.c
+# End Source File
+# Begin Source File
+
+SOURCE=.\clock.c
+# End Source File
+# Begin Source File
+
+SOURCE=.\context.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\dragon.c
 # End Source File
 # Begin Source File
@@ -128,6 +140,10 @@ SOURCE=.\optics.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\ponder.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\reading.c
 # End Source File
 # Begin Source File
@@ -148,6 +164,14 @@ SOURCE=.\showbord.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\strings.c
+# End Source File
+# Begin Source File
+
+SOURCE=.\threads.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\utils.c
 # End Source File
 # Begin Source File
@@ -24,7 +24,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
-#include <time.h>
+#include <string.h>
 #include <assert.h>
 
 #include "liberty.h"
@@ -42,9 +42,9 @@
 static int  is_initialized = 0;
 
 /* Random values for the hash function.  For stones and ko position. */
-static unsigned long  white_hash[MAX_BOARD][MAX_BOARD];	
-static unsigned long  black_hash[MAX_BOARD][MAX_BOARD];	
-static unsigned long  ko_hash[MAX_BOARD][MAX_BOARD];
+static Hashvalue  white_hash[MAX_BOARD][MAX_BOARD];	
+static Hashvalue  black_hash[MAX_BOARD][MAX_BOARD];	
+static Hashvalue  ko_hash[MAX_BOARD][MAX_BOARD];
 
 /* Bit patterns for white stones in the compact board representation. */
 static unsigned long white_patterns[] = {
@@ -64,6 +64,28 @@ static unsigned long black_patterns[] = {
 
 
 
+/*
+ * The random values come from the SplitMix64 generator with a fixed
+ * seed. It gives all 64 bits of good quality, unlike random() which
+ * gives 31, and the hash values are the same in every run and on
+ * every platform.
+ */
+
+static Hashvalue  hash_rand_state;
+
+static Hashvalue
+hash_rand(void)
+{
+  Hashvalue  z;
+
+  hash_rand_state += (Hashvalue) 0x9e3779b9UL << 32 | 0x7f4a7c15UL;
+  z = hash_rand_state;
+  z = (z ^ (z >> 30)) * ((Hashvalue) 0xbf58476dUL << 32 | 0x1ce4e5b9UL);
+  z = (z ^ (z >> 27)) * ((Hashvalue) 0x94d049bbUL << 32 | 0x133111ebUL);
+  return z ^ (z >> 31);
+}
+
+
 /*
  * Initialize the entire hash system.
  */
@@ -74,31 +96,12 @@ hash_init()
   int  i;
   int  j;
 
-#if !TRACE_READ_RESULTS
-#ifdef HAVE_RANDOM
-  srandom(time(0));
-#else
-  srand(time(0));
-#endif
-#else
-#ifdef HAVE_RANDOM
-  srandom(0);
-#else
-  srand(0);
-#endif
-#endif
+  hash_rand_state = 0;
   for (i = 0; i < MAX_BOARD; ++i)
     for (j = 0; j < MAX_BOARD; ++j) {
-
-#ifdef HAVE_RANDOM
-      white_hash[i][j] = random();
-      black_hash[i][j] = random();
-      ko_hash[i][j]    = random();
-#else
-      white_hash[i][j] = rand();
-      black_hash[i][j] = rand();
-      ko_hash[i][j]    = rand();
-#endif
+      white_hash[i][j] = hash_rand();
+      black_hash[i][j] = hash_rand();
+      ko_hash[i][j]    = hash_rand();
     }
   is_initialized = 1;
 }
@@ -111,11 +114,11 @@ hash_init()
  * See the Texinfo documentation (Reading/Hashing) for more information.
  */
 
-unsigned long
+Hashvalue
 board_hash(board_t board[MAX_BOARD][MAX_BOARD], 
 	   int koi, int koj)
 {
-  unsigned int  hash;
+  Hashvalue     hash;
   int           i;
   int           j;
 
@@ -326,6 +329,9 @@ hashposition_compare(Hashposition *pos1, Hashposition *pos2)
 }
 
 
+#if !HASH_BUCKETS
+
+
 /*
  * Dump an ASCII representation of the contents of a Hashnode onto
  * the FILE outfile. 
@@ -337,8 +343,12 @@ hashnode_dump(Hashnode *node, FILE *outfile)
   Read_result  * result;
 
   /* Data about the node itself. */
-  fprintf(outfile, "Hash value: %d\n", (int) node->hashval);
+  fprintf(outfile, "Hash value: %08lx%08lx\n",
+	  (unsigned long) (node->hashval >> 32),
+	  (unsigned long) (node->hashval & 0xffffffffUL));
+#if !HASH_SIGNATURES
   hashposition_dump(&(node->position), outfile);
+#endif
 
   result = node->results;
   while (result) {
@@ -401,6 +411,74 @@ hashtable_init(Hashtable *table,
 }
 
 
+#else  /* HASH_BUCKETS */
+
+
+/*
+ * Dump an ASCII representation of the results stored for the
+ * position of a Hashnode onto the FILE outfile. 
+ */
+
+void
+hashnode_dump(Hashnode *node, FILE *outfile)
+{
+  int  k;
+
+  fprintf(outfile, "Hash value: %08lx%08lx\n",
+	  (unsigned long) (node->hashval >> 32),
+	  (unsigned long) (node->hashval & 0xffffffffUL));
+
+  for (k = 0; k < HASH_BUCKET_ENTRIES; k++)
+    if (node->bucket->entry[k].result.routine_i_j_stackp != HASH_EMPTY_ENTRY
+	&& hash_entry_matches(node->bucket->entry[k], node->hashval))
+      read_result_dump(&(node->bucket->entry[k].result), outfile);
+}
+
+
+/*
+ * Initialize a bucket table.  The number of buckets is rounded down
+ * to a power of two, but is at least HASH_MIN_BUCKETS.  num_nodes and
+ * num_results are not used, since positions and results are stored
+ * together in the buckets.
+ *
+ * Return 0 if there wasn't enough memory available.
+ */
+
+int
+hashtable_init(Hashtable *table, 
+	       int tablesize, int num_nodes, int num_results)
+{
+  char  * memory;
+  int     size;
+
+  /* If the hash system is not initialized, do so now. */
+  if (!is_initialized)
+    hash_init();
+
+  for (size = HASH_MIN_BUCKETS; 2 * size <= tablesize; size *= 2)
+    ;
+
+  /* One bucket extra, so that the buckets can be aligned. */
+  table->hashtablesize = size;
+  memory = (char *) malloc((size + 1) * sizeof(Hash_bucket));
+  if (memory == NULL)
+    return 0;
+
+  table->memory = memory;
+  table->buckets = (Hash_bucket *) 
+    (memory + (sizeof(Hash_bucket) 
+	       - (size_t) memory % sizeof(Hash_bucket)) % sizeof(Hash_bucket));
+  table->generation = 0;
+
+  hashtable_clear(table);
+
+  return 1;
+}
+
+
+#endif  /* HASH_BUCKETS */
+
+
 /*
  * Allocate a new hash table and return a pointer to it. 
  *
@@ -431,6 +509,49 @@ hashtable_new(int tablesize, int num_nodes, int num_results)
 }
 
 
+/*
+ * Free a hash table allocated by hashtable_new().
+ */
+
+void
+hashtable_free(Hashtable *table)
+{
+#if HASH_BUCKETS
+  free(table->memory);
+#else
+  free(table->hashtable);
+  free(table->all_nodes);
+  free(table->all_results);
+#endif
+  free(table);
+}
+
+
+/*
+ * Allocate a new hash table using about memory megabytes.
+ *
+ * Return NULL if there is insufficient memory.
+ */
+
+Hashtable *
+hashtable_allocate(int memory)
+{
+#if HASH_BUCKETS
+  return hashtable_new((int) ((memory * 1024.0 * 1024.0) 
+			      / sizeof(Hash_bucket)), 0, 0);
+#else
+  float nodes;
+    
+  nodes = (float)( (memory * 1024 * 1024)
+		   / (sizeof(Hashnode) + sizeof(Read_result) * 1.4));
+  return hashtable_new((int) (1.5 * nodes), (int)(nodes), (int)(nodes * 1.4) );
+#endif
+}
+
+
+#if !HASH_BUCKETS
+
+
 /*
  * Clear an existing hash table.  
  */
@@ -446,6 +567,41 @@ hashtable_clear(Hashtable *table)
 
   table->free_node = 0;
   table->free_result = 0;
+  table->board_size = board_size;
+}
+
+
+/*
+ * Start reading for a new move.  The read results are kept, since
+ * they are stored by position and are still valid.  Nodes and
+ * results can't be freed one by one though, so once half the table
+ * is used up, it is cleared to leave room for the coming move.  It
+ * is also cleared if the board size has changed.
+ */
+
+void
+hashtable_age(Hashtable *table)
+{
+  if (table->board_size != board_size
+      || 2 * table->free_node > table->num_nodes
+      || 2 * table->free_result > table->num_results)
+    hashtable_clear(table);
+}
+
+
+/*
+ * Return how full the table is, from 0 to 1.  At 1 either the nodes
+ * or the results have run out, and nothing more is stored until the
+ * table is cleared.
+ */
+
+double
+hashtable_pressure(Hashtable *table)
+{
+  double nodes = (double) table->free_node / table->num_nodes;
+  double results = (double) table->free_result / table->num_results;
+
+  return nodes > results ? nodes : results;
 }
 
 
@@ -457,7 +613,7 @@ hashtable_clear(Hashtable *table)
 
 Hashnode *
 hashtable_enter_position(Hashtable *table, 
-			 Hashposition *pos, unsigned long hash)
+			 Hashposition *pos, Hashvalue hash)
 {
   Hashnode  * node;
   int         bucket;
@@ -475,7 +631,9 @@ hashtable_enter_position(Hashtable *table,
   /* It wasn't there and there is still room.  Allocate a new node for it... */
   node = &(table->all_nodes[table->free_node++]);
   node->hashval = hash;
+#if !HASH_SIGNATURES
   node->position = *pos;
+#endif
   node->results = NULL;
 
   /* ...and enter it into the table. */
@@ -512,17 +670,22 @@ hashtable_delete(Hashtable *table,
  */
 
 Hashnode *
-hashtable_search(Hashtable *table, Hashposition *pos, unsigned long hash)
+hashtable_search(Hashtable *table, Hashposition *pos, Hashvalue hash)
 {
   Hashnode     * node;
   int            bucket;
 
   bucket = hash % table->hashtablesize;
   node = table->hashtable[bucket];
+#if HASH_SIGNATURES
+  while (node != NULL && node->hashval != hash)
+    node = node->next;
+#else
   while (node != NULL
 	 && (node->hashval != hash
 	     || hashposition_compare(pos, &(node->position)) != 0))
     node = node->next;
+#endif
 
   return node;
 }
@@ -576,6 +739,7 @@ hashnode_search(Hashnode *node, int routine, int i, int j)
   unsigned int   search_for;
 
   search_for = (((((routine << 8) | i) << 8) | j) << 8) | stackp;
+  stats.read_result_lookups++;
 
   result = node->results;
   while (result != NULL
@@ -613,6 +777,7 @@ hashnode_new_result(Hashtable *table, Hashnode *node,
   /* Now, put the routine number into it. */
   result->routine_i_j_stackp = ((((((routine << 8) | i) << 8) | j) << 8)
 				| stackp);
+  result->result_ri_rj = 0;
 
   stats.read_result_entered++;
   return result;
@@ -620,6 +785,241 @@ hashnode_new_result(Hashtable *table, Hashnode *node,
 }
 
 
+#else  /* HASH_BUCKETS */
+
+
+/*
+ * Clear an existing bucket table.  All bits set in an entry means
+ * HASH_EMPTY_ENTRY.
+ */
+
+void
+hashtable_clear(Hashtable *table)
+{
+  memset(table->buckets, 0xff, table->hashtablesize * sizeof(Hash_bucket));
+  table->board_size = board_size;
+}
+
+
+/*
+ * Start reading for a new move.  The read results are kept, since
+ * they are stored by position and are still valid, but they now
+ * belong to an older generation and are the first ones to be
+ * replaced.  Nothing needs to be done to evict them.  The table is
+ * only cleared if the board size has changed.
+ */
+
+void
+hashtable_age(Hashtable *table)
+{
+  if (table->board_size != board_size)
+    hashtable_clear(table);
+  table->generation = (table->generation + 1) & HASH_GENERATION_MASK;
+}
+
+
+/*
+ * Return the part of the entries holding results of the current
+ * generation, from 0 to 1.  Near 1 the results of this move replace
+ * each other.  Only HASH_PRESSURE_SAMPLE buckets spread over the
+ * table are looked at.
+ */
+
+#define HASH_PRESSURE_SAMPLE 1024
+
+double
+hashtable_pressure(Hashtable *table)
+{
+  int step = table->hashtablesize / HASH_PRESSURE_SAMPLE;
+  int used = 0;
+  int total = 0;
+  int b, k;
+
+  if (step < 1)
+    step = 1;
+  for (b = 0; b < table->hashtablesize; b += step)
+    for (k = 0; k < HASH_BUCKET_ENTRIES; k++) {
+      Hash_entry *entry = &(table->buckets[b].entry[k]);
+
+      total++;
+      if (entry->result.routine_i_j_stackp != HASH_EMPTY_ENTRY
+	  && hash_entry_generation(*entry) == table->generation)
+	used++;
+    }
+
+  return total ? (double) used / total : 0.0;
+}
+
+
+/*
+ * A bucket table has no room for positions of their own.  Entering
+ * a position only makes the handle point to it, so that results can
+ * be entered with hashnode_new_result().
+ */
+
+Hashnode *
+hashtable_enter_position(Hashtable *table, 
+			 Hashposition *pos, Hashvalue hash)
+{
+  table->current.hashval = hash;
+  table->current.bucket = &(table->buckets[hash & (table->hashtablesize - 1)]);
+  table->current.generation = table->generation;
+
+  stats.position_entered++;
+  return &(table->current);
+}
+
+
+/* 
+ * Return a handle for the position with the given hash value if
+ * there is any result stored for it, otherwise NULL.
+ */
+
+Hashnode *
+hashtable_search(Hashtable *table, Hashposition *pos, Hashvalue hash)
+{
+  Hash_bucket  * bucket;
+  int            k;
+
+  bucket = &(table->buckets[hash & (table->hashtablesize - 1)]);
+  for (k = 0; k < HASH_BUCKET_ENTRIES; k++)
+    if (hash_entry_matches(bucket->entry[k], hash)
+	&& bucket->entry[k].result.routine_i_j_stackp != HASH_EMPTY_ENTRY) {
+      table->current.hashval = hash;
+      table->current.bucket = bucket;
+      table->current.generation = table->generation;
+      return &(table->current);
+    }
+
+  return NULL;
+}
+
+
+/*
+ * Dump an ASCII representation of the contents of a bucket table
+ * onto the FILE outfile. 
+ */
+
+void
+hashtable_dump(Hashtable *table, FILE *outfile)
+{
+  int  i;
+  int  k;
+  Hash_entry  * entry;
+
+  fprintf(outfile, "Dump of hashtable\n");
+  fprintf(outfile, "Number of buckets: %d\n", table->hashtablesize);
+
+  for (i = 0; i < table->hashtablesize; ++i)
+    for (k = 0; k < HASH_BUCKET_ENTRIES; k++) {
+      entry = &(table->buckets[i].entry[k]);
+      if (entry->result.routine_i_j_stackp == HASH_EMPTY_ENTRY)
+	continue;
+      fprintf(outfile, "Bucket %5d: %08lx%08lx generation %d ", i,
+	      (unsigned long) (entry->hashval >> 32),
+	      (unsigned long) (entry->hashval & 0xffffffffUL),
+	      hash_entry_generation(*entry));
+      read_result_dump(&(entry->result), outfile);
+    }
+}
+
+
+/* 
+ * Search the bucket of a position for a particular result. This
+ * result is from ROUTINE (e.g. readlad1) at (i, j) and reading depth
+ * stackp.  A result that is found is moved to the current generation.
+ */
+
+Read_result *
+hashnode_search(Hashnode *node, int routine, int i, int j)
+{
+  Hash_entry    * entry;
+  unsigned int    search_for;
+  int             k;
+
+  search_for = (((((routine << 8) | i) << 8) | j) << 8) | stackp;
+  stats.read_result_lookups++;
+
+  entry = node->bucket->entry;
+  for (k = 0; k < HASH_BUCKET_ENTRIES; k++)
+    if (entry[k].result.routine_i_j_stackp == search_for
+	&& hash_entry_matches(entry[k], node->hashval)) {
+      entry[k].hashval = ((entry[k].hashval 
+			   & ~(Hashvalue) HASH_GENERATION_MASK)
+			  | node->generation);
+      return &(entry[k].result);
+    }
+
+  return NULL;
+}
+
+
+/*
+ * Enter a new Read_result into the bucket of a position.
+ *
+ * If the bucket is full, the result not used for the most moves is
+ * replaced.  If all of them are from the current move, the result
+ * read at the largest depth is replaced, since it is the cheapest one
+ * to compute again.  Only results with a larger stackp than the
+ * current one are replaced then.  The callers higher up in the
+ * reading tree still hold pointers to the results they are going to
+ * fill in, and these all have a stackp no larger than the current
+ * one.  If nothing can be replaced, NULL is returned just as when the
+ * chained table is full.
+ */
+
+Read_result *
+hashnode_new_result(Hashtable *table, Hashnode *node, 
+		    int routine, int i, int j)
+{
+  Hash_entry    * entry;
+  Hash_entry    * victim;
+  int             victim_age;
+  int             age;
+  int             k;
+
+  victim = NULL;
+  victim_age = 0;
+  entry = node->bucket->entry;
+  for (k = 0; k < HASH_BUCKET_ENTRIES; k++) {
+    if (entry[k].result.routine_i_j_stackp == HASH_EMPTY_ENTRY) {
+      victim = &(entry[k]);
+      break;
+    }
+    age = ((node->generation - hash_entry_generation(entry[k]))
+	   & HASH_GENERATION_MASK);
+    if (age > victim_age) {
+      victim = &(entry[k]);
+      victim_age = age;
+    }
+    else if (age == 0 && victim_age == 0
+	     && (int) rr_get_stackp(entry[k].result) > stackp
+	     && (victim == NULL
+		 || (rr_get_stackp(entry[k].result) 
+		     > rr_get_stackp(victim->result))))
+      victim = &(entry[k]);
+  }
+
+  if (victim == NULL)
+    return NULL;
+
+  if (victim->result.routine_i_j_stackp != HASH_EMPTY_ENTRY)
+    stats.read_result_replaced++;
+
+  victim->hashval = ((node->hashval & ~(Hashvalue) HASH_GENERATION_MASK)
+		     | node->generation);
+  victim->result.routine_i_j_stackp = ((((((routine << 8) | i) << 8) | j) << 8)
+				       | stackp);
+  victim->result.result_ri_rj = 0;
+
+  stats.read_result_entered++;
+  return &(victim->result);
+}
+
+
+#endif  /* HASH_BUCKETS */
+
+
 /*
  * Local Variables:
  * tab-width: 8
@@ -42,6 +42,18 @@
 #define TRACE_READ_RESULTS 0
 
 
+/*
+ * Hash values are 64 bit wide. With HASH_SIGNATURES set, the hash
+ * table trusts them and stores no position to compare with.
+ */
+
+#ifdef _MSC_VER
+typedef unsigned __int64    Hashvalue;
+#else
+typedef unsigned long long  Hashvalue;
+#endif
+
+
 /*
  * We define a special compact representation of the board for the 
  * positions.  In this representation each location is represented
@@ -77,7 +89,7 @@ typedef struct hashposition_t {
  */
 
 typedef struct {
-  unsigned long  hashval;
+  Hashvalue      hashval;
   Hashposition   hashpos;
 } Hash_data;
 
@@ -85,7 +97,8 @@ typedef struct {
 /*
  * This struct contains the attack / defense point and the result.
  * It is kept in a linked list, and each position has a list of 
- * these.
+ * these.  With HASH_BUCKETS it is stored inline in a bucket instead
+ * and there is no list.
  */
 
 typedef struct read_result_t {
@@ -100,12 +113,15 @@ typedef struct read_result_t {
 
   int result_ri_rj;		/* ...then this was the result. */
   /*
-  unsigned char  result;
+  unsigned char  depth;		// Read with this value of depth...
+  unsigned char  result;	// ...this was the result.
   unsigned char  ri;
   unsigned char  rj;
   */
 
+#if !HASH_BUCKETS
   struct read_result_t  * next;
+#endif
 } Read_result;
 
 
@@ -125,23 +141,34 @@ typedef struct read_result_t {
 #define rr_get_result_i(rr) (((rr).result_ri_rj >>  8) & 0xff)
 #define rr_get_result_j(rr) (((rr).result_ri_rj >>  0) & 0xff)
 
-/* Set corresponding parts. */
+#define rr_get_depth(rr)    (((rr).result_ri_rj >> 24) & 0xff)
+
+/* Set corresponding parts. rr_set_result_ri_rj() clears the depth. */
 #define rr_set_result_ri_rj(rr, result, ri, rj) \
 	(rr).result_ri_rj \
 	    = (((((result) << 8) | ((ri) & 0xff)) << 8) | ((rj) & 0xff))
+#define rr_set_depth(rr, depth) \
+	(rr).result_ri_rj \
+	    = (((rr).result_ri_rj & 0xffffff) | (((depth) & 0xff) << 24))
 
 /*
  * The hash table consists of hash nodes.  Each hash node consists of
  * The hash value for the position it holds, the position itself and
  * the actual information which is purpose of the table from the start.
+ * With HASH_SIGNATURES the position is left out, which makes the node
+ * about ten times smaller.
  *
  * There is also a pointer to another hash node which is used when
  * the nodes are sorted into hash buckets (see below).
  */
 
+#if !HASH_BUCKETS
+
 typedef struct hashnode_t {
-  unsigned int         hashval;	/* The hash value... */
+  Hashvalue            hashval;	/* The hash value... */
+#if !HASH_SIGNATURES
   Hashposition         position; /* ...for this position. */
+#endif
   Read_result        * results;	/* And here are the results of previous */
 				/*    readings */
 
@@ -171,12 +198,74 @@ typedef struct hashtable {
   int            num_results;	/* Total number of results */
   Read_result  * all_results;	/* Pointer to all allocated results. */
   int            free_result;	/* Index to next free result. */
+
+  int            board_size;	/* Board size when last cleared. */
+} Hashtable;
+
+#else  /* HASH_BUCKETS */
+
+/*
+ * With HASH_BUCKETS the table is a fixed array of buckets, each the
+ * size of a cache line.  A bucket holds HASH_BUCKET_ENTRIES read
+ * results together with the hash value of their position, so a probe
+ * touches one cache line and follows no pointers.  Positions are only
+ * identified by their hash value, as with HASH_SIGNATURES.
+ *
+ * An entry with routine_i_j_stackp == HASH_EMPTY_ENTRY is unused.
+ *
+ * The low bits of a stored hash value are the same for all entries
+ * in a bucket, since they choose the bucket.  They are used for the
+ * generation (the move) in which the entry was last used instead.
+ * Entries from older generations are replaced first.
+ */
+
+#define HASH_BUCKET_ENTRIES   4
+#define HASH_EMPTY_ENTRY      0xffffffffU
+#define HASH_GENERATION_MASK  0xff
+#define HASH_MIN_BUCKETS      (HASH_GENERATION_MASK + 1)
+
+#define hash_entry_generation(entry) \
+	((int) ((entry).hashval & HASH_GENERATION_MASK))
+#define hash_entry_matches(entry, hash) \
+	((((entry).hashval ^ (hash)) & ~(Hashvalue) HASH_GENERATION_MASK) == 0)
+
+typedef struct hash_entry_t {
+  Hashvalue      hashval;	/* Position the result belongs to. */
+  Read_result    result;
+} Hash_entry;
+
+typedef struct hash_bucket_t {
+  Hash_entry     entry[HASH_BUCKET_ENTRIES];
+} Hash_bucket;
+
+/*
+ * A Hashnode is only a handle to the position last searched for.
+ * It is valid until the next call of hashtable_search() or
+ * hashtable_enter_position().
+ */
+
+typedef struct hashnode_t {
+  Hashvalue      hashval;
+  Hash_bucket  * bucket;
+  int            generation;	/* Generation of the table */
+} Hashnode;
+
+typedef struct hashtable {
+  int            hashtablesize;	/* Number of buckets, a power of two */
+  Hash_bucket  * buckets;	/* Aligned to the size of a bucket */
+  void         * memory;	/* As returned by malloc() */
+  Hashnode       current;	/* Handle returned by searches */
+
+  int            generation;	/* Current generation */
+  int            board_size;	/* Board size when last cleared. */
 } Hashtable;
 
+#endif  /* HASH_BUCKETS */
+
 
 
 void          hash_init(void);
-unsigned long board_hash(board_t board[MAX_BOARD][MAX_BOARD], 
+Hashvalue     board_hash(board_t board[MAX_BOARD][MAX_BOARD], 
 			 int koi, int koj /*, int to_move */);
 void          board_to_position(board_t board[MAX_BOARD][MAX_BOARD], 
 				int koi, int koj, /* int to_move, */
@@ -198,14 +287,18 @@ void read_result_dump(Read_result *result, FILE *outfile);
 int         hashtable_init(Hashtable *table, 
 			   int tablesize, int num_nodes, int num_results);
 Hashtable * hashtable_new(int tablesize, int num_nodes, int num_results);
+Hashtable * hashtable_allocate(int memory);
+void        hashtable_free(Hashtable *table);
 void        hashtable_clear(Hashtable *table);
+void        hashtable_age(Hashtable *table);
+double      hashtable_pressure(Hashtable *table);
 
 Hashnode *  hashtable_enter_position(Hashtable *table,
-				     Hashposition *pos, unsigned long hash);
+				     Hashposition *pos, Hashvalue hash);
 void        hashtable_delete(Hashtable *table,
-			     Hashposition *pos, unsigned long hash);
+			     Hashposition *pos, Hashvalue hash);
 Hashnode *  hashtable_search(Hashtable *table, 
-			     Hashposition *pos, unsigned long hash);
+			     Hashposition *pos, Hashvalue hash);
 void        hashtable_dump(Hashtable *table, FILE *outfile);
 
 Read_result *  hashnode_search(Hashnode *node, int routine, int i, int j);
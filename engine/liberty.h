@@ -40,10 +40,29 @@
  * One day, the public stuff will get moved into a separate file
  */
 
+/* ENGINE_LOCAL marks the variables which make up the state of one
+ * engine, i.e. the position and everything computed from it. With
+ * ENGINE_THREADS each thread has its own copy of these, so that
+ * several engines can work in one process (see context.c). Options
+ * and output settings are shared by all threads.
+ */
+
+#if ENGINE_THREADS
+#ifdef _MSC_VER
+#define ENGINE_LOCAL __declspec(thread)
+#else
+#define ENGINE_LOCAL __thread
+#endif
+#else
+#define ENGINE_LOCAL
+#endif
+
 #ifdef BUILDING_GNUGO_ENGINE
 #define PUBLIC_VARIABLE extern
+#define ENGINE_VARIABLE extern ENGINE_LOCAL
 #else
 #define PUBLIC_VARIABLE extern const
+#define ENGINE_VARIABLE extern ENGINE_LOCAL const
 #endif
 
 
@@ -64,6 +83,21 @@
 #define OTHER_COLOR(color)  (WHITE+BLACK-(color))
 
 
+/* The one-dimensional board. Intersection (i, j) is board[POS(i, j)],
+ * and the points around the board are GRAY_BORDER, so the neighbors
+ * pos+delta[k] of a point on the board can be looked at without
+ * checking the coordinates. The rows share one border column.
+ */
+
+#define NS           (MAX_BOARD + 1)      /* one row down */
+#define WE           1                    /* one column right */
+#define BOARDMIN     (MAX_BOARD + 2)      /* POS(0, 0) */
+#define BOARDMAX     ((MAX_BOARD + 1) * (MAX_BOARD + 2) + 1)
+#define POS(i, j)    (BOARDMIN + (i) * NS + (j))
+#define I(pos)       ((pos) / NS - 1)
+#define J(pos)       ((pos) % NS - 1)
+
+
 #define DEAD 0
 #define ALIVE 1
 #define CRITICAL 2 
@@ -130,6 +164,43 @@ int genmove(int *i,int *j, int color);
 int legal(int i, int j, int color);  /* can "color" play at i,j */
 int sethand(int i);  /* fill board with handicap stones */
 int updateboard(int i, int j, int color);  /* make a move and remove prisoners */
+
+double gg_gettimeofday(void);  /* wall clock time in seconds */
+
+/* time control (see clock.c) */
+void clock_settings(int main_secs, int byo_secs, int byo_stones);
+void clock_time_left(int color, int seconds, int stones);
+void clock_spent(int color, double seconds);
+int clock_time_budget(int color);
+int clock_depth_offset(int color);
+
+/* exercise the board code for benchmarking (--boardbench) */
+int exercise_trymove(void);
+int exercise_approxlib(void);
+
+/* the same functions working on an engine context (see context.c) */
+struct engine_context;
+struct engine_context *engine_context_new(int boardsize, int memory);
+void engine_context_free(struct engine_context *ctx);
+void engine_context_enter(struct engine_context *ctx);
+void engine_context_leave(struct engine_context *ctx);
+void engine_context_copy(struct engine_context *ctx);
+int context_genmove(struct engine_context *ctx, int *i, int *j, int color);
+int context_legal(struct engine_context *ctx, int i, int j, int color);
+int context_updateboard(struct engine_context *ctx, int i, int j, int color);
+
+/* start threads for reading (see threads.c) */
+int start_reading_threads(int threads, int memory);
+
+/* read ahead while the opponent thinks (see ponder.c) */
+int start_ponder_thread(void);
+void start_pondering(int color);
+void stop_pondering(void);
+void ponder_reply(int i, int j);
+int pondered_move(int *i, int *j, int color, int *val);
+extern ENGINE_LOCAL int pondering;      /* set in the pondering thread */
+extern volatile int ponder_cancelled;   /* asks it to stop */
+
 void remove_string(int i, int j);
 void remove_stone(int i, int j);
 void count_territory(int *white_territory, int *black_territory);
@@ -172,30 +243,96 @@ struct dragon_data {
 #include "hash.h"
 
 
+/* The phases of genmove(), timed in stats.phase_time[]. */
+#define PHASE_WORMS       0
+#define PHASE_DRAGONS     1
+#define PHASE_MOYO        2
+#define PHASE_FUSEKI      3
+#define PHASE_SEMEAI      4
+#define PHASE_SHAPES      5
+#define PHASE_ATTACKER    6
+#define PHASE_DEFENDER    7
+#define PHASE_EYE_FINDER  8
+#define NUM_PHASES        9
+
+/* The checks of matchpat(), counted in stats.matcher[]. MATCH_TRIED
+ * counts the pattern rotations tried, and the others those which
+ * passed the anchor color, the grid, the edges, the elements and the
+ * autohelper, so the difference of two is the number rejected. The
+ * autohelper is checked by the callback, so MATCH_HELPER leaves out
+ * the matches the callback rejects before it gets that far.
+ */
+#define MATCH_TRIED       0
+#define MATCH_ANCHOR      1
+#define MATCH_GRID        2
+#define MATCH_EDGE        3
+#define MATCH_ELEMENTS    4
+#define MATCH_HELPER      5
+#define NUM_MATCH_STAGES  6
+
+/* The calls of safe_move() are counted per stackp, the deeper ones
+ * under the last.
+ */
+#define STATS_DEPTHS      16
+
+/* The reading routines counted in stats.read_lookups[], see reading.c. */
+#define NUM_READ_ROUTINES 9
+
+struct stats_data {
+  int  nodes;			  /* Number of visited nodes while reading */
+  int  position_entered;	  /* Number of Positions entered. */
+  int  read_result_entered;	  /* Number of Read_results entered. */
+  int  position_hits;		  /* Number of hits of Positions. */
+  int  read_result_hits;	  /* Number of hits of Read_results */
+  int  read_result_lookups;	  /* Number of searches for Read_results */
+  int  read_result_replaced;	  /* Number of Read_results overwritten */
+  int  read_result_shallow;	  /* Number read with a lower depth */
+  int  deepening_calls;		  /* Calls of iterative_reading() */
+  int  deepening_iterations;	  /* and the iterations they made */
+  int  budget_cutoffs;		  /* attack() calls cut off by the budget */
+  int  matcher[NUM_MATCH_STAGES]; /* Pattern rotations past each check */
+  int  safe_move_lookups[STATS_DEPTHS]; /* Calls of safe_move() */
+  int  safe_move_hits[STATS_DEPTHS];    /* Of those answered from a cache */
+  int  read_lookups[NUM_READ_ROUTINES]; /* Lookups of each reading routine */
+  int  read_hits[NUM_READ_ROUTINES];    /* and hits */
+  double phase_time[NUM_PHASES];  /* Seconds spent in each phase */
+};
+
+extern const char *const phase_name[NUM_PHASES];
+
+
 /* other modules get read-only access to these variables */
 
-PUBLIC_VARIABLE board_t p[MAX_BOARD][MAX_BOARD];  /* go board */
-PUBLIC_VARIABLE int ko_i;
-PUBLIC_VARIABLE int ko_j;
+ENGINE_VARIABLE board_t p[MAX_BOARD][MAX_BOARD];  /* go board */
+ENGINE_VARIABLE board_t board[BOARDMAX];          /* p[][] with a border */
+ENGINE_VARIABLE int ko_i;
+ENGINE_VARIABLE int ko_j;
 
-PUBLIC_VARIABLE Hash_data  hashdata;
+ENGINE_VARIABLE Hash_data  hashdata;
 
-PUBLIC_VARIABLE unsigned char potential_moves[MAX_BOARD][MAX_BOARD];
+ENGINE_VARIABLE unsigned char potential_moves[MAX_BOARD][MAX_BOARD];
 
-PUBLIC_VARIABLE int board_size;            /* board size (usually 19) */
-PUBLIC_VARIABLE int movenum;               /* movenumber */
-PUBLIC_VARIABLE int black_captured, white_captured;   /* num. of black and white stones captured */
+ENGINE_VARIABLE int board_size;            /* board size (usually 19) */
+ENGINE_VARIABLE int movenum;               /* movenumber */
+ENGINE_VARIABLE int black_captured, white_captured;   /* num. of black and white stones captured */
 PUBLIC_VARIABLE int verbose;               /* bore the opponent */
 PUBLIC_VARIABLE int debug;                 /* debug flags */
-PUBLIC_VARIABLE int last_move_i;           /* The position of the last move */
-PUBLIC_VARIABLE int last_move_j;           /* -""-                          */
-PUBLIC_VARIABLE int terri_eval[3];
-PUBLIC_VARIABLE int moyo_eval[3];
-PUBLIC_VARIABLE struct dragon_data dragon[MAX_BOARD][MAX_BOARD];
-PUBLIC_VARIABLE int hashflags;             /* hash flags */
-PUBLIC_VARIABLE  struct hashtable  * movehash;
+ENGINE_VARIABLE int last_move_i;           /* The position of the last move */
+ENGINE_VARIABLE int last_move_j;           /* -""-                          */
+ENGINE_VARIABLE int terri_eval[3];
+ENGINE_VARIABLE int moyo_eval[3];
+ENGINE_VARIABLE struct dragon_data dragon[MAX_BOARD][MAX_BOARD];
+ENGINE_VARIABLE int hashflags;             /* hash flags */
+PUBLIC_VARIABLE int adaptive_hashflags;    /* let adapt_hashflags() change them */
+PUBLIC_VARIABLE int read_node_budget;      /* iterative deepening of worms, */
+PUBLIC_VARIABLE int read_time_budget;      /* nodes and ms per call, 0 = off */
+PUBLIC_VARIABLE int move_ordering;         /* killer and history heuristics */
+PUBLIC_VARIABLE int move_node_budget;      /* reading nodes and ms for */
+PUBLIC_VARIABLE int move_time_budget;      /* each genmove(), 0 = no limit */
+ENGINE_VARIABLE  struct hashtable  * movehash;
 PUBLIC_VARIABLE  char *analyzerfile;
 PUBLIC_VARIABLE  int style;
+ENGINE_VARIABLE struct stats_data stats;   /* reading statistics of last genmove */
 
 extern volatile int time_to_die;   /* set by signal handlers */
 
@@ -229,8 +366,12 @@ extern volatile int time_to_die;   /* set by signal handlers */
 #define HASH_ATTACK2      0x0020
 #define HASH_ATTACK3      0x0040
 #define HASH_DEFEND4      0x0080
+#define HASH_SAFE_MOVE    0x0100
 #define HASH_ALL          0xffff
 
+extern const char *const read_routine_name[NUM_READ_ROUTINES];
+void adapt_hashflags(void);  /* after each move if adaptive_hashflags */
+
 #define MEMORY 8
 
 void init_board(void);
@@ -279,6 +420,28 @@ int attack(int m, int n, int *i, int *j);
 #define MAXCHAIN 160
 
 
+/* sets of intersections, one word for each row (see bitboard.c) */
+typedef struct {
+  unsigned int row[MAX_BOARD];
+} Bitboard;
+
+#define BB_MASK(j)         (1U << (j))
+#define BB_TEST(b, i, j)   ((b)->row[i] & BB_MASK(j))
+#define BB_SET(b, i, j)    ((b)->row[i] |= BB_MASK(j))
+#define BB_CLEAR(b, i, j)  ((b)->row[i] &= ~BB_MASK(j))
+
+void bitboard_clear(Bitboard *b);
+void bitboard_fill(Bitboard *b);
+void bitboard_or(Bitboard *a, const Bitboard *b);
+void bitboard_and(Bitboard *a, const Bitboard *b);
+void bitboard_andnot(Bitboard *a, const Bitboard *b);
+void bitboard_dilate(Bitboard *out, const Bitboard *in);
+void bitboard_neighbors(Bitboard *out, const Bitboard *in);
+void bitboard_flood(Bitboard *out, int i, int j, const Bitboard *region);
+int bitboard_count(const Bitboard *b);
+int bitboard_points(const Bitboard *b, int max, int pi[], int pj[]);
+
+
 /* board utility fns */
 
 /* Really an interal fn, but exposed for efficiency.
@@ -286,8 +449,7 @@ int attack(int m, int n, int *i, int *j);
  * Needs mx[][] initialised. Does not reset lib / size.
  */
 
-int count(int i, int j, int color, char mx[MAX_BOARD][MAX_BOARD], int maxlib,
-	  char mark);
+int count(int i, int j, int color, char mx[BOARDMAX], int maxlib, char mark);
 
 void find_origin(int i, int j, int *origini, int *originj);
 void chainlinks(int m, int n, int *adj, int adji[MAXCHAIN],
@@ -296,7 +458,23 @@ void chainlinks(int m, int n, int *adj, int adji[MAXCHAIN],
 
 int approxlib(int m, int n, int color, int maxlib);  /* count up to maxlib liberties at i,j to lib and size. */
 
-#define countlib(i,j,c)  approxlib( (i), (j), (c), 9999) /* Helpful wrapper round approxlib() */
+/* string table, kept up to date by updateboard() and popgo() */
+extern const int delta[4];       /* north, south, west and east in board[] */
+
+void strings_sync(void);
+void strings_push(void);
+void strings_pop(void);
+void strings_add_stone(int i, int j, int color);
+void strings_remove_string(int m, int n);
+int findstones(int m, int n, int si[], int sj[]);
+void string_origin(int i, int j, int *origini, int *originj);
+
+int fastlib(int i, int j, int color, int maxlib);  /* like approxlib(), but leaves lib, size, libi and libj alone */
+int countlib(int i, int j, int color);             /* fastlib() without a limit */
+int countstones(int i, int j);                     /* size of the string at i,j */
+int findlib(int i, int j, int color, int maxlib,   /* countlib(), storing up to */
+	    int libi[], int libj[]);               /* maxlib liberties row by row */
+void color_plane(int color, Bitboard *b);          /* points of color (or EMPTY) */
 
 #define TRANSFORM(i,j,ti,tj,trans) \
 do { \
@@ -315,11 +493,24 @@ int trysafe(int i, int j, int color, const char *message);
 void dump_stack(void);
 
 void compile_for_match(void);  /* must be called once before using matchpat */
+void build_merged_board(void);                     /* grids of board[] for matchpat, */
+void update_merged_board(int i, int j, int stone); /* kept up to date by strings.c */
+
+/* the ways matchpat() can check the elements of a pattern */
+#define ELEMENTS_SCALAR       0
+#define ELEMENTS_AVX2         1
+#define NUM_ELEMENT_CHECKERS  2
+extern const char *const element_checker_name[NUM_ELEMENT_CHECKERS];
+int element_checker_available(int checker);
+void time_element_checker(int checker, int rounds, double *seconds,
+			  double *checks, double *matches);
 
 struct pattern; /* keep gcc happy */
+struct pattern_db;
 /* try to match a pattern in the database to the board. Callback for each match */
 typedef void (*matchpat_callback_fn_ptr)(int m, int n, int color, struct pattern *, int rotation);
-void matchpat(int m, int n, matchpat_callback_fn_ptr callback, int color, int minwt, struct pattern *database);
+void matchpat(int m, int n, matchpat_callback_fn_ptr callback, int color, int minwt, struct pattern_db *database);
+int pattern_constraint(int m, int n, int color, struct pattern *pattern, int ll);
 
 int defend1(int si, int sj, int *i, int *j);
 int attack2(int si, int sj, int *i, int *j);
@@ -367,6 +558,37 @@ void endgame(void);
 
 int fuseki (int *i, int *j, int *val, int *equal_moves, int color);
 void init_fuseki(void);
+typedef struct {
+  int nb_stone;
+  int color;
+  int closed;
+  int kado;
+  int coord[4];
+} corner_status;
+struct fuseki_state {
+  int firstmove;
+  int corner_done;
+  int fuseki_ended;
+  corner_status angle[4];
+  corner_status short_angle[4];
+};
+void get_fuseki_state(struct fuseki_state *state);
+void set_fuseki_state(const struct fuseki_state *state);
+struct hashflags_state {
+  int flags;
+  int dropped;
+  int moves_since_drop;
+};
+void get_hashflags_state(struct hashflags_state *state);
+void set_hashflags_state(const struct hashflags_state *state);
+
+/* random numbers of the current context, rand() without one */
+int engine_random(void);
+
+/* readings shared between threads (see threads.c) */
+typedef void (*reading_job)(int k, void *data);
+int parallel_reading(int njobs, reading_job job, void *data);
+
 int semeai (int *i, int *j, int *val, int *equal_moves, int color);
 void small_semeai(void);
 void small_semeai_analyzer(int, int, int, int);
@@ -382,6 +604,13 @@ int fill_liberty(int *i, int *j, int *val, int color);
 int revise_semeai(int color);
 int find_lunch(int m, int n, int *wi, int *wj, int *ai, int *aj);
 int find_defense(int m, int n, int *ti, int *tj);
+int iterative_attack(int m, int n, int *i, int *j,
+		     int max_nodes, int max_msec);
+int iterative_find_defense(int m, int n, int *i, int *j,
+			   int max_nodes, int max_msec);
+void start_read_budget(int nodes, int msec);
+void get_read_budget(int *nodes, double *deadline);
+void set_read_budget(int nodes, double deadline);
 int string_value(int m, int n);
 int connection_value(int ai, int aj, int bi, int bj, int ti, int tj);
 void change_defense(int, int, int, int);
@@ -425,7 +654,7 @@ int marginal_eye_space(int i, int j);
 
 /* Macro to help keeping track of the best move, with equal probability
    for all moves of the same highest value. */
-#define BETTER_MOVE(new,best,q) ((best)>(new) ? 0 : (best) < (new) ? ((best)=(new),(q)=2) : rand()%((q)++) ? 0: 1 )
+#define BETTER_MOVE(new,best,q) ((best)>(new) ? 0 : (best) < (new) ? ((best)=(new),(q)=2) : engine_random()%((q)++) ? 0: 1 )
 
 /* The macro is functionally equivalent to the following function:
  * 
@@ -438,7 +667,7 @@ int marginal_eye_space(int i, int j);
  *     *equal_moves = 2;
  *     return 1;
  *   }
- *   else if (rand()%(*equal_moves) == 0) {
+ *   else if (engine_random()%(*equal_moves) == 0) {
  *     (*equal_moves)++;
  *     return 1;
  *   }
@@ -475,15 +704,15 @@ void sgf_dragon_status(int, int, int );
 
 /* globals variables */
 
-extern int lib;                              /* current stone liberty FIXME : written by count() */
-extern int libi[MAXLIBS], libj[MAXLIBS];     /* array of liberties found : filled by count() */
-extern int size;                  /* cardinality of a group : written by count() */
-extern int color_has_played;      /* color has placed a stone */
-extern int stackp;                /* stack pointer */
-extern int depth;                 /* deep reading cutoff */
-extern int backfill_depth;        /* deep reading cutoff */
-extern int fourlib_depth;         /* deep reading cutoff */
-extern int ko_depth;
+extern ENGINE_LOCAL int lib;                              /* current stone liberty FIXME : written by count() */
+extern ENGINE_LOCAL int libi[MAXLIBS], libj[MAXLIBS];     /* array of liberties found : filled by count() */
+extern ENGINE_LOCAL int size;                  /* cardinality of a group : written by count() */
+extern ENGINE_LOCAL int color_has_played;      /* color has placed a stone */
+extern ENGINE_LOCAL int stackp;                /* stack pointer */
+extern ENGINE_LOCAL int depth;                 /* deep reading cutoff */
+extern ENGINE_LOCAL int backfill_depth;        /* deep reading cutoff */
+extern ENGINE_LOCAL int fourlib_depth;         /* deep reading cutoff */
+extern ENGINE_LOCAL int ko_depth;
     
 /* FIXME : perhaps some of the following should be flag-bits in debug */
 
@@ -494,18 +723,8 @@ extern int printworms;            /* print full data on each string */
 extern int printmoyo;             /* print moyo board each move */
 extern int printdragons;          /* print full data on each dragon */
 extern int printboard;            /* print board each move */
-extern int count_variations;      /* count (decidestring) */
-extern int sgf_dump;              /* writing file (decidestring) */
-
-struct stats_data {
-  int  nodes;			  /* Number of visited nodes while reading */
-  int  position_entered;	  /* Number of Positions entered. */
-  int  read_result_entered;	  /* Number of Read_results entered. */
-  int  position_hits;		  /* Number of hits of Positions. */
-  int  read_result_hits;	  /* Number of hits of Read_results */
-};
-
-extern struct stats_data stats;
+extern ENGINE_LOCAL int count_variations;      /* count (decidestring) */
+extern ENGINE_LOCAL int sgf_dump;              /* writing file (decidestring) */
 
 struct half_eye_data {
   int type;         /* HALF_EYE or FALSE_EYE; */
@@ -513,7 +732,7 @@ struct half_eye_data {
   int kj;
 };
 
-extern struct half_eye_data half_eye[MAX_BOARD][MAX_BOARD];      /* array of half-eye data */
+extern ENGINE_LOCAL struct half_eye_data half_eye[MAX_BOARD][MAX_BOARD];      /* array of half-eye data */
 
 /* data concerning a worm. A copy is kept at each vertex of the worm */
 
@@ -541,7 +760,7 @@ struct worm_data {
   int inessential;   /* 1=inessential worm */
 };
 
-extern struct worm_data worm[MAX_BOARD][MAX_BOARD];
+extern ENGINE_LOCAL struct worm_data worm[MAX_BOARD][MAX_BOARD];
 
 struct eye_data {
   int color;           /* BLACK, WHITE, BLACK_BORDERED, WHITE_BORDERED or GRAY_BORDERED   */
@@ -563,8 +782,8 @@ struct eye_data {
   int cut;                  /* Opponent can cut at vertex.                */
 };
 
-extern struct eye_data white_eye[MAX_BOARD][MAX_BOARD];
-extern struct eye_data black_eye[MAX_BOARD][MAX_BOARD];
+extern ENGINE_LOCAL struct eye_data white_eye[MAX_BOARD][MAX_BOARD];
+extern ENGINE_LOCAL struct eye_data black_eye[MAX_BOARD][MAX_BOARD];
 
 /* the following declarations have to be postponed until after the definition of struct eye_data */
 
@@ -574,18 +793,18 @@ void add_half_eye(int m, int n, struct eye_data eye[MAX_BOARD][MAX_BOARD]);
 void retrofit_half_eye(int m, int n, int di, int dj);
 void retrofit_genus(int m, int n, int step);
 
-extern int distance_to_black[MAX_BOARD][MAX_BOARD];
-extern int distance_to_white[MAX_BOARD][MAX_BOARD];
-extern int strategic_distance_to_black[MAX_BOARD][MAX_BOARD];
-extern int strategic_distance_to_white[MAX_BOARD][MAX_BOARD];
-extern int black_domain[MAX_BOARD][MAX_BOARD];
-extern int white_domain[MAX_BOARD][MAX_BOARD];
+extern ENGINE_LOCAL int distance_to_black[MAX_BOARD][MAX_BOARD];
+extern ENGINE_LOCAL int distance_to_white[MAX_BOARD][MAX_BOARD];
+extern ENGINE_LOCAL int strategic_distance_to_black[MAX_BOARD][MAX_BOARD];
+extern ENGINE_LOCAL int strategic_distance_to_white[MAX_BOARD][MAX_BOARD];
+extern ENGINE_LOCAL int black_domain[MAX_BOARD][MAX_BOARD];
+extern ENGINE_LOCAL int white_domain[MAX_BOARD][MAX_BOARD];
 
 
 /* data concerning moyo */
-extern int terri_test[3];
-extern int moyo_test[3];
-extern int very_big_move[3];
+extern ENGINE_LOCAL int terri_test[3];
+extern ENGINE_LOCAL int moyo_test[3];
+extern ENGINE_LOCAL int very_big_move[3];
 
 /* our own abort() which prints board state on the way out.
  * i,j is a "relevant" board position for info */
@@ -29,9 +29,22 @@
 #include "liberty.h"
 #include "patterns.h"
 
+/* The vector element checker needs gcc's target attribute and the
+ * AVX2 intrinsics. Whether the processor has AVX2 is found out at
+ * run time.
+ */
+#if defined(__GNUC__) && __GNUC__ >= 5 && (defined(__x86_64__) || defined(__i386__))
+#define AVX2_CHECKER 1
+#include <immintrin.h>
+#else
+#define AVX2_CHECKER 0
+#endif
 
-/* define this to see how each phase of pattern rejection is performing */
-/* #define PROFILE_MATCHER */
+/* The elements of a rotation are padded to a multiple of
+ * ELEMENT_BLOCK with ATT_ANY elements, which match anything.
+ */
+#define ELEMENT_BLOCK 8
+#define ATT_ANY       8
 
 
 /* In the current implementation, the edge constraints depend on
@@ -44,8 +57,10 @@
  * make a first pass through the table once we know the board
  * size.
  *
- * This should be called once for each pattern database
- * (currently pat and conn).
+ * This is called for each pattern database (currently pat and
+ * conn) whenever the board size differs from the one the patterns
+ * were last fitted to, after restore_extents() has put back the
+ * extents written by mkpat.
  */
 
 static void
@@ -78,89 +93,255 @@ fixup_patterns_for_board_size(struct pattern *pattern)
 }  
 
 
-#ifdef PROFILE_MATCHER
-static int totals[6];
-#endif
+/* The extents of the patterns as written by mkpat, kept by
+ * save_extents() before they are first fixed up, so that the
+ * patterns can be fitted to another board size.
+ */
+
+static int *
+save_extents(struct pattern *patterns)
+{
+  struct pattern *pattern;
+  int *extents;
+  int *e;
+  int n = 0;
+
+  for (pattern = patterns; pattern->patn; ++pattern)
+    n++;
+  extents = malloc((4 * n + 1) * sizeof(int));
+  if (extents == NULL) {
+    fprintf(stderr, "gnugo: out of memory for the pattern extents\n");
+    exit(EXIT_FAILURE);
+  }
+
+  for (pattern = patterns, e = extents; pattern->patn; ++pattern) {
+    *e++ = pattern->mini;
+    *e++ = pattern->minj;
+    *e++ = pattern->maxi;
+    *e++ = pattern->maxj;
+  }
+  return extents;
+}
 
+static void
+restore_extents(struct pattern *patterns, const int *e)
+{
+  struct pattern *pattern;
 
-/* [i][j] contains merged entries from p[][] around i,j */
-static uint32 merged_board[2][MAX_BOARD][MAX_BOARD];
+  for (pattern = patterns; pattern->patn; ++pattern) {
+    pattern->mini = *e++;
+    pattern->minj = *e++;
+    pattern->maxi = *e++;
+    pattern->maxj = *e++;
+  }
+}
+
+
+#if GRID_OPT > 0
 
-/* This combines the values in p[][] around each point, to allow 
- * rapid rejection of patterns. Must be called once per board position,
- * before matchpat is invoked.
+/* [i][j] contains merged entries from board[] around i,j */
+static ENGINE_LOCAL uint64 merged_board[2][MAX_BOARD][MAX_BOARD];
+
+/* This combines the values in board[] around each point, to allow
+ * rapid rejection of patterns. The entry for (m,n) holds the 5x5
+ * grid centred on (m,n), with the point at offset (di,dj) at bit
+ * 24 - 10*di - 2*dj as in mkpat. It is called by strings.c whenever
+ * board[] is built from scratch. After that, update_merged_board()
+ * keeps the grids in step with every change of board[], and the
+ * changes are undone by popgo() along with the board, so matchpat()
+ * can use them at any stack level.
  */
 
-void 
-compile_for_match()
+void
+build_merged_board(void)
 {
-  int i,j,color;
-  static int been_here=0;
+  int m, n;
+  int di, dj;
 
-  if (!been_here) {
-    fixup_patterns_for_board_size(pat);
-    fixup_patterns_for_board_size(conn);
-    been_here=1;
+  memset(merged_board, 0, sizeof(merged_board));
+
+  /* First write in the illegal 'color' %11 for each location off
+   * the board. This stops a pattern requiring spaces from matching
+   * near the edge.
+   */
+  for (m=0; m<board_size; ++m)
+    for (n=0; n<board_size; ++n)
+      for (di=-2; di<=2; ++di)
+	for (dj=-2; dj<=2; ++dj)
+	  if (m+di < 0 || m+di >= board_size
+	      || n+dj < 0 || n+dj >= board_size) {
+	    merged_board[0][m][n] |= (uint64) 3 << (24 - 10*di - 2*dj);
+	    merged_board[1][m][n] |= (uint64) 3 << (24 - 10*di - 2*dj);
+	  }
+
+  for (m=0; m<board_size; ++m)
+    for (n=0; n<board_size; ++n)
+      if (board[POS(m, n)] != EMPTY)
+	update_merged_board(m, n, board[POS(m, n)]);
+}
+
+
+/* A stone of the given color has been placed at (i,j) or removed
+ * from there. Since the point is empty either before or after, the
+ * change toggles the same bits in each of the 25 grids which cover
+ * it, so one function serves for both.
+ */
+
+void
+update_merged_board(int i, int j, int stone)
+{
+  /* mkpat prepares all the grid entries of the pattern assuming
+   * color==1. For the other color, we swap the colors on the board.
+   */
+  uint64 this = stone;
+  uint64 swapped = OTHER_COLOR(stone);
+  int mmin = i > 1 ? i-2 : 0;
+  int mmax = i < board_size-2 ? i+2 : board_size-1;
+  int nmin = j > 1 ? j-2 : 0;
+  int nmax = j < board_size-2 ? j+2 : board_size-1;
+  int m, n;
+
+  /* (i,j) is at offset (i-m,j-n) from the anchor (m,n). */
+  for (m = mmin; m <= mmax; ++m)
+    for (n = nmin; n <= nmax; ++n) {
+      int shift = 24 - 10*(i-m) - 2*(j-n);
+
+      merged_board[0][m][n] ^= this << shift;
+      merged_board[1][m][n] ^= swapped << shift;
+    }
+}
+
+#endif /* GRID_OPT > 0 */
+
+
+/* Must be called once per board position, before matchpat is
+ * invoked at stackp == 0.
+ */
+
+#define PADDED_LENGTH(patlen) \
+  (((patlen) + ELEMENT_BLOCK - 1) / ELEMENT_BLOCK * ELEMENT_BLOCK)
+
+static void select_element_checker(void);
+
+/* Transform the extents of every rotation of every pattern in the
+ * database, after they have been fixed up for the board size.
+ */
+
+static void
+rotate_extents(struct pattern_db *database)
+{
+  struct pattern *pattern;
+  struct pattern_rotation *r = database->rotations;
+  int ll;
+
+  for (pattern = database->patterns; pattern->patn; ++pattern)
+    for (ll = 0; ll < 8; ++ll, ++r) {
+      int mi,mj,xi,xj;
+
+      TRANSFORM(pattern->mini, pattern->minj, &mi, &mj, ll);
+      TRANSFORM(pattern->maxi, pattern->maxj, &xi, &xj, ll);
+
+      /* transformed {m,x}{i,j} are arbitrary corners - 
+	 Find top-left and bot-right. */
+      if (xi < mi) { int xx = mi; mi = xi ; xi = xx; }
+      if (xj < mj) { int xx = mj; mj = xj ; xj = xx; }
+      r->mini = mi;
+      r->minj = mj;
+      r->maxi = xi;
+      r->maxj = xj;
+    }
+}
+
+
+/* Transform every rotation of every pattern in the database once
+ * into database->rotations[8*i + ll]. The extents, which depend on
+ * the board size, are filled in by rotate_extents().
+ */
+
+static void
+compile_rotations(struct pattern_db *database)
+{
+  struct pattern *pattern;
+  struct pattern_rotation *r;
+  int *deltas;
+  unsigned char *atts;
+  int patterns = 0;
+  int elements = 0;
+  int ll, k;
+
+  for (pattern = database->patterns; pattern->patn; ++pattern) {
+    patterns++;
+    elements += PADDED_LENGTH(pattern->patlen);
   }
 
+  database->rotations = malloc(8 * patterns * sizeof(*database->rotations));
+  deltas = malloc((8 * elements + 1) * sizeof(int));
+  atts = malloc(elements + 1);
+  if (database->rotations == NULL || deltas == NULL || atts == NULL) {
+    fprintf(stderr, "gnugo: out of memory for the pattern rotations\n");
+    exit(EXIT_FAILURE);
+  }
 
-#ifdef PROFILE_MATCHER
-  fprintf(stderr, 
-	  "total %d, anchor=%d, grid=%d, edge=%d, matched=%d, accepted=%d\n",
-	  totals[0], totals[1], totals[2], totals[3], totals[4], totals[5]);
-#endif
+  r = database->rotations;
+  for (pattern = database->patterns; pattern->patn; ++pattern) {
+    for (k = 0; k < PADDED_LENGTH(pattern->patlen); ++k)
+      atts[k] = k < pattern->patlen ? pattern->patn[k].att : ATT_ANY;
 
+    for (ll = 0; ll < 8; ++ll, ++r) {
+      TRANSFORM(pattern->movei, pattern->movej, &r->movei, &r->movej, ll);
 
-#if GRID_OPT > 0
-  memset(merged_board, 0, sizeof(merged_board));
-  for (color=0; color<2; ++color) {
-    for (i=0; i<board_size; ++i) {
-      for (j=0; j<board_size; ++j) {
-	uint32 this = p[i][j];  /* colour here */
-	int ii;
-	int shift=0;
-
-	if (!p[i][j])
-	  continue;
-
-	/* mkpat prepares all the grid entries of the pattern assuming
-	 * color==1. If this is not true, we swap all the colors on the
-	 * board as we merge.
-	 */
-	if (this != EMPTY && color != 0)
-	  this = OTHER_COLOR(this);
-	  
-	for (shift=0, ii = i-2; ii <= i+1 ; ++ii, shift += 8) {
-	  if (ii < 0 || ii >= board_size)
-	    continue;
-	    
-	  /* Add this one into all the nearby merged_board[][] elements. */
-	  if (j > 1)  merged_board[color][ii][j-2] |= this << (shift+0);
-	  if (j > 0)  merged_board[color][ii][j-1] |= this << (shift+2);
-	  merged_board[color][ii][j]               |= this << (shift+4);
-	  if (j < board_size-1) 
-	    merged_board[color][ii][j+1] |= this << (shift+6);
-	}
+      r->atts = atts;
+      r->deltas = deltas;
+      for (k = 0; k < PADDED_LENGTH(pattern->patlen); ++k) {
+	int di = 0, dj = 0;
+
+	if (k < pattern->patlen)
+	  TRANSFORM(pattern->patn[k].x, pattern->patn[k].y, &di, &dj, ll);
+	*deltas++ = di * NS + dj * WE;
       }
     }
-  
-    /* Now go over the positions near the edge, and write in illegal
-     * 'color' %11 for each location off the board. This stops a pattern
-     * requiring spaces from matching near the edge.
-     */
+    atts += PADDED_LENGTH(pattern->patlen);
+  }
+}
 
-    for (i=0; i<board_size; ++i) {
-      merged_board[color][0][i]            |= 0xff000000;
-      merged_board[color][board_size-2][i] |= 0x000000ff;
-      merged_board[color][board_size-1][i] |= 0x0000ffff;
-      
-      merged_board[color][i][0]  |= 0xc0c0c0c0;
-      merged_board[color][i][board_size-2] |= 0x03030303;
-      merged_board[color][i][board_size-1] |= 0x0f0f0f0f;
-    }
+
+/* The patterns are fitted to the board size of the first call, and
+ * fitted again when a later call has another board size, as when
+ * --mode batch or a GTP boardsize command changes it. No other
+ * thread may be matching patterns then.
+ */
+
+void 
+compile_for_match()
+{
+  static int been_here=0;
+  static int fitted_board_size=0;
+  static int *pat_extents;
+  static int *conn_extents;
+
+  if (!been_here) {
+    pat_extents = save_extents(pat);
+    conn_extents = save_extents(conn);
+    compile_rotations(&pat_db);
+    compile_rotations(&conn_db);
+    select_element_checker();
+    been_here=1;
   }
 
-#endif
+  if (fitted_board_size != board_size) {
+    restore_extents(pat, pat_extents);
+    restore_extents(conn, conn_extents);
+    fixup_patterns_for_board_size(pat);
+    fixup_patterns_for_board_size(conn);
+    rotate_extents(&pat_db);
+    rotate_extents(&conn_db);
+    fitted_board_size = board_size;
+  }
+
+  /* The grids follow board[], which only needs to be brought up to
+   * date with p[] at stackp == 0.
+   */
+  strings_sync();
 }
 
 
@@ -209,262 +390,605 @@ offset(int i, int j, int basei, int basej, int *ti, int *tj, int trans)
 }
 
 
-/* 
- * Try all the patterns in the given array at (m,n). Invoke the callback
- * for any that matches.  Classes X,O,x,o are checked here, as is the
- * autohelper. It is up to the callback to process the other classes,
- * and any helper functions.
+/* If allpats=0, only patterns potentially larger than the largest
+ * yet found are considered. This speeds the program up.
+ * Generating all patterns gives useful information while tuning
+ * the pattern database. We use the maxwt field in the pattern
+ * database to decide whether we need to consider a pattern. 
+ * If there is a helper function involved, the maximum weight has
+ * to be entered into the patterns.db file. The code will assert
+ * that the weight returned is never higher than maxwt.
+ */
+/* jd  I added a little hack to have more pattern considered when the
+ *     style fearless is enabled, thus with this option, a pattern
+ *     must have a maxwt 10 points lower than minwt to be discarded.
+ */       
+
+static int
+pattern_considered(struct pattern *pattern, int minwt)
+{
+  return (allpats || (pattern->maxwt >= minwt) ||
+	  (pattern->class & (CLASS_D | CLASS_A)) ||
+	  (pattern->class & (CLASS_B | CLASS_C)) ||
+	  (pattern->class & (CLASS_L)) ||
+	  (style & STY_FEARLESS && minwt < 75 && pattern->maxwt + 10 >= minwt));
+}
+
+
+/* Precomuted tables to allow rapid checks on the piece at
+ * the board. This table relies on the fact that color is
+ * 1 or 2.
+ *
+ * For pattern element i,  require  (p[m][n] & andmask[i]) == valmask[i]
+ *
+ * .XO) For i=0,1,2,  p[m][n] & 3 is a no-op, so we check p[][] == valmask
+ * x)   For i=3, we are checking that p[][] is not color, so AND color and
+ *      we get 0 for either empty or OTHER_COLOR, but color if it contains
+ *      color
+ * o)   Works the other way round for checking it is not X.
+ *
+ *
+ *  gcc allows the entries to be computed at run-time, but that is not ANSI.
+ */
+ 
+static const int and_mask[2][8] = {
+  /*  .      X      O     x      o      h      a      !         color */ 
+  {   3,     3,     3,  WHITE, BLACK, WHITE,   3,   WHITE }, /* BLACK */
+  {   3,     3,     3,  BLACK, WHITE, BLACK,   3,   BLACK }  /* WHITE */
+};
+
+static const int val_mask[2][8] = {
+  { EMPTY, BLACK, WHITE,  0,     0,     0,   EMPTY,   0  },  /* BLACK */ 
+  { EMPTY, WHITE, BLACK,  0,     0,     0,   EMPTY,   0  }   /* WHITE */
+};
+
+
+/* and a table for checking classes quickly
+ * class_mask[status][color] contains the mask to look for in class.
+ * ie. if  pat[r].class & class_mask[dragon[x][y].status][p[x][y]]
+ * is not zero then we reject it
+ * Most elements if class_mask[] are zero - it is a sparse
+ * matrix containing
+ *  CLASS_O in [DEAD][color]
+ *  CLASS_o in [ALIVE][color]
+ *  CLASS_X in [DEAD][other]
+ *  CLASS_x in [ALIVE][other]
+ *
+ * so eg. if we have a dead white dragon, and we
+ * are checking a pattern for black, then
+ *  class_mask[DEAD][other]  will contain CLASS_X
+ * Then we reject any patterns which have CLASS_X
+ * set in the class bits.
+ *
+ * Making it static guarantees that all fields are
+ * initially set to 0, and matchpat() overwrites the ones
+ * we care about each time.
+ */
+  
+static ENGINE_LOCAL int class_mask[MAX_DRAGON_STATUS][3];
+
+
+/* The elements of a rotation at the anchor (a position in board[])
+ * are checked by one of these, which return 1 if all of them match.
+ * The scalar loop works everywhere. On x86 processors with AVX2,
+ * the cells of eight elements at a time are gathered from board[]
+ * and masked and compared in one go. The checker is picked at run
+ * time by select_element_checker(), and the class checks are done
+ * separately by match_rotation().
+ */
+
+typedef int (*element_checker_fn)(const struct pattern *pattern,
+				  const struct pattern_rotation *r,
+				  int anchor, int color);
+
+const char *const element_checker_name[NUM_ELEMENT_CHECKERS] = {
+  "scalar", "avx2"
+};
+
+static int
+check_elements_scalar(const struct pattern *pattern,
+		      const struct pattern_rotation *r, int anchor, int color)
+{
+  const int *amask = and_mask[color-1];
+  const int *vmask = val_mask[color-1];
+  int k;
+
+  for (k = 0; k < pattern->patlen; ++k) {
+    int att = r->atts[k];  /* what we are looking for */
+
+    if ((board[anchor + r->deltas[k]] & amask[att]) != vmask[att])
+      return 0;
+  }
+  return 1;
+}
+
+
+#if AVX2_CHECKER
+
+/* and_mask[] and val_mask[] as byte tables for the shuffle, with
+ * zeros from ATT_ANY on
+ */
+static unsigned char and_bytes[2][16];
+static unsigned char val_bytes[2][16];
+
+__attribute__((target("avx2")))
+static int
+check_elements_avx2(const struct pattern *pattern,
+		    const struct pattern_rotation *r, int anchor, int color)
+{
+  const __m128i amask = _mm_loadu_si128((const __m128i *) and_bytes[color-1]);
+  const __m128i vmask = _mm_loadu_si128((const __m128i *) val_bytes[color-1]);
+  /* Each lane loads the four bytes which end at its cell, so nothing
+   * past the end of board[] is read. The cell is the top byte.
+   */
+  const int *base = (const int *) (board + anchor - 3);
+  int k;
+
+  for (k = 0; k < pattern->patlen; k += ELEMENT_BLOCK) {
+    __m256i deltas = _mm256_loadu_si256((const __m256i *) (r->deltas + k));
+    __m256i cells = _mm256_srli_epi32(_mm256_i32gather_epi32(base, deltas, 1),
+				      24);
+    __m128i atts = _mm_loadl_epi64((const __m128i *) (r->atts + k));
+    __m256i a = _mm256_cvtepu8_epi32(_mm_shuffle_epi8(amask, atts));
+    __m256i v = _mm256_cvtepu8_epi32(_mm_shuffle_epi8(vmask, atts));
+
+    if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_and_si256(cells, a), v))
+	!= -1)
+      return 0;
+  }
+  return 1;
+}
+
+#endif /* AVX2_CHECKER */
+
+
+static const element_checker_fn element_checkers[NUM_ELEMENT_CHECKERS] = {
+  check_elements_scalar,
+#if AVX2_CHECKER
+  check_elements_avx2
+#else
+  NULL
+#endif
+};
+
+static element_checker_fn check_elements = check_elements_scalar;
+
+
+/* Is the checker compiled in and supported by the processor? */
+
+int
+element_checker_available(int checker)
+{
+  assert(checker >= 0 && checker < NUM_ELEMENT_CHECKERS);
+#if AVX2_CHECKER
+  if (checker == ELEMENTS_AVX2)
+    return __builtin_cpu_supports("avx2");
+#endif
+  return element_checkers[checker] != NULL;
+}
+
+
+/* Use the fastest checker available. */
+
+static void
+select_element_checker(void)
+{
+#if AVX2_CHECKER
+  int color, att;
+
+  for (color = 0; color < 2; color++)
+    for (att = 0; att < ATT_ANY; att++) {
+      and_bytes[color][att] = and_mask[color][att];
+      val_bytes[color][att] = val_mask[color][att];
+    }
+#endif
+
+  if (element_checker_available(ELEMENTS_AVX2))
+    check_elements = element_checkers[ELEMENTS_AVX2];
+  else
+    check_elements = element_checkers[ELEMENTS_SCALAR];
+}
+
+
+/*
+ * A micro-benchmark for gnugo-bench: run the checker rounds times on
+ * every rotation of every pattern in patterns.db which fits on the
+ * board at each point of the current position, for both colors.
+ * Gives the time taken, the number of rotations checked and the
+ * number which matched.
  */
 
 void
-matchpat(int m, int n, matchpat_callback_fn_ptr callback, int color,
-	 int minwt, struct pattern *pattern) 
+time_element_checker(int checker, int rounds, double *seconds,
+		     double *checks, double *matches)
 {
-  int other = OTHER_COLOR(color);
-  int ll;   /* Iterate over transformations (rotations or reflections)  */
+  element_checker_fn check = element_checkers[checker];
+  struct pattern *pattern;
+  int round, m, n, color, ll;
+  double start;
+
+  assert(element_checker_available(checker));
+  compile_for_match();
+
+  *checks = 0;
+  *matches = 0;
+  start = gg_gettimeofday();
+  for (round = 0; round < rounds; round++)
+    for (m = 0; m < board_size; m++)
+      for (n = 0; n < board_size; n++)
+	for (color = WHITE; color <= BLACK; color++)
+	  for (pattern = pat_db.patterns; pattern->patn; ++pattern)
+	    for (ll = 0; ll < pattern->trfno; ll++) {
+	      const struct pattern_rotation *r = pat_db.rotations
+		+ 8*(pattern - pat_db.patterns) + ll;
+
+	      if (m + r->mini < 0 || m + r->maxi > board_size-1
+		  || n + r->minj < 0 || n + r->maxj > board_size-1)
+		continue;
+	      ++*checks;
+	      *matches += check(pattern, r, POS(m, n), color);
+	    }
+  *seconds = gg_gettimeofday() - start;
+}
+
+
+/*
+ * Try rotation ll of the pattern at (m,n), once it has passed the
+ * checks of the anchor and the grid. r is the rotation, as compiled
+ * by compile_rotations(). Invoke the callback if it matches.
+ */
+
+static void
+match_rotation(int m, int n, matchpat_callback_fn_ptr callback, int color,
+	       struct pattern *pattern, int ll,
+	       const struct pattern_rotation *r)
+{
+  int anchor = POS(m, n);
   int k;    /* Iterate over elements of pattern */
 
-  /* Precomuted tables to allow rapid checks on the piece at
-   * the board. This table relies on the fact that color is
-   * 1 or 2.
-   *
-   * For pattern element i,  require  (p[m][n] & andmask[i]) == valmask[i]
-   *
-   * .XO) For i=0,1,2,  p[m][n] & 3 is a no-op, so we check p[][] == valmask
-   * x)   For i=3, we are checking that p[][] is not color, so AND color and
-   *      we get 0 for either empty or OTHER_COLOR, but color if it contains
-   *      color
-   * o)   Works the other way round for checking it is not X.
-   *
-   *
-   *  gcc allows the entries to be computed at run-time, but that is not ANSI.
+  DEBUG(DEBUG_MATCHER, "---\nconsidering pattern '%s', rotation %d at %m. Range %d,%d -> %d,%d\n",
+	pattern->name, ll, m,n, r->mini, r->minj, r->maxi, r->maxj);
+
+  /* Next, we do the range check. This applies the edge
+   * constraints implicitly.
    */
- 
-  static const int and_mask[2][8] = {
-    /*  .      X      O     x      o      h      a      !         color */ 
-    {   3,     3,     3,  WHITE, BLACK, WHITE,   3,   WHITE }, /* BLACK */
-    {   3,     3,     3,  BLACK, WHITE, BLACK,   3,   BLACK }  /* WHITE */
-  };
-
-  static const int val_mask[2][8] = {
-    { EMPTY, BLACK, WHITE,  0,     0,     0,   EMPTY,   0  },  /* BLACK */ 
-    { EMPTY, WHITE, BLACK,  0,     0,     0,   EMPTY,   0  }   /* WHITE */
-  };
-
-
-  /* and a table for checking classes quickly
-   * class_mask[status][color] contains the mask to look for in class.
-   * ie. if  pat[r].class & class_mask[dragon[x][y].status][p[x][y]]
-   * is not zero then we reject it
-   * Most elements if class_mask[] are zero - it is a sparse
-   * matrix containing
-   *  CLASS_O in [DEAD][color]
-   *  CLASS_o in [ALIVE][color]
-   *  CLASS_X in [DEAD][other]
-   *  CLASS_x in [ALIVE][other]
-   *
-   * so eg. if we have a dead white dragon, and we
-   * are checking a pattern for black, then
-   *  class_mask[DEAD][other]  will contain CLASS_X
-   * Then we reject any patterns which have CLASS_X
-   * set in the class bits.
-   *
-   * Making it static guarantees that all fields are
-   * initially set to 0, and we overwrite the ones
-   * we care about each time.
+  if (m + r->mini < 0
+      || m + r->maxi > board_size-1
+      || n + r->minj < 0
+      || n + r->maxj > board_size-1)
+    return;  /* out of range */
+
+  stats.matcher[MATCH_EDGE]++;
+
+  /* Now check that board[] matches each element of the pattern (see
+   * above). All of them are on the board after the range check.
    */
-  
-  static int class_mask[MAX_DRAGON_STATUS][3];
-  
-  class_mask[DEAD][color] = CLASS_O;
-  class_mask[DEAD][other] = CLASS_X;
-  class_mask[ALIVE][color] = CLASS_o;
-  class_mask[ALIVE][other] = CLASS_x;
+  if (!check_elements(pattern, r, anchor, color))
+    goto match_failed;
 
+  /* Check out the class_X, class_O, class_x, class_o attributes - see
+   * patterns.db and above
+   */
+  if (pattern->class & (CLASS_O | CLASS_X | CLASS_o | CLASS_x))
+    for (k = 0; k < pattern->patlen; ++k) {
+      int pos = anchor + r->deltas[k];
 
+      if ((pattern->class & class_mask[dragon[I(pos)][J(pos)].status][board[pos]]) != 0)
+	goto match_failed;
+    }
 
-  assert(m>=0 && m<board_size && n>=0 && n<board_size);
+
+  /* Make it here ==> We have matched all the elements to the board. */
+
+  stats.matcher[MATCH_ELEMENTS]++;
+
+
+#if GRID_OPT == 2
+
+  /* Make sure the grid optimisation wouldn't have rejected this pattern */
+  ASSERT( (merged_board[color-1][m][n] & pattern->and_mask[ll]) == pattern->val_mask[ll], m,n);
+
+#endif /* we don't trust the grid optimisation */
+
+
+
+  /* A match!  - Call back to the invoker to let it know. The
+   * autohelper is left to the callback, see pattern_constraint().
+   */
+  callback(m, n, color, pattern, ll);
+
+  /* We jump to here as soon as we discover a pattern has failed. */
+ match_failed:
+  DEBUG(DEBUG_MATCHER, 
+	"end of pattern '%s', rotation %d at %m\n---\n", 
+	pattern->name, ll, m,n);
+}
+
+
+#if TREE_MATCHER != 1
+
+/*
+ * Try the patterns of the database at (m,n) by their anchor and
+ * grid.
+ */
+
+static void
+grid_match(int m, int n, matchpat_callback_fn_ptr callback, int color,
+	   int minwt, struct pattern_db *database)
+{
+  struct pattern *pattern;
+  int ll;   /* Iterate over transformations (rotations or reflections)  */
+
+#if GRID_OPT == 1
+
+  /* Only the rotations listed in the index under the key of the grid
+   * at (m,n) can pass the grid check, see patterns.h. They come in
+   * the order of the pattern array, so the callback sees the matches
+   * in the same order as from a scan of the whole array. The anchor
+   * is part of the key, so there is no separate check of its color.
+   */
+  {
+    const struct pattern_index *index = database->index;
+    int key = GRID_KEY(merged_board[color-1][m][n]);
+    int c;
+
+    for (c = index->start[key]; c < index->start[key+1]; c++) {
+      pattern = database->patterns + (index->candidates[c] >> 3);
+      ll = index->candidates[c] & 7;
+
+      if (!pattern_considered(pattern, minwt))
+	continue;
+
+      stats.matcher[MATCH_TRIED]++;
+      stats.matcher[MATCH_ANCHOR]++;
+
+#else /* GRID_OPT != 1 */
 
   /* Try each pattern - NULL pattern marks end of list. */
-  for ( ; pattern->patn; ++pattern) { 
-
-    /* If allpats=0, only patterns potentially larger than the largest
-     * yet found are considered. This speeds the program up.
-     * Generating all patterns gives useful information while tuning
-     * the pattern database. We use the maxwt field in the pattern
-     * database to decide whether we need to consider a pattern. 
-     * If there is a helper function involved, the maximum weight has
-     * to be entered into the patterns.db file. The code will assert
-     * that the weight returned is never higher than maxwt.
+  for (pattern = database->patterns; pattern->patn; ++pattern) { 
+
+    if (!pattern_considered(pattern, minwt))
+      continue;
+
+    stats.matcher[MATCH_TRIED] += pattern->trfno;
+
+    /* We can check the color of the anchor stone now.
+     * Roughly half the patterns are anchored at each
+     * color, and since the anchor stone is invariant under
+     * rotation, we can reject all rotations of a wrongly-anchored
+     * pattern in one go.
+     *
+     * Patterns are always drawn from O perspective in .db,
+     * so p[m][n] is 'color' if the pattern is anchored
+     * at O, or 'other' for X.
+     * Since we require that this flag contains 3 for
+     * anchored_at_X, we can check that
+     *   p[m][n] == (color ^ anchored_at_X)
+     * which is equivalent to
+     *           == anchored_at_X ? other : color
      */
-    /* jd  I added a little hack to have more pattern considered when the
-     *     style fearless is enabled, thus with this option, a pattern
-     *     must have a maxwt 10 points lower than minwt to be discarded.
-     */       
-    if ( allpats || (pattern->maxwt >= minwt) ||
-	 (pattern->class & (CLASS_D | CLASS_A)) ||
-	 (pattern->class & (CLASS_B | CLASS_C)) ||
-	 (pattern->class & (CLASS_L)) ||
-         (style & STY_FEARLESS && minwt < 75 && pattern->maxwt + 10 >= minwt))
-    {
-
-#ifdef PROFILE_MATCHER
-      totals[0] += pattern->trfno;
-#endif
 
-      /* We can check the color of the anchor stone now.
-       * Roughly half the patterns are anchored at each
-       * color, and since the anchor stone is invariant under
-       * rotation, we can reject all rotations of a wrongly-anchored
-       * pattern in one go.
-       *
-       * Patterns are always drawn from O perspective in .db,
-       * so p[m][n] is 'color' if the pattern is anchored
-       * at O, or 'other' for X.
-       * Since we require that this flag contains 3 for
-       * anchored_at_X, we can check that
-       *   p[m][n] == (color ^ anchored_at_X)
-       * which is equivalent to
-       *           == anchored_at_X ? other : color
-       */
-
-      if ( p[m][n] != (pattern->anchored_at_X ^ color) )
-	continue;  /* does not match the anchor */
+    if ( p[m][n] != (pattern->anchored_at_X ^ color) )
+      continue;  /* does not match the anchor */
     
-      /* try each orientation transformation */
-      for (ll = 0; ll < pattern->trfno; ll++) {
+    /* try each orientation transformation */
+    for (ll = 0; ll < pattern->trfno; ll++) {
  
-#ifdef PROFILE_MATCHER
-	++totals[1];
-#endif
+      stats.matcher[MATCH_ANCHOR]++;
+
+#endif /* GRID_OPT != 1 */
 
 
 #if GRID_OPT == 1
 
-	/* We first perform the grid check : this checks up to 16
-	 * elements in one go, and allows us to rapidly reject
-	 * patterns which do not match.  While this check invokes a
-	 * necessary condition, it is not a sufficient test, so more
-	 * careful checks are still required, but this allows rapid
-	 * rejection. merged_board[][] should contain a combination of
-	 * 16 board positions around m,n.  The colours have been fixed
-	 * up so that stones which are 'O' in the pattern are
-	 * bit-pattern %01.  
-	 */
-	if ( (merged_board[color-1][m][n] & pattern->and_mask[ll])
-	     != pattern->val_mask[ll])
-	  continue;  /* large-scale match failed */
+      /* We first perform the grid check : this checks up to 25
+       * elements in one go, and allows us to rapidly reject
+       * patterns which do not match.  While this check invokes a
+       * necessary condition, it is not a sufficient test, so more
+       * careful checks are still required, but this allows rapid
+       * rejection. merged_board[][] should contain a combination of
+       * 25 board positions around m,n.  The colours have been fixed
+       * up so that stones which are 'O' in the pattern are
+       * bit-pattern %01.  
+       */
+      if ( (merged_board[color-1][m][n] & pattern->and_mask[ll])
+	   != pattern->val_mask[ll])
+	continue;  /* large-scale match failed */
 
 #endif /* GRID_OPT == 1 */
 
 
-#ifdef PROFILE_MATCHER
-	++totals[2];
-#endif
+      stats.matcher[MATCH_GRID]++;
 
-	/* Next, we do the range check. This applies the edge
-	 * constraints implicitly.
-	 */
-	{
-	  int mi,mj,xi,xj;
-	  
-	  TRANSFORM(pattern->mini, pattern->minj, &mi, &mj, ll);
-	  TRANSFORM(pattern->maxi, pattern->maxj, &xi, &xj, ll);
-
-	  /* transformed {m,x}{i,j} are arbitrary corners - 
-	     Find top-left and bot-right. */
-	  if (xi < mi) { int xx = mi; mi = xi ; xi = xx; }
-	  if (xj < mj) { int xx = mj; mj = xj ; xj = xx; }
-
-	  DEBUG(DEBUG_MATCHER, "---\nconsidering pattern '%s', rotation %d at %m. Range %d,%d -> %d,%d\n",
-		pattern->name, ll, m,n, mi, mj, xi, xj);
-
-	  /* now do the range-check */
-	  if (m + mi < 0
-	      || m + xi > board_size-1
-	      || n + mj < 0
-	      || n + xj > board_size-1)
-	    continue;  /* out of range */
-	}
-
-#ifdef PROFILE_MATCHER	 
-	++totals[3];
-#endif
+      match_rotation(m, n, callback, color, pattern, ll,
+		     database->rotations + 8*(pattern - database->patterns) + ll);
+
+    } /* loop over rotations */
+  } /* loop over patterns */
+}
+
+#endif /* TREE_MATCHER != 1 */
+
+
+#if TREE_MATCHER
 
-	/* Now iterate over the elements of the pattern. */
-	for (k = 0; k < pattern->patlen; ++k) { /* match each point */
-	  int x, y; /* absolute (board) co-ords of (transformed) pattern element */
-	  int att = pattern->patn[k].att;  /* what we are looking for */
+/*
+ * Walk the decision tree of the database (see patterns.h) from the
+ * board around (m,n) down to a leaf, and try the rotations listed
+ * there. These already agree with the points looked at on the way,
+ * which include the anchor, so they count as having passed the
+ * anchor and grid checks.
+ */
 
+static void
+tree_match(int m, int n, matchpat_callback_fn_ptr callback, int color,
+	   int minwt, struct pattern_db *database)
+{
+  const struct pattern_tree *tree = database->tree;
+  const struct pattern_tree_node *node = tree->nodes;
+  int next;
+  int c;
+
+  for (;;) {
+    int x = m + node->di;
+    int y = n + node->dj;
+    int value;
+
+    if (x < 0 || x >= board_size || y < 0 || y >= board_size)
+      value = 3;
+    else if (p[x][y] == EMPTY)
+      value = 0;
+    else if (p[x][y] == color)
+      value = 1;
+    else
+      value = 2;
+
+    next = node->child[value];
+    if (next <= 0)
+      break;
+    node = tree->nodes + next;
+  }
 
-	  /* Work out the position on the board of this pattern element. */
+  if (next == 0)
+    return;  /* nothing can match here */
 
-	  /* transform pattern real coordinate... */
-	  TRANSFORM(pattern->patn[k].x,pattern->patn[k].y,&x,&y,ll);
-	  x+=m;
-	  y+=n;
+  for (c = tree->leaf_start[-next-1]; c < tree->leaf_start[-next]; c++) {
+    struct pattern *pattern = database->patterns + (tree->candidates[c] >> 3);
+    int ll = tree->candidates[c] & 7;
 
-	  assert(x>=0 && x < board_size && y >= 0 && y < board_size);
+    if (!pattern_considered(pattern, minwt))
+      continue;
 
-	  /* ...and check that p[x][y] matches (see above). */
-	  if ( (p[x][y] & and_mask[color-1][att]) != val_mask[color-1][att])
-	    goto match_failed;
+    stats.matcher[MATCH_TRIED]++;
+    stats.matcher[MATCH_ANCHOR]++;
+    stats.matcher[MATCH_GRID]++;
 
-	  /* Check out the class_X, class_O, class_x, class_o attributes - see
-	   * patterns.db and above
-	   */
-	  if ((pattern->class & class_mask[dragon[x][y].status][p[x][y]]) != 0)
-	    goto match_failed; 
+    match_rotation(m, n, callback, color, pattern, ll,
+		   database->rotations + tree->candidates[c]);
+  }
+}
 
-	} /* loop over elements */
+#endif /* TREE_MATCHER */
 
 
-	/* Make it here ==> We have matched all the elements to the board. */
+#if TREE_MATCHER == 2
 
-#ifdef PROFILE_MATCHER
-	++totals[4];
-#endif
+/* In check mode both matchers run, and their matches are recorded
+ * here and compared before they are passed on to the real callback.
+ */
 
+#define MAX_CHECK_MATCHES 2000
 
-#if GRID_OPT == 2
+struct check_match {
+  struct pattern *pattern;
+  int ll;
+};
 
-	/* Make sure the grid optimisation wouldn't have rejected this pattern */
-	ASSERT( (merged_board[color-1][m][n] & pattern->and_mask[ll]) == pattern->val_mask[ll], m,n);
+static ENGINE_LOCAL struct check_match check_matches[2][MAX_CHECK_MATCHES];
+static ENGINE_LOCAL int check_count[2];
+static ENGINE_LOCAL int check_matcher;
 
-#endif /* we don't trust the grid optimisation */
 
+static void
+check_callback(int m, int n, int color, struct pattern *pattern, int ll)
+{
+  int k = check_count[check_matcher]++;
+
+  UNUSED(m); UNUSED(n); UNUSED(color);
+  assert(k < MAX_CHECK_MATCHES);
+  check_matches[check_matcher][k].pattern = pattern;
+  check_matches[check_matcher][k].ll = ll;
+}
+
+#endif /* TREE_MATCHER == 2 */
 
 
-	/* If the pattern has an autohelper, call it to see if the pattern */
-	/* must be rejected. */
+/* 
+ * Try all the patterns in the given database at (m,n). Invoke the callback
+ * for any that matches.  Classes X,O,x,o are checked here. It is up to
+ * the callback to process the other classes, to check the constraint
+ * with pattern_constraint() and to call any helper functions.
+ *
+ * With TREE_MATCHER == 2 both the grid index and the decision tree
+ * are used, and the program aborts unless they find the same matches
+ * in the same order. The callback is then only invoked after all the
+ * patterns have been tried.
+ */
+
+void
+matchpat(int m, int n, matchpat_callback_fn_ptr callback, int color,
+	 int minwt, struct pattern_db *database) 
+{
+  int other = OTHER_COLOR(color);
+
+  class_mask[DEAD][color] = CLASS_O;
+  class_mask[DEAD][other] = CLASS_X;
+  class_mask[ALIVE][color] = CLASS_o;
+  class_mask[ALIVE][other] = CLASS_x;
+
+  assert(m>=0 && m<board_size && n>=0 && n<board_size);
+
+#if TREE_MATCHER == 1
+
+  tree_match(m, n, callback, color, minwt, database);
 
-	if (pattern->autohelper) {
-	  int ti,tj;
+#elif TREE_MATCHER == 2
 
-	  TRANSFORM(pattern->movei, pattern->movej, &ti, &tj, ll);
-	  ti += m;
-	  tj += n;
+  {
+    int k;
 
-	  if (!pattern->autohelper(pattern, ll, ti, tj, color))
-	    goto match_failed;
-	}
+    check_count[0] = check_count[1] = 0;
+    check_matcher = 0;
+    grid_match(m, n, check_callback, color, minwt, database);
+    check_matcher = 1;
+    tree_match(m, n, check_callback, color, minwt, database);
+
+    for (k = 0; k < check_count[0] || k < check_count[1]; k++)
+      if (k >= check_count[0] || k >= check_count[1]
+	  || check_matches[0][k].pattern != check_matches[1][k].pattern
+	  || check_matches[0][k].ll != check_matches[1][k].ll) {
+	fprintf(stderr, "matchpat: tree and grid disagree at %c%d (match %d)\n",
+		'A' + n + (n >= 8), board_size - m, k);
+	abort();
+      }
+
+    for (k = 0; k < check_count[0]; k++)
+      callback(m, n, color, check_matches[0][k].pattern,
+	       check_matches[0][k].ll);
+  }
+
+#else
+
+  grid_match(m, n, callback, color, minwt, database);
 
-#ifdef PROFILE_MATCHER
-	++totals[5];
 #endif
+}
 
-	/* A match!  - Call back to the invoker to let it know. */
-	callback(m, n, color, pattern, ll);
-
-	/* We jump to here as soon as we discover a pattern has failed. */
-      match_failed:
-	DEBUG(DEBUG_MATCHER, 
-	      "end of pattern '%s', rotation %d at %m\n---\n", 
-	      pattern->name, ll, m,n);
-	 
-      } /* ll loop over symmetries */
-    } /* if not rejected by maxwt */
-  } /* loop over patterns */
+
+/*
+ * The constraint of a pattern is checked lazily by the callback of
+ * matchpat(), after the cheaper reasons to reject the match, such as
+ * a pattern of a class the caller is not interested in or an unsafe
+ * move. pattern_constraint() returns the verdict of the autohelper of
+ * the pattern matched at (m, n) in rotation ll, or 1 if it has none.
+ */
+
+int
+pattern_constraint(int m, int n, int color, struct pattern *pattern, int ll)
+{
+  int ti, tj;
+
+  if (pattern->autohelper) {
+    /* The autohelper gets the move where mkpat put it, which for a
+     * pattern without move is the transformed (-1, -1).
+     */
+    TRANSFORM(pattern->movei, pattern->movej, &ti, &tj, ll);
+    if (!pattern->autohelper(pattern, ll, m + ti, n + tj, color))
+      return 0;
+  }
+
+  stats.matcher[MATCH_HELPER]++;
+  return 1;
 }
 
 
@@ -196,10 +196,10 @@ typedef struct {
 
 #define COLOR_STACK_SIZE 80
 
-static goban_t board_cache[COLOR_STACK_SIZE];
-static int     board_cache_free;
-static int     cache_movei[COLOR_STACK_SIZE];
-static int     cache_movej[COLOR_STACK_SIZE];
+static ENGINE_LOCAL goban_t board_cache[COLOR_STACK_SIZE];
+static ENGINE_LOCAL int     board_cache_free;
+static ENGINE_LOCAL int     cache_movei[COLOR_STACK_SIZE];
+static ENGINE_LOCAL int     cache_movej[COLOR_STACK_SIZE];
 
 /* number of dilation for area ownership, must be <= MAX_DILAT */
 #define TERRI_DILATIONS  5
@@ -228,53 +228,53 @@ typedef struct {
 } area_t;
 
 
-static area_t   area_array[GROUP_STACK_MAX];
-static int      areas_level;
-static goban_t  area_grid;
-static int      num_groups[2];  /* number of groups of each colors */
-static int      nb_weak[2];     /* number of weak groups of each color */
+static ENGINE_LOCAL area_t   area_array[GROUP_STACK_MAX];
+static ENGINE_LOCAL int      areas_level;
+static ENGINE_LOCAL goban_t  area_grid;
+static ENGINE_LOCAL int      num_groups[2];  /* number of groups of each colors */
+static ENGINE_LOCAL int      nb_weak[2];     /* number of weak groups of each color */
 
 /* for caching already calculated values of delta_area, in meta_connect() */
-static goban_t area_cached_move[2];
-static goban_t delta_area_cache[2];
-static goban_t board_area_move[2];	/* cache board for delta_area_color */
+static ENGINE_LOCAL goban_t area_cached_move[2];
+static ENGINE_LOCAL goban_t delta_area_cache[2];
+static ENGINE_LOCAL goban_t board_area_move[2];	/* cache board for delta_area_color */
 
 
-static unsigned long mask, bord;	/* mask=011..10  bord=100..01 */
-static Shadow empty_shadow;	/* to quickly initialize Shadow values */
-static binmap_t mask_binmap;	/* full of stone, for some binary operators */
+static ENGINE_LOCAL unsigned long mask, bord;	/* mask=011..10  bord=100..01 */
+static ENGINE_LOCAL Shadow empty_shadow;	/* to quickly initialize Shadow values */
+static ENGINE_LOCAL binmap_t mask_binmap;	/* full of stone, for some binary operators */
 
 /* the stack of successive iterations of the dilation, it is useful just
  * before erosion for computing territorial weight of each intersection 
  */
-static Shadow mostack[2][TERRI_DILATIONS + 1]; 
+static ENGINE_LOCAL Shadow mostack[2][TERRI_DILATIONS + 1]; 
 
 /* for caching already calculated values of delta_moyo */
-static goban_t delta_moyo_move_cache[2];
-static goban_t delta_moyo_value_cache[2];
-static goban_t board_moyo_move[2];	/* cache board for delta_moyo_color */
+static ENGINE_LOCAL goban_t delta_moyo_move_cache[2];
+static ENGINE_LOCAL goban_t delta_moyo_value_cache[2];
+static ENGINE_LOCAL goban_t board_moyo_move[2];	/* cache board for delta_moyo_color */
 
 /* for caching already calculated values of delta_terri */
-static goban_t terri_cached_move[2];
-static goban_t board_terri_move[2];	/* cache board for delta_terri_color */
-static goban_t delta_terri_cache[2];
+static ENGINE_LOCAL goban_t terri_cached_move[2];
+static ENGINE_LOCAL goban_t board_terri_move[2];	/* cache board for delta_terri_color */
+static ENGINE_LOCAL goban_t delta_terri_cache[2];
 
 /* static int ikomi;               komi */
 
 /* The boards in which the dilations/erosions are made. */
-static goban_t empty_goban;
-static goban_t start_goban;
-static goban_t moyo_goban;
-static goban_t terri_goban;
-static goban_t d_moyo_goban;
-static goban_t d_terri_goban;
+static ENGINE_LOCAL goban_t empty_goban;
+static ENGINE_LOCAL goban_t start_goban;
+static ENGINE_LOCAL goban_t moyo_goban;
+static ENGINE_LOCAL goban_t terri_goban;
+static ENGINE_LOCAL goban_t d_moyo_goban;
+static ENGINE_LOCAL goban_t d_terri_goban;
 
 
-int terri_eval[3];
-int terri_test[3];
-int moyo_eval[3];
-int moyo_test[3];
-int very_big_move[3];
+ENGINE_LOCAL int terri_eval[3];
+ENGINE_LOCAL int terri_test[3];
+ENGINE_LOCAL int moyo_eval[3];
+ENGINE_LOCAL int moyo_test[3];
+ENGINE_LOCAL int very_big_move[3];
 
 
 /**********************************/
@@ -954,9 +954,9 @@ compute_delta_moyo(int m, int n, int color, int b)
 static int
 compute_delta_area(int m, int n, int color)
 {
-  static area_t   test_area_s[GROUP_STACK_MAX];
-  static int      te_areas_level;
-  static goban_t  te_area_grid;
+  static ENGINE_LOCAL area_t   test_area_s[GROUP_STACK_MAX];
+  static ENGINE_LOCAL int      te_areas_level;
+  static ENGINE_LOCAL goban_t  te_area_grid;
   int i;
   int temp_num_groups[2];
   int cut_bonus;
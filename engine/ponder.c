@@ -0,0 +1,412 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *\
+ * This is GNU GO, a Go program. Contact gnugo@gnu.org, or see   *
+ * http://www.gnu.org/software/gnugo/ for more information.      *
+ *                                                               *
+ * Copyright 1999 and 2000 by the Free Software Foundation.      *
+ *                                                               *
+ * This program is free software; you can redistribute it and/or *
+ * modify it under the terms of the GNU General Public License   *
+ * as published by the Free Software Foundation - version 2.     *
+ *                                                               *
+ * This program is distributed in the hope that it will be       *
+ * useful, but WITHOUT ANY WARRANTY; without even the implied    *
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR       *
+ * PURPOSE.  See the GNU General Public License in file COPYING  *
+ * for more details.                                             *
+ *                                                               *
+ * You should have received a copy of the GNU General Public     *
+ * License along with this program; if not, write to the Free    *
+ * Software Foundation, Inc., 59 Temple Place - Suite 330,       *
+ * Boston, MA 02111, USA                                         *
+\* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/*
+ * Pondering.
+ *
+ * With --ponder, a pondering thread reads ahead while the opponent
+ * thinks. After our move the interface calls start_pondering(). The
+ * thread enters an engine context of its own (see context.c) with a
+ * copy of the position, and first lets genmove() choose a move for
+ * the opponent. The PONDER_REPLIES moves it values most are taken
+ * as the likely replies. For each, the thread plays it and lets
+ * genmove() find our answer, which it keeps. The context shares the
+ * hash table of the interface's engine, so the reading results stay
+ * there for the real genmove() whichever move the opponent plays.
+ *
+ * When the opponent's move arrives, the interface calls
+ * ponder_reply(), which returns at once. If the thread is reading
+ * the answer to that very move it is allowed to finish, otherwise it
+ * is told to stop. Any other command that uses the engine stops it
+ * with stop_pondering(), which waits for it. Stopping is
+ * cooperative: ponder_cancelled is set, and the reading gives up as
+ * if its budget were used up (see read_budget_exhausted() in
+ * reading.c), so that genmove() returns soon.
+ *
+ * genmove() first calls pondered_move(). It waits for the thread,
+ * so that this time is on our clock, and on a kept answer to the
+ * position returns it at once.
+ *
+ * Between ponder_reply() and genmove() the interface only plays the
+ * opponent's move on its own board. Otherwise the thread only runs
+ * while the interface waits for the opponent, so the hash table, the
+ * engine of the interface and the options shared by all engines are
+ * never used by two threads at the same time. Pondering needs
+ * ENGINE_THREADS. It is not done while tracing or writing variations
+ * to an sgf file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "liberty.h"
+#include "ttsgf.h"
+#include "sgfana.h"
+
+ENGINE_LOCAL int pondering = 0;
+volatile int ponder_cancelled = 0;
+
+#if ENGINE_THREADS
+#include <pthread.h>
+
+#define PONDER_REPLIES 3
+
+/* Our answers to the replies read so far. */
+
+static struct {
+  board_t             p[MAX_BOARD][MAX_BOARD];
+  int                 ko_i;
+  int                 ko_j;
+  int                 movenum;
+  int                 color;
+  int                 i;
+  int                 j;
+  int                 val;
+  struct fuseki_state fuseki;
+} answer[PONDER_REPLIES];
+
+static int num_answers = 0;
+
+static struct engine_context *ponder_context = NULL;
+static int ponder_color;            /* the opponent, to move */
+static int ponder_wanted = 0;       /* start_pondering() was called */
+static int ponder_busy = 0;         /* the thread is pondering */
+static int reply_i = -1;            /* the reply being read */
+static int reply_j = -1;
+static int last_reply = 0;          /* stop after this reply */
+static int ponder_hits = 0;
+static int ponder_moves = 0;
+
+static pthread_mutex_t ponder_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  ponder_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  ponder_done = PTHREAD_COND_INITIALIZER;
+
+
+/* Forget the caches of the last position read, since the next one
+ * may have the same move number.
+ */
+
+static void
+enter_position(void)
+{
+  engine_context_enter(ponder_context);
+  init_moyo();
+  clear_wind_cache();
+  clear_safe_move_cache();
+}
+
+
+/* Ponder the position of ponder_context, with color to move. */
+
+static void
+ponder_position(int color)
+{
+  int ri[PONDER_REPLIES];
+  int rj[PONDER_REPLIES];
+  int rval[PONDER_REPLIES];
+  int replies = 0;
+  int i, j, m, n, k;
+  int val;
+
+  enter_position();
+
+  /* Guess the replies, best first. */
+  val = genmove(&i, &j, color);
+  if (ponder_cancelled)
+    return;
+  if (val >= 0) {
+    ri[0] = i;
+    rj[0] = j;
+    rval[0] = 256;
+    replies = 1;
+  }
+  for (m = 0; m < board_size; m++)
+    for (n = 0; n < board_size; n++) {
+      if (potential_moves[m][n] == 0 || (m == i && n == j))
+	continue;
+      for (k = replies; k > 0 && rval[k-1] < potential_moves[m][n]; k--)
+	if (k < PONDER_REPLIES) {
+	  ri[k] = ri[k-1];
+	  rj[k] = rj[k-1];
+	  rval[k] = rval[k-1];
+	}
+      if (k < PONDER_REPLIES) {
+	ri[k] = m;
+	rj[k] = n;
+	rval[k] = potential_moves[m][n];
+	if (replies < PONDER_REPLIES)
+	  replies++;
+      }
+    }
+
+  /* Find our answers. */
+  for (k = 0; k < replies; k++) {
+    enter_position();
+    if (!legal(ri[k], rj[k], color))
+      continue;
+
+    pthread_mutex_lock(&ponder_lock);
+    if (ponder_cancelled || last_reply) {
+      pthread_mutex_unlock(&ponder_lock);
+      return;
+    }
+    reply_i = ri[k];
+    reply_j = rj[k];
+    pthread_mutex_unlock(&ponder_lock);
+
+    updateboard(ri[k], rj[k], color);
+    movenum++;
+    memcpy(answer[num_answers].p, p, sizeof(p));
+    answer[num_answers].ko_i = ko_i;
+    answer[num_answers].ko_j = ko_j;
+    answer[num_answers].movenum = movenum;
+    answer[num_answers].color = OTHER_COLOR(color);
+    val = genmove(&i, &j, OTHER_COLOR(color));
+
+    pthread_mutex_lock(&ponder_lock);
+    if (!ponder_cancelled) {
+      answer[num_answers].i = i;
+      answer[num_answers].j = j;
+      answer[num_answers].val = val;
+      get_fuseki_state(&answer[num_answers].fuseki);
+      num_answers++;
+    }
+    pthread_mutex_unlock(&ponder_lock);
+  }
+}
+
+
+static void *
+ponder_thread(void *arg)
+{
+  int color;
+
+  for (;;) {
+    pthread_mutex_lock(&ponder_lock);
+    while (!ponder_wanted)
+      pthread_cond_wait(&ponder_start, &ponder_lock);
+    ponder_wanted = 0;
+    color = ponder_color;
+    pthread_mutex_unlock(&ponder_lock);
+
+    pondering = 1;
+    ponder_position(color);
+    pondering = 0;
+
+    pthread_mutex_lock(&ponder_lock);
+    ponder_busy = 0;
+    reply_i = -1;
+    reply_j = -1;
+    pthread_cond_broadcast(&ponder_done);
+    pthread_mutex_unlock(&ponder_lock);
+  }
+
+  return NULL;
+}
+
+
+/*
+ * Start the pondering thread. Call this once, before the first
+ * genmove().
+ *
+ * Return 0 if the thread cannot be started.
+ */
+
+int
+start_ponder_thread(void)
+{
+  pthread_t thread;
+
+  ponder_context = engine_context_new(MAX_BOARD, 0);
+  if (ponder_context == NULL)
+    return 0;
+  if (pthread_create(&thread, NULL, ponder_thread, NULL) != 0) {
+    engine_context_free(ponder_context);
+    ponder_context = NULL;
+    return 0;
+  }
+  pthread_detach(thread);
+
+  return 1;
+}
+
+
+/*
+ * Ponder the current position, with color to move, until the next
+ * call of ponder_reply() or stop_pondering(). The answers of the
+ * last time are forgotten.
+ */
+
+void
+start_pondering(int color)
+{
+  if (ponder_context == NULL || stackp > 0
+      || verbose || printworms || printmoyo || printboard
+      || analyzerflag || sgf_dump || count_variations)
+    return;
+
+  stop_pondering();
+  engine_context_copy(ponder_context);
+
+  pthread_mutex_lock(&ponder_lock);
+  num_answers = 0;
+  ponder_color = color;
+  ponder_cancelled = 0;
+  last_reply = 0;
+  ponder_busy = 1;
+  ponder_wanted = 1;
+  pthread_cond_signal(&ponder_start);
+  pthread_mutex_unlock(&ponder_lock);
+}
+
+
+/* Stop pondering, and return when the thread has stopped. */
+
+void
+stop_pondering(void)
+{
+  if (ponder_context == NULL)
+    return;
+
+  pthread_mutex_lock(&ponder_lock);
+  if (ponder_busy)
+    ponder_cancelled = 1;
+  while (ponder_busy)
+    pthread_cond_wait(&ponder_done, &ponder_lock);
+  pthread_mutex_unlock(&ponder_lock);
+}
+
+
+/* The opponent played at (i, j). Let the thread finish if it is
+ * reading our answer to that move, otherwise tell it to stop. Do not
+ * wait for it, pondered_move() does.
+ */
+
+void
+ponder_reply(int i, int j)
+{
+  if (ponder_context == NULL)
+    return;
+
+  pthread_mutex_lock(&ponder_lock);
+  if (ponder_busy && !last_reply && i == reply_i && j == reply_j)
+    last_reply = 1;
+  else if (ponder_busy)
+    ponder_cancelled = 1;
+  pthread_mutex_unlock(&ponder_lock);
+}
+
+
+/*
+ * If an answer for color to the current position was found while
+ * pondering, return 1 with it in (*i, *j) and its value in *val, and
+ * take over the fuseki state of that genmove().
+ */
+
+int
+pondered_move(int *i, int *j, int color, int *val)
+{
+  int k;
+
+  if (ponder_context == NULL || pondering)
+    return 0;
+
+  /* Let the thread finish an answer to the opponent's move. */
+  pthread_mutex_lock(&ponder_lock);
+  if (ponder_busy && !last_reply)
+    ponder_cancelled = 1;
+  while (ponder_busy)
+    pthread_cond_wait(&ponder_done, &ponder_lock);
+  pthread_mutex_unlock(&ponder_lock);
+
+  ponder_moves++;
+  for (k = 0; k < num_answers; k++)
+    if (answer[k].color == color
+	&& answer[k].movenum == movenum
+	&& answer[k].ko_i == ko_i
+	&& answer[k].ko_j == ko_j
+	&& memcmp(answer[k].p, p, sizeof(p)) == 0) {
+      *i = answer[k].i;
+      *j = answer[k].j;
+      *val = answer[k].val;
+      set_fuseki_state(&answer[k].fuseki);
+      num_answers = 0;
+      ponder_hits++;
+      TRACE("Pondering found %m, the answer in %d of %d moves.\n",
+	    *i, *j, ponder_hits, ponder_moves);
+      return 1;
+    }
+
+  return 0;
+}
+
+
+#else /* !ENGINE_THREADS */
+
+
+/* Without ENGINE_THREADS there is no engine to give a thread, so
+ * there is no pondering.
+ */
+
+int
+start_ponder_thread(void)
+{
+  return 0;
+}
+
+
+void
+start_pondering(int color)
+{
+}
+
+
+void
+stop_pondering(void)
+{
+}
+
+
+void
+ponder_reply(int i, int j)
+{
+}
+
+
+int
+pondered_move(int *i, int *j, int color, int *val)
+{
+  return 0;
+}
+
+
+#endif /* ENGINE_THREADS */
+
+
+/*
+ * Local Variables:
+ * tab-width: 8
+ * c-basic-offset: 2
+ * End:
+ */
@@ -30,12 +30,15 @@
 #define ATTACK2         5
 #define ATTACK3         6
 
+#define SAFE_MOVE       8   /* and 9, for black */
+
 #define UNUSED(x)  x=x
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
+#include <limits.h>
 #include "liberty.h"
 #include "hash.h"
 #include <assert.h>
@@ -59,11 +62,140 @@ static void chain(int i, int j, char ma[MAX_BOARD][MAX_BOARD],
 static int relative_break_chain(int, int, int *, int *, int, int);
 static int special_rescue(int si, int sj, int ai, int aj, int *ti, int *tj);
 static void order3(int *, int *, int *, int *, int *, int *, int , int );
+static void order_moves(int num, int mi[], int mj[], int key[], int color,
+			Read_result *read_result);
+static void good_move(int i, int j, int color);
 static int naive_ladder_defense(int si, int sj, int ai, int aj,
 				int bi, int bj, int color, int other);
 static int naive_ladder_break_through(int si, int sj, int ai, int aj,
 				      int color, int other);
 
+/* ================================================================ */
+
+const char *const read_routine_name[NUM_READ_ROUTINES] = {
+  "find_defense", "defend1", "defend2", "defend3",
+  "attack", "attack2", "attack3", "defend4", "safe_move"
+};
+
+
+/*
+ * With adaptive_hashflags, after each move adapt_hashflags() looks at
+ * how full the hash table is. Once it is fuller than
+ * ADAPT_PRESSURE_HIGH, the hashed routine with the lowest hit rate
+ * over the move is no longer hashed, provided it was looked up at
+ * least ADAPT_MIN_LOOKUPS times and less than ADAPT_MIN_HIT_RATE of
+ * the lookups were hits. A routine with more hits than that is worth
+ * its place in the table even when the table runs out. Once it is
+ * less full than ADAPT_PRESSURE_LOW, and no routine has been dropped
+ * for the last ADAPT_RETRY_MOVES moves, the first routine dropped
+ * that way is hashed again. Only one routine is changed per move.
+ *
+ * hashflags and the state of the adaptation belong to the engine of
+ * each thread, like movehash. An engine context keeps them with its
+ * hash table (see context.c).
+ */
+
+#define ADAPT_PRESSURE_HIGH  0.90
+#define ADAPT_PRESSURE_LOW   0.50
+#define ADAPT_MIN_LOOKUPS    100
+#define ADAPT_MIN_HIT_RATE   0.05
+#define ADAPT_RETRY_MOVES    10
+
+#if HASHING
+
+/* The bit of hashflags for each routine, counted together in
+ * stats.read_lookups[] and stats.read_hits[] for the two colors of
+ * SAFE_MOVE.
+ */
+
+static const int routine_flag[NUM_READ_ROUTINES] = {
+  HASH_FIND_DEFENSE, HASH_DEFEND1, HASH_DEFEND2, HASH_DEFEND3,
+  HASH_ATTACK, HASH_ATTACK2, HASH_ATTACK3, HASH_DEFEND4, HASH_SAFE_MOVE
+};
+
+static ENGINE_LOCAL int dropped_hashflags = 0;
+static ENGINE_LOCAL int moves_since_drop = 0;
+
+#endif
+
+void
+adapt_hashflags(void)
+{
+#if HASHING
+  double pressure;
+  double rate;
+  double worst_rate = 0.0;
+  int worst = -1;
+  int r;
+
+  if (!adaptive_hashflags || movehash == NULL)
+    return;
+
+  moves_since_drop++;
+  pressure = hashtable_pressure(movehash);
+  if (pressure > ADAPT_PRESSURE_HIGH) {
+    for (r = 0; r < NUM_READ_ROUTINES; r++) {
+      if (!(hashflags & routine_flag[r])
+	  || stats.read_lookups[r] < ADAPT_MIN_LOOKUPS)
+	continue;
+      rate = (double) stats.read_hits[r] / stats.read_lookups[r];
+      if (rate < ADAPT_MIN_HIT_RATE && (worst == -1 || rate < worst_rate)) {
+	worst = r;
+	worst_rate = rate;
+      }
+    }
+    if (worst != -1) {
+      hashflags &= ~routine_flag[worst];
+      dropped_hashflags |= routine_flag[worst];
+      moves_since_drop = 0;
+      TRACE("Hash table %d percent full, no longer hashing %s"
+	    " (%d percent hits).\n", (int) (100 * pressure),
+	    read_routine_name[worst], (int) (100 * worst_rate));
+    }
+  }
+  else if (pressure < ADAPT_PRESSURE_LOW
+	   && moves_since_drop >= ADAPT_RETRY_MOVES) {
+    for (r = 0; r < NUM_READ_ROUTINES; r++)
+      if (dropped_hashflags & routine_flag[r]) {
+	hashflags |= routine_flag[r];
+	dropped_hashflags &= ~routine_flag[r];
+	TRACE("Hash table %d percent full, hashing %s again.\n",
+	      (int) (100 * pressure), read_routine_name[r]);
+	break;
+      }
+  }
+#endif
+}
+
+
+/* Save and restore the hash flags of this engine with its adaptation,
+ * for an engine context (see context.c).
+ */
+
+void
+get_hashflags_state(struct hashflags_state *state)
+{
+  state->flags = hashflags;
+#if HASHING
+  state->dropped = dropped_hashflags;
+  state->moves_since_drop = moves_since_drop;
+#else
+  state->dropped = 0;
+  state->moves_since_drop = 0;
+#endif
+}
+
+void
+set_hashflags_state(const struct hashflags_state *state)
+{
+  hashflags = state->flags;
+#if HASHING
+  dropped_hashflags = state->dropped;
+  moves_since_drop = state->moves_since_drop;
+#endif
+}
+
+
 /* ================================================================ */
 
 #if TRACE_READ_RESULTS
@@ -100,11 +232,14 @@ get_read_result(/*int color, */int routine, int *si, int *sj,
 {
   Hashnode      * hashnode;
   int             retval;
+  int             counter = routine < SAFE_MOVE ? routine : SAFE_MOVE;
+
+  stats.read_lookups[counter]++;
 
 #if HASHING
 #if CHECK_HASHING
   Hashposition    pos;
-  unsigned long   hash;
+  Hashvalue       hash;
 
   UNUSED(color);
 
@@ -126,12 +261,12 @@ get_read_result(/*int color, */int routine, int *si, int *sj,
   hashnode = hashtable_search(movehash, &(hashdata.hashpos), hashdata.hashval);
   if (hashnode != NULL) {
     stats.position_hits++;
-    RTRACE("We found position %d in the hash table...\n", hashdata.hashval);
+    RTRACE("We found position %d in the hash table...\n", (int) hashdata.hashval);
   } else {
     hashnode = hashtable_enter_position(movehash,
 					&(hashdata.hashpos), hashdata.hashval);
     if (hashnode)
-      RTRACE("Created position %d in the hash table...\n", hashdata.hashval);
+      RTRACE("Created position %d in the hash table...\n", (int) hashdata.hashval);
   }
 #endif
 
@@ -149,13 +284,27 @@ get_read_result(/*int color, */int routine, int *si, int *sj,
     /* We found it!  Now see if we can find a previous result.
      * First, find the origin of the string containing (si, sj),
      * in order to make the caching of read results work better.
+     * An empty point is a move (see safe_move()) and stays as it is.
      */
-    find_origin(*si, *sj, si, sj);
+    if (p[*si][*sj] != EMPTY)
+      find_origin(*si, *sj, si, sj);
 
     *read_result = hashnode_search(hashnode, routine, *si, *sj);
 
-    if (*read_result != NULL) {
+    if (*read_result != NULL
+	&& (int) rr_get_depth(**read_result) < depth) {
+      /* It was read with a lower depth, during iterative deepening
+       * or with the depths raised by one in attdef.c. Read it again
+       * into the same Read_result, using its move as a hint (see
+       * read_hint()).
+       */
+      RTRACE("...but it was read with depth %d...",
+	     rr_get_depth(**read_result));
+      stats.read_result_shallow++;
+    }
+    else if (*read_result != NULL) {
       stats.read_result_hits++;
+      stats.read_hits[counter]++;
       retval = 1;
     } else {
       RTRACE("...but no previous result for routine %d and (%m)...",
@@ -192,8 +341,10 @@ get_read_result(/*int color, */int routine, int *si, int *sj,
 
 #define READ_RETURN0(read_result) \
   do { \
-    if (read_result) \
+    if (read_result && !read_budget_spent) { \
       rr_set_result_ri_rj(*(read_result), 0, 0, 0); \
+      rr_set_depth(*(read_result), depth); \
+    } \
     return 0; \
   } while (0)
 
@@ -201,8 +352,10 @@ get_read_result(/*int color, */int routine, int *si, int *sj,
   do { \
     if ((value) != 0 && (pointi) != 0) *(pointi)=(resulti); \
     if ((value) != 0 && (pointj) != 0) *(pointj)=(resultj); \
-    if (read_result) \
+    if (read_result && !read_budget_spent) { \
       rr_set_result_ri_rj(*(read_result), (value), (resulti), (resultj)); \
+      rr_set_depth(*(read_result), depth); \
+    } \
     return (value); \
   } while (0)
 
@@ -210,8 +363,10 @@ get_read_result(/*int color, */int routine, int *si, int *sj,
 
 #define READ_RETURN0(read_result) \
   do { \
-    if (read_result) \
+    if (read_result && !read_budget_spent) { \
       rr_set_result_ri_rj(*(read_result), 0, 0, 0); \
+      rr_set_depth(*(read_result), depth); \
+    } \
     gprintf("%o%s %m %d 0 0 0 ", read_function_name, qi, qj, stackp); \
     dump_stack(); \
     return 0; \
@@ -221,8 +376,10 @@ get_read_result(/*int color, */int routine, int *si, int *sj,
   do { \
     if ((value) != 0 && (pointi) != 0) *(pointi)=(resulti); \
     if ((value) != 0 && (pointj) != 0) *(pointj)=(resultj); \
-    if (read_result) \
+    if (read_result && !read_budget_spent) { \
       rr_set_result_ri_rj(*(read_result), (value), (resulti), (resultj)); \
+      rr_set_depth(*(read_result), depth); \
+    } \
     gprintf("%o%s %m %d %d %d %d ", read_function_name, qi, qj, stackp, \
 	    (value), (resulti), (resultj)); \
     dump_stack(); \
@@ -230,7 +387,268 @@ get_read_result(/*int color, */int routine, int *si, int *sj,
   } while (0)
 
 #endif
+
+
+/*
+ * If get_read_result() found a result read with a lower depth, it is
+ * read again, but a move that worked then is likely to work now.
+ * read_hint() returns 1 and the move in (*hi, *hj) in that case.
+ */
+
+static int
+read_hint(Read_result *read_result, int *hi, int *hj)
+{
+  if (read_result == NULL || rr_get_result(*read_result) == 0)
+    return 0;
+
+  *hi = rr_get_result_i(*read_result);
+  *hj = rr_get_result_j(*read_result);
+  return 1;
+}
+
+
+/* Return 1 if the move at (hi, hj) captures the string at (m, n). */
+
+static int
+attack_hint(int m, int n, int hi, int hj)
+{
+  int works = 0;
+
+  if (trymove(hi, hj, OTHER_COLOR(p[m][n]), "attack_hint", m, n)) {
+    works = (p[m][n] == EMPTY || !find_defense(m, n, NULL, NULL));
+    popgo();
+  }
+  return works;
+}
+
+
+/* Return 1 if the move at (hi, hj) saves the string at (m, n). */
+
+static int
+defense_hint(int m, int n, int hi, int hj)
+{
+  int works = 0;
+
+  if (trymove(hi, hj, p[m][n], "defense_hint", m, n)) {
+    works = !attack(m, n, NULL, NULL);
+    popgo();
+  }
+  return works;
+}
   
+/* =================== Iterative deepening ==================== */
+
+
+/*
+ * iterative_attack() and iterative_find_defense() work like attack()
+ * and find_defense(), but read with increasing depth until a budget
+ * of reading nodes or milliseconds is used up. 0 means no limit of
+ * that kind. depth starts at DEEPENING_FIRST and is raised by
+ * DEEPENING_STEP each iteration, up to DEEPENING_LAST, and
+ * backfill_depth, fourlib_depth and ko_depth are moved along with it.
+ * The result of the deepest iteration which was completed is
+ * returned.
+ *
+ * An iteration is not started unless the budget would last for it,
+ * assuming that it grows by as much as the last one did. When an
+ * iteration uses no more nodes than the one before, it was not cut
+ * off by the depth anywhere and reading deeper changes nothing.
+ *
+ * Results read with a lower depth are not taken from the hash table,
+ * but the move from the last iteration is tried first (see
+ * read_hint()).
+ */
+
+#define DEEPENING_FIRST 4
+#define DEEPENING_STEP  2
+#define DEEPENING_LAST  (2 * DEPTH)
+
+static int
+iterative_reading(int m, int n, int *i, int *j, int attacking,
+		  int max_nodes, int max_msec)
+{
+  int save_depth = depth;
+  int save_backfill_depth = backfill_depth;
+  int save_fourlib_depth = fourlib_depth;
+  int save_ko_depth = ko_depth;
+  double start = gg_gettimeofday();
+  double iteration_start;
+  double last_time = 0.0;
+  double growth = 1.0;
+  int start_nodes = stats.nodes;
+  int iteration_nodes;
+  int last_nodes = 0;
+  int result = 0;
+  int ri = -1, rj = -1;
+  int hinted;
+  int h;
+
+  if (max_nodes <= 0 && max_msec <= 0) {
+    if (attacking)
+      return attack(m, n, i, j);
+    return find_defense(m, n, i, j);
+  }
+
+  stats.deepening_calls++;
+  for (h = DEEPENING_FIRST; h <= DEEPENING_LAST; h += DEEPENING_STEP) {
+    if (h > DEEPENING_FIRST) {
+      if (max_nodes > 0
+	  && stats.nodes - start_nodes + growth * last_nodes > max_nodes)
+	break;
+      if (max_msec > 0
+	  && 1000.0 * (gg_gettimeofday() - start + growth * last_time)
+	     > max_msec)
+	break;
+    }
+
+    depth = h;
+    backfill_depth = save_backfill_depth + h - save_depth;
+    fourlib_depth = save_fourlib_depth + h - save_depth;
+    ko_depth = save_ko_depth + h - save_depth;
+
+    iteration_start = gg_gettimeofday();
+    iteration_nodes = stats.nodes;
+    hinted = (result && (attacking ? attack_hint(m, n, ri, rj)
+			 : defense_hint(m, n, ri, rj)));
+    if (hinted)
+      result = 1;
+    else if (attacking)
+      result = attack(m, n, &ri, &rj);
+    else
+      result = find_defense(m, n, &ri, &rj);
+    iteration_nodes = stats.nodes - iteration_nodes;
+    stats.deepening_iterations++;
+    RTRACE("depth %d: %s of %m gives %d in %d nodes\n", h,
+	   attacking ? "attack" : "defense", m, n, result, iteration_nodes);
+
+    if (h > DEEPENING_FIRST && !hinted && iteration_nodes <= last_nodes)
+      break;
+    if (last_nodes > 0 && iteration_nodes > last_nodes)
+      growth = (double) iteration_nodes / last_nodes;
+    last_nodes = iteration_nodes;
+    last_time = gg_gettimeofday() - iteration_start;
+  }
+
+  depth = save_depth;
+  backfill_depth = save_backfill_depth;
+  fourlib_depth = save_fourlib_depth;
+  ko_depth = save_ko_depth;
+
+  if (result) {
+    if (i) *i = ri;
+    if (j) *j = rj;
+  }
+  return result;
+}
+
+
+int
+iterative_attack(int m, int n, int *i, int *j, int max_nodes, int max_msec)
+{
+  return iterative_reading(m, n, i, j, 1, max_nodes, max_msec);
+}
+
+
+int
+iterative_find_defense(int m, int n, int *i, int *j,
+		       int max_nodes, int max_msec)
+{
+  return iterative_reading(m, n, i, j, 0, max_nodes, max_msec);
+}
+
+
+/* ======================= Move budget ======================== */
+
+
+/*
+ * genmove() gives the reading of each move a budget of
+ * move_node_budget nodes and move_time_budget milliseconds, with
+ * start_read_budget(). When it is used up, attack() gives up on
+ * every string with more than one liberty. This is the guess the
+ * reading already makes beyond the depths: a string which cannot be
+ * captured at once lives. find_defense() then takes the first move
+ * it tries, and the rest of the move is read in no time.
+ *
+ * Results read after that are not stored in the hash table or in
+ * the cache of safe_move(), since they would be wrong in later
+ * moves. stats.budget_cutoffs counts the calls of attack() given up.
+ *
+ * The clock is only looked at every READ_BUDGET_POLL checks. Each
+ * reading thread gets its share of the nodes left and the same
+ * deadline from get_read_budget() and set_read_budget(). The
+ * pondering thread is stopped the same way, by ponder_cancelled (see
+ * ponder.c).
+ */
+
+#define READ_BUDGET_POLL 64
+
+static ENGINE_LOCAL int read_node_limit = INT_MAX;  /* stats.nodes to stop at */
+static ENGINE_LOCAL double read_deadline = 0.0;     /* 0.0 for none */
+static ENGINE_LOCAL int read_polls = 0;
+static ENGINE_LOCAL int read_budget_spent = 0;
+
+
+/* Allow nodes more nodes (INT_MAX for any number) and reading until
+ * the time deadline, as given by gg_gettimeofday() (0.0 for no time
+ * limit).
+ */
+
+void
+set_read_budget(int nodes, double deadline)
+{
+  if (nodes > INT_MAX - stats.nodes)
+    read_node_limit = INT_MAX;
+  else
+    read_node_limit = stats.nodes + nodes;
+  read_deadline = deadline;
+  read_polls = 0;
+  read_budget_spent = 0;
+}
+
+
+void
+get_read_budget(int *nodes, double *deadline)
+{
+  if (read_node_limit == INT_MAX)
+    *nodes = INT_MAX;
+  else if (read_budget_spent || stats.nodes >= read_node_limit)
+    *nodes = 0;
+  else
+    *nodes = read_node_limit - stats.nodes;
+  *deadline = read_deadline;
+}
+
+
+/* Start a budget of nodes and msec from now. 0 means no limit. */
+
+void
+start_read_budget(int nodes, int msec)
+{
+  set_read_budget(nodes > 0 ? nodes : INT_MAX,
+		  msec > 0 ? gg_gettimeofday() + msec / 1000.0 : 0.0);
+}
+
+
+/* Return 1 if the budget is used up, counting the call as cut off. */
+
+static int
+read_budget_exhausted(void)
+{
+  if (!read_budget_spent) {
+    if (stats.nodes < read_node_limit
+	&& !(pondering && ponder_cancelled)
+	&& (read_deadline == 0.0
+	    || read_polls++ % READ_BUDGET_POLL != 0
+	    || gg_gettimeofday() < read_deadline))
+      return 0;
+    read_budget_spent = 1;
+    TRACE("The reading budget is used up after %d nodes.\n", stats.nodes);
+  }
+  stats.budget_cutoffs++;
+  return 1;
+}
+
+
 /* =================== Defensive functions ==================== */
 
 
@@ -250,7 +668,7 @@ find_defense(int m, int n, int *i, int *j)
 {
   int di, dj;
   int can_save;
-  int mylib=approxlib(m, n, p[m][n], 5);
+  int mylib=fastlib(m, n, p[m][n], 5);
   int             found_read_result;
   Read_result   * read_result;
   
@@ -289,6 +707,9 @@ find_defense(int m, int n, int *i, int *j)
   } else
     read_result = NULL;
 
+  if (read_hint(read_result, &di, &dj) && defense_hint(m, n, di, dj))
+    READ_RETURN(read_result, i, j, di, dj, 1);
+
 
   if (mylib==1) {
     can_save=(defend1(m, n, &di, &dj));
@@ -357,7 +778,7 @@ defend1(int si, int sj, int *i, int *j)
   
   DEBUG(DEBUG_LADDER, "defend1(%m)\n", si, sj);
   assert(p[si][sj]!=EMPTY);
-  if (approxlib(si,sj,p[si][sj],2)!=1) {
+  if (fastlib(si,sj,p[si][sj],2)!=1) {
     verbose=4;
     dump_stack();
     abort();
@@ -403,15 +824,13 @@ defend1(int si, int sj, int *i, int *j)
   }
   
   /* (di, dj) will be the liberty of the string. */
-  approxlib(si, sj, color, 2);
-  ASSERT(lib==1, si, sj);
-  di=libi[0];
-  dj=libj[0];
+  liberties=findlib(si, sj, color, 1, &di, &dj);
+  ASSERT(liberties==1, si, sj);
 
   /* Try to extend along our own liberty. */
   RTRACE("extending to %m.\n", di, dj);
   if (trymove(di, dj, color, "defend1-A", si, sj)) {
-    liberties=approxlib(di, dj, color, 5);
+    liberties=fastlib(di, dj, color, 5);
 
     /* If we are still in atari, or have no liberties at all, we lose. */
 
@@ -539,6 +958,7 @@ int
 defend2(int si, int sj, int *i, int *j)
 {
   int color, other, ai, aj, bi, bj, ci, cj, firstlib, secondlib;
+  int mi[2], mj[2], key[2];
   int savei=-1, savej=-1;
   int savecode=0;
   int acount=0, bcount=0;
@@ -553,7 +973,7 @@ defend2(int si, int sj, int *i, int *j)
   other=OTHER_COLOR(color);
 
   assert(p[si][sj]!=EMPTY);
-  assert(approxlib(si,sj,p[si][sj],3)==2);
+  assert(fastlib(si,sj,p[si][sj],3)==2);
 
   if ((stackp <= depth) && (hashflags & HASH_DEFEND2)) {
   
@@ -627,9 +1047,21 @@ defend2(int si, int sj, int *i, int *j)
     bj=libj[0];
   }
 
+  mi[0]=ai;
+  mj[0]=aj;
+  mi[1]=bi;
+  mj[1]=bj;
+  key[0]=(bcount>acount ? bcount : acount);
+  key[1]=(bcount>acount ? acount : bcount);
+  order_moves(2, mi, mj, key, color, read_result);
+  ai=mi[0];
+  aj=mj[0];
+  bi=mi[1];
+  bj=mj[1];
+
   RTRACE("trying extension to %m\n", ai, aj);
   if (trymove(ai, aj, color, "defend2-A", si, sj)) {
-    firstlib=approxlib(si, sj, color, 5);
+    firstlib=fastlib(si, sj, color, 5);
     if ((firstlib==2) && (attack2(si, sj, NULL, NULL))) firstlib=0;
     if ((stackp <= depth) && (firstlib==3) 
 	&& (attack3(si, sj, NULL, NULL))) firstlib=0;
@@ -638,6 +1070,7 @@ defend2(int si, int sj, int *i, int *j)
     popgo();
     if (firstlib>1) {
       RTRACE("%m rescues\n", ai, aj);
+      good_move(ai, aj, color);
       READ_RETURN(read_result, i, j, ai, aj, 1);
     }
     else 
@@ -649,7 +1082,7 @@ defend2(int si, int sj, int *i, int *j)
   if (firstlib<2 || i) {
     RTRACE("trying extension to %m\n", bi, bj);
     if (trymove(bi, bj, color, "defend2-B", si, sj)) {
-      secondlib=approxlib(si, sj, color, 5);
+      secondlib=fastlib(si, sj, color, 5);
       if ((firstlib>=secondlib)&&(firstlib>2))
 	{
 	  RTRACE("%m is not superior to first move\n",  bi, bj);
@@ -667,6 +1100,7 @@ defend2(int si, int sj, int *i, int *j)
 	else
 	  RTRACE("%m rescues, we'll use it\n",  bi, bj);
 	popgo();
+	good_move(bi, bj, color);
 	READ_RETURN(read_result, i, j, bi, bj, 1);
       }
       if (firstlib>1) {
@@ -715,7 +1149,7 @@ defend2(int si, int sj, int *i, int *j)
    */
 
   if ((stackp <= backfill_depth) 
-      && (approxlib(ai, aj, other, 1)==0) 
+      && (fastlib(ai, aj, other, 1)==0) 
       && (approxlib(ai, aj, color, 3)==2)) {
     if ((libi[0] != bi) || (libj[0] != bj)) {
       ci=libi[0];
@@ -743,7 +1177,7 @@ defend2(int si, int sj, int *i, int *j)
     }
   }
   if ((stackp <= backfill_depth) 
-      && (approxlib(bi, bj, other, 1)==0) 
+      && (fastlib(bi, bj, other, 1)==0) 
       && (approxlib(bi, bj, color, 3)==2)) {
     if ((libi[0] != ai) || (libj[0] != aj)) {
       ci=libi[0];
@@ -790,6 +1224,7 @@ int
 defend3(int si, int sj, int *i, int *j)
 {
   int color, ai, aj, bi, bj, ci, cj;
+  int mi[3], mj[3], key[3], k;
   int savei=-1, savej=-1;
   int bc=0;
   int             found_read_result;
@@ -802,7 +1237,7 @@ defend3(int si, int sj, int *i, int *j)
   color=p[si][sj];
 
   assert(p[si][sj]!=EMPTY);
-  assert(approxlib(si,sj,p[si][sj],4)==3);
+  assert(fastlib(si,sj,p[si][sj],4)==3);
 
   /* If we can capture a surrounding string, this is the best way to
      defend. */
@@ -857,50 +1292,48 @@ defend3(int si, int sj, int *i, int *j)
   /* before trying seriously, check if there is a simple solution. */
 
   if (stackp > fourlib_depth) {
-    if (approxlib(ai, aj, color, 4) > 3)
+    if (fastlib(ai, aj, color, 4) > 3)
       READ_RETURN(read_result, i, j, ai, aj, 1);
-    if (approxlib(bi, bj, color, 4) > 3) 
+    if (fastlib(bi, bj, color, 4) > 3) 
       READ_RETURN(read_result, i, j, bi, bj, 1);
-    if (approxlib(ci, cj, color, 4) > 3)
+    if (fastlib(ci, cj, color, 4) > 3)
       READ_RETURN(read_result, i, j, ci, cj, 1);
   }
   else {
-    if (approxlib(ai, aj, color, 5) > 4)
+    if (fastlib(ai, aj, color, 5) > 4)
       READ_RETURN(read_result, i, j, ai, aj, 1);
-    if (approxlib(bi, bj, color, 5) > 4)
+    if (fastlib(bi, bj, color, 5) > 4)
       READ_RETURN(read_result, i, j, bi, bj, 1);
-    if (approxlib(ci, cj, color, 5) > 4)
+    if (fastlib(ci, cj, color, 5) > 4)
       READ_RETURN(read_result, i, j, ci, cj, 1);
   }
 
   /* Nope, no quick solution available. Try reading further instead. */
 
-  RTRACE("trying extension to %m\n", ai, aj);
-  if (trymove(ai, aj, color, "defend3-A", si, sj)) {
-    if (!attack(si, sj, NULL, NULL)) {
-      popgo();
-      READ_RETURN(read_result, i, j, ai, aj, 1);
-    }
-    popgo();
-  } 
-
-  RTRACE("trying extension to %m\n", bi, bj);
-  if (trymove(bi, bj, color, "defend3-B", si, sj)) {
-    if (!attack(si, sj, NULL, NULL)) {
-      popgo();
-      READ_RETURN(read_result, i, j, bi, bj, 1);
-    }
-    popgo();
-  } 
-
-  RTRACE("trying extension to %m\n", ci, cj);
-  if (trymove(ci, cj, color, "defend3-C", si, sj)) {
-    if (!attack(si, sj, NULL, NULL)) {
+  mi[0]=ai;
+  mj[0]=aj;
+  mi[1]=bi;
+  mj[1]=bj;
+  mi[2]=ci;
+  mj[2]=cj;
+  /* The key is the liberty count order3() sorted by, so that the
+   * killers and the history only reorder liberties giving the same
+   * count.
+   */
+  for (k=0; k<3; k++)
+    key[k]=fastlib(mi[k], mj[k], color, 4);
+  order_moves(3, mi, mj, key, color, read_result);
+  for (k=0; k<3; k++) {
+    RTRACE("trying extension to %m\n", mi[k], mj[k]);
+    if (trymove(mi[k], mj[k], color, "defend3-A", si, sj)) {
+      if (!attack(si, sj, NULL, NULL)) {
+	popgo();
+	good_move(mi[k], mj[k], color);
+	READ_RETURN(read_result, i, j, mi[k], mj[k], 1);
+      }
       popgo();
-      READ_RETURN(read_result, i, j, ci, cj, 1);
     }
-    popgo();
-  } 
+  }
 
   if ((stackp <= backfill_depth) && break_chain2(si, sj, &ai, &aj))
     READ_RETURN(read_result, i, j, ai, aj, 1);
@@ -924,6 +1357,7 @@ int
 defend4(int si, int sj, int *i, int *j)
 {
   int color, ai, aj, bi, bj, ci, cj, di, dj;
+  int mi[4], mj[4], k;
   int savei=-1, savej=-1;
   int bc=0;
   int             found_read_result;
@@ -935,7 +1369,7 @@ defend4(int si, int sj, int *i, int *j)
   color=p[si][sj];
 
   assert(p[si][sj]!=EMPTY);
-  assert(approxlib(si,sj,p[si][sj],5)==4);
+  assert(fastlib(si,sj,p[si][sj],5)==4);
 
   /* If we can capture a surrounding string, this is the best way to
      defend. */
@@ -990,63 +1424,48 @@ defend4(int si, int sj, int *i, int *j)
   /* before trying seriously, check if there is a simple solution. */
 
   if (stackp > fourlib_depth) {
-    if (approxlib(ai, aj, color, 4) > 3)
+    if (fastlib(ai, aj, color, 4) > 3)
       READ_RETURN(read_result, i, j, ai, aj, 1);
-    if (approxlib(bi, bj, color, 4) > 3) 
+    if (fastlib(bi, bj, color, 4) > 3) 
       READ_RETURN(read_result, i, j, bi, bj, 1);
-    if (approxlib(ci, cj, color, 4) > 3)
+    if (fastlib(ci, cj, color, 4) > 3)
       READ_RETURN(read_result, i, j, ci, cj, 1);
-    if (approxlib(di, dj, color, 4) > 3)
+    if (fastlib(di, dj, color, 4) > 3)
       READ_RETURN(read_result, i, j, di, dj, 1);
   }
   else {
-    if (approxlib(ai, aj, color, 5) > 4)
+    if (fastlib(ai, aj, color, 5) > 4)
       READ_RETURN(read_result, i, j, ai, aj, 1);
-    if (approxlib(bi, bj, color, 5) > 4)
+    if (fastlib(bi, bj, color, 5) > 4)
       READ_RETURN(read_result, i, j, bi, bj, 1);
-    if (approxlib(ci, cj, color, 5) > 4)
+    if (fastlib(ci, cj, color, 5) > 4)
       READ_RETURN(read_result, i, j, ci, cj, 1);
-    if (approxlib(di, dj, color, 5) > 4)
+    if (fastlib(di, dj, color, 5) > 4)
       READ_RETURN(read_result, i, j, di, dj, 1);
   }
 
   /* Nope, no quick solution available. Try reading further instead. */
 
-  RTRACE("trying extension to %m\n", ai, aj);
-  if (trymove(ai, aj, color, "defend4-A", si, sj)) {
-    if (!attack(si, sj, NULL, NULL)) {
-      popgo();
-      READ_RETURN(read_result, i, j, ai, aj, 1);
-    }
-    popgo();
-  } 
-
-  RTRACE("trying extension to %m\n", bi, bj);
-  if (trymove(bi, bj, color, "defend4-B", si, sj)) {
-    if (!attack(si, sj, NULL, NULL)) {
-      popgo();
-      READ_RETURN(read_result, i, j, bi, bj, 1);
-    }
-    popgo();
-  } 
-
-  RTRACE("trying extension to %m\n", ci, cj);
-  if (trymove(ci, cj, color, "defend4-C", si, sj)) {
-    if (!attack(si, sj, NULL, NULL)) {
-      popgo();
-      READ_RETURN(read_result, i, j, ci, cj, 1);
-    }
-    popgo();
-  } 
-
-  RTRACE("trying extension to %m\n", di, dj);
-  if (trymove(di, dj, color, "defend4-D", si, sj)) {
-    if (!attack(si, sj, NULL, NULL)) {
+  mi[0]=ai;
+  mj[0]=aj;
+  mi[1]=bi;
+  mj[1]=bj;
+  mi[2]=ci;
+  mj[2]=cj;
+  mi[3]=di;
+  mj[3]=dj;
+  order_moves(4, mi, mj, NULL, color, read_result);
+  for (k=0; k<4; k++) {
+    RTRACE("trying extension to %m\n", mi[k], mj[k]);
+    if (trymove(mi[k], mj[k], color, "defend4-A", si, sj)) {
+      if (!attack(si, sj, NULL, NULL)) {
+	popgo();
+	good_move(mi[k], mj[k], color);
+	READ_RETURN(read_result, i, j, mi[k], mj[k], 1);
+      }
       popgo();
-      READ_RETURN(read_result, i, j, di, dj, 1);
     }
-    popgo();
-  } 
+  }
 
   if ((stackp <= backfill_depth) && break_chain2(si, sj, &ai, &aj))
     READ_RETURN(read_result, i, j, ai, aj, 1);
@@ -1240,6 +1659,9 @@ attack(int m, int n, int *i, int *j)
   } else
     read_result = NULL;
 
+  if (read_hint(read_result, &xi, &xj) && attack_hint(m, n, xi, xj))
+    READ_RETURN(read_result, i, j, xi, xj, 1);
+
   /* Treat the attack differently depending on how many liberties the 
      string at (m, n) has. */
   libs=approxlib(m, n, p[m][n], 5);
@@ -1266,6 +1688,10 @@ attack(int m, int n, int *i, int *j)
       result = 1;
     READ_RETURN(read_result, i, j, xi, xj, result);
   } 
+  else if (read_budget_exhausted()) {
+    /* Out of budget for this move. Guess that the string lives. */
+    return 0;
+  }
   else if (libs == 2) {
 
     /* attack2() can return 0, 1 or 2. */
@@ -1322,7 +1748,7 @@ attack2(int si, int sj, int *i, int *j)
   SETUP_TRACE_INFO("attack2", si, sj);
   find_origin(si, sj, &si, &sj);
   assert(p[si][sj]!=EMPTY);
-  assert(approxlib(si,sj,p[si][sj],3)==2);
+  assert(fastlib(si,sj,p[si][sj],3)==2);
   DEBUG(DEBUG_LADDER, "attack2(%m)\n", si, sj);
 
   RTRACE("checking attack on %m with 2 liberties\n", si, sj);
@@ -1377,9 +1803,7 @@ attack2(int si, int sj, int *i, int *j)
 	READ_RETURN(read_result, i, j, gi, gj, 1);
     }
 
-    approxlib(adji[r], adjj[r], p[adji[r]][adjj[r]], 2);
-    hi=libi[0];
-    hj=libj[0];
+    findlib(adji[r], adjj[r], p[adji[r]][adjj[r]], 1, &hi, &hj);
     if (trymove(hi, hj, other, "attack2-A", si, sj)) {
       if (attack(si, sj, NULL, NULL)) {
 	int dcode=find_defense(si, sj, NULL, NULL);
@@ -1459,7 +1883,7 @@ attack2(int si, int sj, int *i, int *j)
 	  && ((ai==board_size-1) || (p[ai+1][aj] != other))
 	  && ((aj==0) || (p[ai][aj-1] != other))
 	  && ((aj==board_size-1) || (p[ai][aj+1] != other)))
-      || approxlib(ai, aj, other, 2) >1 )
+      || fastlib(ai, aj, other, 2) >1 )
     if (trymove(ai, aj, other, "attack2-C", si, sj))
       {
 	can_save=defend1(si, sj, &di, &dj);
@@ -1480,11 +1904,10 @@ attack2(int si, int sj, int *i, int *j)
       }
 
   /* try backfilling if atari is impossible */
-  if ((stackp <= backfill_depth) && approxlib(ai, aj, other, 2)==1) {
+  if ((stackp <= backfill_depth) && fastlib(ai, aj, other, 2)==1) {
     int ui=-1, uj=-1;
 
-    ui=libi[0];
-    uj=libj[0];
+    findlib(ai, aj, other, 1, &ui, &uj);
     if (trymove(ui, uj, other, "attack2-D", si, sj))  {
       if (attack(si, sj, NULL, NULL) && 
 	  !find_defense(si, sj, NULL, NULL)) {
@@ -1511,7 +1934,7 @@ attack2(int si, int sj, int *i, int *j)
        && ((bi==board_size-1) || (p[bi+1][bj]!=other))
        && ((bj==0) || (p[bi][bj-1]!=other))
        && ((bj==board_size-1) || (p[bi][bj+1]!=other)))
-      || approxlib(bi, bj, other, 2) >1) {
+      || fastlib(bi, bj, other, 2) >1) {
     if (trymove(bi, bj, other, "attack2-E", si, sj))
       {
 	can_save=defend1(si, sj, &di, &dj);
@@ -1539,11 +1962,10 @@ attack2(int si, int sj, int *i, int *j)
   }
   
   /* try backfilling if atari is impossible */
-  if ((stackp <= backfill_depth) && (approxlib(bi, bj, other, 2)==1)) {
+  if ((stackp <= backfill_depth) && (fastlib(bi, bj, other, 2)==1)) {
     int ui=-1, uj=-1;
       
-    ui=libi[0];
-    uj=libj[0];
+    findlib(bi, bj, other, 1, &ui, &uj);
     if (trymove(ui, uj, other, "attack2-F", si, sj)) {
       if (attack(si, sj, NULL, NULL) 
 	  && !find_defense(si, sj, NULL, NULL)) {
@@ -1576,7 +1998,7 @@ attack2(int si, int sj, int *i, int *j)
    */
 
   if ((stackp <= backfill_depth) 
-      && (approxlib(ai, aj, other, 1)==0) 
+      && (fastlib(ai, aj, other, 1)==0) 
       && (approxlib(ai, aj, color, 3)==2)) {
     if ((libi[0] != bi) || (libj[0] != bj)) {
       ci=libi[0];
@@ -1585,7 +2007,7 @@ attack2(int si, int sj, int *i, int *j)
       ci=libi[1];
       cj=libj[1];
     }
-    if ((approxlib(ci, cj, other, 2)>1) 
+    if ((fastlib(ci, cj, other, 2)>1) 
 	&& trymove(ci, cj, other, "attack2-G", si, sj)) {
       if (attack(si, sj, NULL, NULL)) {
 	int dcode=find_defense(si, sj, NULL, NULL);
@@ -1607,7 +2029,7 @@ attack2(int si, int sj, int *i, int *j)
     }
   }
   if ((stackp <= backfill_depth) 
-      && (approxlib(bi, bj, other, 1)==0) 
+      && (fastlib(bi, bj, other, 1)==0) 
       && (approxlib(bi, bj, color, 3)==2)) {
     if ((libi[0] != ai) || (libj[0] != aj)) {
       ci=libi[0];
@@ -1616,7 +2038,7 @@ attack2(int si, int sj, int *i, int *j)
       ci=libi[1];
       cj=libj[1];
     }
-    if ((approxlib(ci, cj, other, 2)>1) 
+    if ((fastlib(ci, cj, other, 2)>1) 
 	&& trymove(ci, cj, other, "attack2-H", si, sj)) {
       if (attack(si, sj, NULL, NULL)) {
 	int dcode=find_defense(si, sj, NULL, NULL);
@@ -1665,6 +2087,7 @@ attack3(int ti, int tj, int *i, int *j)
   int color=p[ti][tj];
   int other=OTHER_COLOR(color);
   int ai, aj, bi, bj, ci, cj;
+  int mi[3], mj[3], key[3], k;
   int adj, adji[MAXCHAIN], adjj[MAXCHAIN], adjsize[MAXCHAIN], adjlib[MAXCHAIN];
   int r, gi, gj;
   int dcode=0;
@@ -1706,15 +2129,13 @@ attack3(int ti, int tj, int *i, int *j)
   chainlinks(ti, tj, &adj, adji, adjj, adjsize, adjlib);
   for (r=0; r<adj; r++)
     if (adjlib[r]==1) {
-      approxlib(adji[r], adjj[r], p[adji[r]][adjj[r]], 2);
-      
       /* If a component of the surrounding chain has just
        * one liberty, we try to defend it.
        */
 
-      gi=libi[0]; /* liberty of the jeapardized component */
-      gj=libj[0];
-      if (!mx[gi][gj] && (approxlib(gi, gj, other, 2) > 1)) {
+      /* liberty of the jeapardized component */
+      findlib(adji[r], adjj[r], p[adji[r]][adjj[r]], 1, &gi, &gj);
+      if (!mx[gi][gj] && (fastlib(gi, gj, other, 2) > 1)) {
 	if (trymove(gi, gj, other, "attack3-A", ti, tj)) {
 	  mx[gi][gj]=1;
 	  if (attack(ti, tj, NULL, NULL)) {
@@ -1772,52 +2193,35 @@ attack3(int ti, int tj, int *i, int *j)
   ci=libi[2];
   cj=libj[2];
   order3(&ai, &aj, &bi, &bj, &ci, &cj, ti, tj);
-  if (!mx[ai][aj] && trymove(ai, aj, other, "attack3-C", ti, tj)) {
-    mx[ai][aj]=1;
-    RTRACE("try attacking at %m ...\n", ai, aj);
-    dcode=find_defense(ti, tj, NULL, NULL);
-    if ((dcode != 1) && attack(ti, tj, NULL, NULL)) {
-      if (dcode == 0)
-	result = 1;
-      else if (dcode == 2)
-	result = 3;
-      else if (dcode == 3)
-	result = 2;
-      popgo();
-      READ_RETURN(read_result, i, j, ai, aj, result);
-    }
-    popgo();
-  }
-  if (!mx[bi][bj] && trymove(bi, bj, other, "attack3-D", ti, tj)) {
-    mx[bi][bj]=1;
-    RTRACE("try attacking at %m ...\n", bi, bj);
-    dcode=find_defense(ti, tj, NULL, NULL);
-    if ((dcode != 1) && attack(ti, tj, NULL, NULL)) {
-      if (dcode == 0)
-	result = 1;
-      else if (dcode == 2)
-	result = 3;
-      else if (dcode == 3)
-	result = 2;
-      popgo();
-      READ_RETURN(read_result, i, j, bi, bj, result);
-    }
-    popgo();
-  }
-  if (!mx[ci][cj] && trymove(ci, cj, other, "attack3-E", ti, tj)) {
-    RTRACE("try attacking at %m ...\n", ci, cj);
-    dcode=find_defense(ti, tj, NULL, NULL);
-    if ((dcode != 1) && attack(ti, tj, NULL, NULL)) {
-      if (dcode == 0)
-	result = 1;
-      else if (dcode == 2)
-	result = 3;
-      else if (dcode == 3)
-	result = 2;
+  mi[0]=ai;
+  mj[0]=aj;
+  mi[1]=bi;
+  mj[1]=bj;
+  mi[2]=ci;
+  mj[2]=cj;
+  /* As in defend3(), keep the order of order3(). */
+  for (k=0; k<3; k++)
+    key[k]=fastlib(mi[k], mj[k], color, 4);
+  order_moves(3, mi, mj, key, other, read_result);
+  for (k=0; k<3; k++) {
+    if (!mx[mi[k]][mj[k]]
+	&& trymove(mi[k], mj[k], other, "attack3-C", ti, tj)) {
+      mx[mi[k]][mj[k]]=1;
+      RTRACE("try attacking at %m ...\n", mi[k], mj[k]);
+      dcode=find_defense(ti, tj, NULL, NULL);
+      if ((dcode != 1) && attack(ti, tj, NULL, NULL)) {
+	if (dcode == 0)
+	  result = 1;
+	else if (dcode == 2)
+	  result = 3;
+	else if (dcode == 3)
+	  result = 2;
+	popgo();
+	good_move(mi[k], mj[k], other);
+	READ_RETURN(read_result, i, j, mi[k], mj[k], result);
+      }
       popgo();
-      READ_RETURN(read_result, i, j, ci, cj, result);
     }
-    popgo();
   }
 
   READ_RETURN0(read_result);
@@ -1834,6 +2238,7 @@ attack4(int i, int j, int *ti, int *tj)
   int color=p[i][j];
   int other=OTHER_COLOR(color);
   int ai, aj, bi, bj, ci, cj, di, dj, gi, gj, r;
+  int mi[4], mj[4], k;
   int mx[MAX_BOARD][MAX_BOARD];  
   int adj, adji[MAXCHAIN], adjj[MAXCHAIN], adjsize[MAXCHAIN], adjlib[MAXCHAIN];
 
@@ -1851,13 +2256,11 @@ attack4(int i, int j, int *ti, int *tj)
   chainlinks(i, j, &adj, adji, adjj, adjsize, adjlib);
   for (r=0; r<adj; r++)
     if (adjlib[r]==1) {
-      approxlib(adji[r], adjj[r], p[adji[r]][adjj[r]], 2);
-      gi=libi[0];
-      gj=libj[0];
+      findlib(adji[r], adjj[r], p[adji[r]][adjj[r]], 1, &gi, &gj);
 
       /* If moving out results in more than one liberty,
          we resume the attack. */
-      if (!mx[gi][gj] && (approxlib(gi, gj, other, 2) > 1)) {
+      if (!mx[gi][gj] && (fastlib(gi, gj, other, 2) > 1)) {
 	if (trymove(gi, gj, other, "attack4-A", i, j)) {
 	  mx[gi][gj]=1;
 	  if (attack(i, j, NULL, NULL) && !find_defense(i, j, NULL, NULL)) {
@@ -1887,57 +2290,30 @@ attack4(int i, int j, int *ti, int *tj)
   di=libi[3];
   dj=libj[3];
   
-  if (trymove(ai, aj, other, "attack4-B", i, j)) {
-    RTRACE("try attacking at %m ...\n", ai, aj);
-    if ((approxlib(i, j, color, 3)==3) 
-	&& !find_defense(i, j, NULL, NULL)
-	&& attack(i, j, NULL, NULL) 
-	&& !attack(ai, aj, NULL, NULL)) {
-      if (ti) *ti=ai;
-      if (tj) *tj=aj;
-      popgo();
-      return (1);
-    }
-    popgo();
-  }
-  if (trymove(bi, bj, other, "attack4-C", i, j)) {
-    RTRACE("try attacking at %m ...\n", bi, bj);
-    if ((approxlib(i, j, color, 3)==3) 
-	&& !find_defense(i, j, NULL, NULL)
-	&& attack(i, j, NULL, NULL) 
-	&& !attack(bi, bj, NULL, NULL)) {
-      if (ti) *ti=bi;
-      if (tj) *tj=bj;
-      popgo();
-      return (1);
-    }
-    popgo();
-  }
-  if (trymove(ci, cj, other, "attack4-D", i, j)) {
-    RTRACE("try attacking at %m ...\n", ci, cj);
-    if ((approxlib(i, j, color, 3)==3) 
-	&& !find_defense(i, j, NULL, NULL)
-	&& attack(i, j, NULL, NULL) 
-	&& !attack(ci, cj, NULL, NULL)) {
-      if (ti) *ti=ci;
-      if (tj) *tj=cj;
-      popgo();
-      return (1);
-    }
-    popgo();
-  }
-  if (trymove(di, dj, other, "attack4-E", i, j)) {
-    RTRACE("try attacking at %m ...\n", di, dj);
-    if ((approxlib(i, j, color, 3)==3) 
-	&& !find_defense(i, j, NULL, NULL)
-	&& attack(i, j, NULL, NULL) 
-	&& !attack(di, dj, NULL, NULL)) {
-      if (ti) *ti=di;
-      if (tj) *tj=dj;
+  mi[0]=ai;
+  mj[0]=aj;
+  mi[1]=bi;
+  mj[1]=bj;
+  mi[2]=ci;
+  mj[2]=cj;
+  mi[3]=di;
+  mj[3]=dj;
+  order_moves(4, mi, mj, NULL, other, NULL);
+  for (k=0; k<4; k++) {
+    if (trymove(mi[k], mj[k], other, "attack4-B", i, j)) {
+      RTRACE("try attacking at %m ...\n", mi[k], mj[k]);
+      if ((fastlib(i, j, color, 3)==3) 
+	  && !find_defense(i, j, NULL, NULL)
+	  && attack(i, j, NULL, NULL) 
+	  && !attack(mi[k], mj[k], NULL, NULL)) {
+	if (ti) *ti=mi[k];
+	if (tj) *tj=mj[k];
+	popgo();
+	good_move(mi[k], mj[k], other);
+	return (1);
+      }
       popgo();
-      return (1);
     }
-    popgo();
   }
   return (0);
 }
@@ -2020,9 +2396,9 @@ find_cap2(int m, int n, int *i, int *j)
  * first).
  */
 
-static char chainlinks_ma[MAX_BOARD][MAX_BOARD];
-static char chainlinks_ml[MAX_BOARD][MAX_BOARD];
-static char chainlinks_mark = -1;
+static ENGINE_LOCAL char chainlinks_ma[MAX_BOARD][MAX_BOARD];
+static ENGINE_LOCAL char chainlinks_ml[MAX_BOARD][MAX_BOARD];
+static ENGINE_LOCAL char chainlinks_mark = -1;
 
 static void
 init_chainlinks(void)
@@ -2041,6 +2417,8 @@ chainlinks(int m, int n, int *adj, int adji[MAXCHAIN], int adjj[MAXCHAIN],
   if (chainlinks_mark == 0) { /* We have wrapped around, reinitialize. */
     init_chainlinks();
   }
+  if (stackp == 0)
+    strings_sync();
   
   (*adj)=0;
   
@@ -2052,7 +2430,8 @@ chainlinks(int m, int n, int *adj, int adji[MAXCHAIN], int adjj[MAXCHAIN],
 /* worker fn for chainlinks.
  * ma and ml store state about where we have been.
  * ma stores which elements of the surrounded chain have been visited.
- * ml (via count()) stores which surrounding stones have been visited.
+ * ml stores which surrounding strings have been found, by marking
+ * their origins.
  *
  * Algorithm :
  *   Mark ma[i][j] as done.
@@ -2060,11 +2439,32 @@ chainlinks(int m, int n, int *adj, int adji[MAXCHAIN], int adjj[MAXCHAIN],
  *    - for any which are the same color and not yet visited,
  *      save them in an internal stack for later visit.
  *    - any which are the opposite colour, make a note if not visited,
- *      and use count() to mark them all as visited.
+ *      taking the size and liberties from the string table.
  */
 
-static int seedi[MAXCHAIN];
-static int seedj[MAXCHAIN];
+static ENGINE_LOCAL int seedi[MAXCHAIN];
+static ENGINE_LOCAL int seedj[MAXCHAIN];
+
+#define CHAIN_VISIT(m, n) \
+  do { \
+    if (board[POS(m, n)] == other) { \
+      int oi, oj; \
+      string_origin(m, n, &oi, &oj); \
+      if (ml[oi][oj] != mark) { \
+	ml[oi][oj] = mark; \
+	adjlib[(*adj)] = countlib(m, n, other); \
+	adji[(*adj)] = m; \
+	adjj[(*adj)] = n; \
+	adjsize[(*adj)] = countstones(m, n); \
+	++(*adj); \
+      } \
+    } \
+    else if (board[POS(m, n)] == color && ma[m][n] != mark) { \
+      seedi[seedp] = m; \
+      seedj[seedp] = n; \
+      seedp++; \
+    } \
+  } while (0)
 
 static void 
 chain(int i, int j, char ma[MAX_BOARD][MAX_BOARD],
@@ -2072,7 +2472,6 @@ chain(int i, int j, char ma[MAX_BOARD][MAX_BOARD],
       int adjj[MAXCHAIN], int adjsize[MAXCHAIN], int adjlib[MAXCHAIN],
       char mark)
 {
-  int k;
   int seedp;
   int color=p[i][j];
   int other=OTHER_COLOR(color);
@@ -2091,89 +2490,16 @@ chain(int i, int j, char ma[MAX_BOARD][MAX_BOARD],
       continue;
     ma[i][j] = mark;
 
-    /* check North neighbor */
-    if (i != 0) {
-      if ((p[i-1][j] == other) && ma[i-1][j] != mark && ml[i-1][j] != mark) {
-	adjlib[(*adj)] = count(i-1, j, other, ml, 99999, mark);
-	for(k=0; k<lib; k++)
-	  ml[libi[k]][libj[k]] = mark-1;
-	adji[(*adj)] = i-1;
-	adjj[(*adj)] = j;
-	adjsize[(*adj)] = size;
-	++(*adj);
-	ma[i-1][j] = mark;
-      } 
-      else {
-	if ((p[i-1][j] == color) && ma[i-1][j] != mark) {
-	  seedi[seedp] = i-1;
-	  seedj[seedp] = j;
-	  seedp++;
-	}
-      }
-    }
-    /* check South neighbor */
-    if (i != board_size-1) {
-      if ((p[i+1][j] == other) && ma[i+1][j] != mark && ml[i+1][j] != mark) {
-	adjlib[(*adj)] = count(i+1, j, other, ml, 99999, mark);
-	for(k = 0; k < lib; k++)
-	  ml[libi[k]][libj[k]] = mark-1;
-	adji[(*adj)] = i+1;
-	adjj[(*adj)] = j;
-	adjsize[(*adj)] = size;
-	++(*adj);
-	ma[i+1][j] = mark;
-      }
-      else {
-	if ((p[i+1][j] == color) && ma[i+1][j] != mark) {
-	  seedi[seedp] = i+1;
-	  seedj[seedp] = j;
-	  seedp++;
-	}
-      }
-    }
-    /* check West neighbor */
-    if (j != 0) {
-      if ((p[i][j-1] == other) && ma[i][j-1] != mark && ml[i][j-1] !=mark) {
-	adjlib[(*adj)] = count(i, j-1, other, ml, 99999, mark);
-	for(k = 0; k < lib; k++)
-	    ml[libi[k]][libj[k]] = mark-1;
-	adji[(*adj)] = i;
-	adjj[(*adj)] = j-1;
-	adjsize[(*adj)] = size;
-	++(*adj);
-	ma[i][j-1] = mark;
-      }
-      else {
-	if ((p[i][j-1] == color) && ma[i][j-1] != mark) {
-	  seedi[seedp] = i;
-	  seedj[seedp] = j-1;
-	  seedp++;
-	}
-      }
-    }
-    /* check East neighbor */
-    if (j != board_size-1) {
-      if ((p[i][j+1] == other) && ma[i][j+1] != mark && ml[i][j+1] != mark) {
-	adjlib[(*adj)] = count(i, j+1, other, ml, 99999, mark);
-	for(k = 0; k < lib; k++)
-	  ml[libi[k]][libj[k]] = mark-1;
-	adji[(*adj)] = i;
-	adjj[(*adj)] = j+1;
-	adjsize[(*adj)] = size;
-	++(*adj);
-	ma[i][j+1] = mark;
-	}
-      else {
-	if ((p[i][j+1] == color) && ma[i][j+1] != mark) {
-	  seedi[seedp] = i;
-	  seedj[seedp] = j+1;
-	  seedp++;
-	}
-      }
-    }
+    /* Check the neighbors. The border of board[] is neither color. */
+    CHAIN_VISIT(i-1, j);
+    CHAIN_VISIT(i+1, j);
+    CHAIN_VISIT(i, j-1);
+    CHAIN_VISIT(i, j+1);
   }
 } 
 
+#undef CHAIN_VISIT
+
 
 
 /* 
@@ -2202,6 +2528,8 @@ break_chain(int si, int sj, int *i, int *j, int *k, int *l)
   int ai, aj, ci, cj;
   int adj, adji[MAXCHAIN], adjj[MAXCHAIN], adjsize[MAXCHAIN], adjlib[MAXCHAIN];
   int savei = -1, savej = -1, savek=-1, savel=-1, savecode=0;
+  int num, v, mi[MAXCHAIN], mj[MAXCHAIN], mr[MAXCHAIN];
+  int ci_of[MAXCHAIN], cj_of[MAXCHAIN];
   
   RTRACE("in break_chain at %m\n", si, sj);
   color=p[si][sj];
@@ -2215,52 +2543,70 @@ break_chain(int si, int sj, int *i, int *j, int *k, int *l)
     }
     RTRACE("%o\n");
   }
-  for (r=0; r<adj; r++) {
-    ai=adji[r];
-    aj=adjj[r];
-    if (approxlib(ai, aj, p[ai][aj], 2)==1) {
-      ci=libi[0];
-      cj=libj[0];
-      if (trymove(ci, cj, color, "break_chain-A", si, sj)) {
-	int acode=attack(si, sj, NULL, NULL);
-	if (acode != 1) {
-	  RTRACE("%m found to defend %m by attacking %m\n", 
-		 ci, cj, si, sj, ai, aj);
-	  if ((acode != 0) || attack(ci, cj, NULL, NULL)) {
-	    savei=ci;
-	    savej=cj;
-	      savek=ai;
-	      savel=aj;
-	      if (acode==0)
-		savecode=1;
-	      else if (acode==2)
-		savecode=3;
-	      else if (acode==3)
-		savecode=2;
-	      popgo();
-	  }
-	  else {
-	    if (i) *i=ci;
-	    if (j) *j=cj;
-	    if (k) *k=ai;
-	    if (l) *l=aj;
-	    popgo();
-	    return (1);
-	  }
-	}
-	else popgo();
-      } else {
-	if ((stackp <= ko_depth) && (savecode==0) && is_ko(ci, cj, color)) {
-	  if (tryko(ci, cj, color, "break_chain-B")) {
-	    if (attack(si, sj, NULL, NULL) != -1) {
-	      savei=ci;
-	      savej=cj;
-	      savek=ai;
-	      savel=aj;
+
+  /* Collect the liberties of the boundary strings in atari and try
+   * them in the order of order_moves().
+   */
+  num=0;
+  for (r=0; r<adj; r++)
+    if (findlib(adji[r], adjj[r], p[adji[r]][adjj[r]], 1,
+		&mi[num], &mj[num])==1) {
+      mr[num]=r;
+      num++;
+    }
+  memcpy(ci_of, mi, num * sizeof(int));
+  memcpy(cj_of, mj, num * sizeof(int));
+  order_moves(num, mi, mj, NULL, color, NULL);
+
+  for (v=0; v<num; v++) {
+    ci=mi[v];
+    cj=mj[v];
+    /* Find the string in atari with this liberty. */
+    for (r=0; ci_of[r] != ci || cj_of[r] != cj; r++)
+      ;
+    ci_of[r] = -1;
+    ai=adji[mr[r]];
+    aj=adjj[mr[r]];
+    if (trymove(ci, cj, color, "break_chain-A", si, sj)) {
+      int acode=attack(si, sj, NULL, NULL);
+      if (acode != 1) {
+	RTRACE("%m found to defend %m by attacking %m\n", 
+	       ci, cj, si, sj, ai, aj);
+	if ((acode != 0) || attack(ci, cj, NULL, NULL)) {
+	  savei=ci;
+	  savej=cj;
+	    savek=ai;
+	    savel=aj;
+	    if (acode==0)
+	      savecode=1;
+	    else if (acode==2)
 	      savecode=3;
-	    }
+	    else if (acode==3)
+	      savecode=2;
 	    popgo();
+	}
+	else {
+	  if (i) *i=ci;
+	  if (j) *j=cj;
+	  if (k) *k=ai;
+	  if (l) *l=aj;
+	  popgo();
+	  good_move(ci, cj, color);
+	  return (1);
+	}
+      }
+      else popgo();
+    } else {
+      if ((stackp <= ko_depth) && (savecode==0) && is_ko(ci, cj, color)) {
+	if (tryko(ci, cj, color, "break_chain-B")) {
+	  if (attack(si, sj, NULL, NULL) != -1) {
+	    savei=ci;
+	    savej=cj;
+	    savek=ai;
+	    savel=aj;
+	    savecode=3;
 	  }
+	  popgo();
 	}
       }
     }
@@ -2426,7 +2772,7 @@ break_chain2(int si, int sj, int *i, int *j)
 	      }
 	    }
 	  }
-	  if (approxlib(bi, bj, other,2)==1)
+	  if (fastlib(bi, bj, other,2)==1)
 	    try_harder=1;
 	  popgo();
 	}
@@ -2569,9 +2915,7 @@ relative_break_chain(int si, int sj, int *i, int *j, int ti, int tj)
   for (r=0; r<adj; r++) {
     ai=adji[r];
     aj=adjj[r];
-    if (approxlib(ai, aj, p[ai][aj], 2)==1) {
-      ci=libi[0];
-      cj=libj[0];
+    if (findlib(ai, aj, p[ai][aj], 1, &ci, &cj)==1) {
       if (trymove(ci, cj, color, "relative_break_chain", si, sj)) {
 	if (attack(ti, tj, NULL, NULL) && !find_defense(ti, tj, NULL, NULL)) {
 	  RTRACE("%m found to attack %m by defending %m\n", 
@@ -2604,9 +2948,9 @@ order3(int *ai, int *aj, int *bi, int *bj, int *ci, int *cj, int si, int sj)
   int alib, blib, clib;
   int ti, tj, tlib;
 
-  alib=approxlib(*ai, *aj, color, 4);
-  blib=approxlib(*bi, *bj, color, 4);
-  clib=approxlib(*ci, *cj, color, 4);
+  alib=fastlib(*ai, *aj, color, 4);
+  blib=fastlib(*bi, *bj, color, 4);
+  clib=fastlib(*ci, *cj, color, 4);
   if (blib>alib) {
     ti=*ai;
     tj=*aj;
@@ -2643,6 +2987,132 @@ order3(int *ai, int *aj, int *bi, int *bj, int *ci, int *cj, int si, int sj)
 }
 
 
+/*
+ * Move ordering shared by the reading functions. Where a function has
+ * a list of moves to try, order_moves() sorts them so that the moves
+ * most likely to work come first:
+ *
+ * - the move from a result read with a lower depth (see read_hint()),
+ * - then by key[], if the caller has its own idea of which moves are
+ *   better (such as the liberties counted by order3()),
+ * - then the killer moves: the last two moves of the same color which
+ *   worked at the same stackp,
+ * - then by the history of the point: how often, and how high in the
+ *   tree, a move of that color there has worked during the move.
+ *
+ * Moves which score the same keep their order. good_move() is called
+ * when a move works. The killers are cleared and the history halved
+ * at each new move. With move_ordering 0, nothing is reordered.
+ *
+ * The killers and the history come after key[] because they do
+ * worse than the heuristics they would replace: with them first,
+ * the regression games need 10-35% more nodes.
+ */
+
+#define KILLER_SLOTS  2
+#define KILLER_SCORE  (1 << 29)
+#define HISTORY_MAX   (1 << 20)
+
+static ENGINE_LOCAL int killer[MAXSTACK][2][KILLER_SLOTS];
+static ENGINE_LOCAL int history[2][BOARDMAX];
+static ENGINE_LOCAL int ordering_movenum = -1;
+
+static void
+age_move_ordering(void)
+{
+  int pos;
+
+  if (ordering_movenum == movenum)
+    return;
+  ordering_movenum = movenum;
+  memset(killer, 0, sizeof(killer));
+  for (pos = 0; pos < BOARDMAX; pos++) {
+    history[0][pos] >>= 1;
+    history[1][pos] >>= 1;
+  }
+}
+
+
+static void
+order_moves(int num, int mi[], int mj[], int key[], int color,
+	    Read_result *read_result)
+{
+  int first[MAXLIBS];
+  int score[MAXLIBS];
+  int hinti = -1, hintj = -1;
+  int *slot;
+  int pos;
+  int k, l;
+  int ti, tj, tfirst, tscore;
+
+  if (!move_ordering || num < 2)
+    return;
+  age_move_ordering();
+  read_hint(read_result, &hinti, &hintj);
+  slot = killer[stackp][color == BLACK];
+
+  for (k = 0; k < num; k++) {
+    pos = POS(mi[k], mj[k]);
+    if (mi[k] == hinti && mj[k] == hintj)
+      first[k] = INT_MAX;
+    else
+      first[k] = key ? key[k] : 0;
+    if (pos == slot[0])
+      score[k] = KILLER_SCORE + 1;
+    else if (pos == slot[1])
+      score[k] = KILLER_SCORE;
+    else
+      score[k] = history[color == BLACK][pos];
+  }
+
+  /* Insertion sort, which keeps moves with the same score in order. */
+  for (k = 1; k < num; k++) {
+    ti = mi[k];
+    tj = mj[k];
+    tfirst = first[k];
+    tscore = score[k];
+    for (l = k; l > 0 && (first[l-1] < tfirst
+			  || (first[l-1] == tfirst && score[l-1] < tscore));
+	 l--) {
+      mi[l] = mi[l-1];
+      mj[l] = mj[l-1];
+      first[l] = first[l-1];
+      score[l] = score[l-1];
+    }
+    mi[l] = ti;
+    mj[l] = tj;
+    first[l] = tfirst;
+    score[l] = tscore;
+  }
+}
+
+
+static void
+good_move(int i, int j, int color)
+{
+  int *slot;
+  int *h;
+  int pos = POS(i, j);
+  int height = depth - stackp > 1 ? depth - stackp : 1;
+
+  if (!move_ordering)
+    return;
+  age_move_ordering();
+  slot = killer[stackp][color == BLACK];
+  if (slot[0] != pos) {
+    slot[1] = slot[0];
+    slot[0] = pos;
+  }
+
+  h = &history[color == BLACK][pos];
+  *h += height * height;
+  if (*h > HISTORY_MAX) {
+    for (pos = 0; pos < BOARDMAX; pos++)
+      history[color == BLACK][pos] >>= 1;
+  }
+}
+
+
 /* ============== Reading utilities ================= */
 
 
@@ -2707,8 +3177,9 @@ snapback(int si, int sj, int i, int j, int color)
 
 
 
-static int safe_move_cache[MAX_BOARD][MAX_BOARD][2];
-static int safe_move_cache_when[MAX_BOARD][MAX_BOARD][2];
+static ENGINE_LOCAL int safe_move_cache[MAX_BOARD][MAX_BOARD][2];
+static ENGINE_LOCAL int safe_move_cache_when[MAX_BOARD][MAX_BOARD][2];
+static ENGINE_LOCAL int safe_move_cache_depth[MAX_BOARD][MAX_BOARD][2];
 
 void
 clear_safe_move_cache(void)
@@ -2722,18 +3193,40 @@ clear_safe_move_cache(void)
 }
 
 /* safe_move(i, j, color) checks whether a move at (i, j) is illegal
- * or can immediately be captured. If stackp==0 the result is cached.
- * If the move only can be captured by a ko, it's considered safe.
- * This may or may not be a good convention.
+ * or can immediately be captured. If stackp==0 the result is cached,
+ * together with the depth it was read with. Inside reading it is
+ * stored in the hash table under the routine SAFE_MOVE for white and
+ * SAFE_MOVE+1 for black, if HASH_SAFE_MOVE is set in hashflags. The
+ * lookups and hits are counted per stackp. If the move only can be
+ * captured by a ko, it's considered safe. This may or may not be a
+ * good convention.
  */
 
 int 
 safe_move(int i, int j, int color)
 {
   int safe=0;
+  int level = stackp < STATS_DEPTHS ? stackp : STATS_DEPTHS - 1;
+  int routine = SAFE_MOVE + (color == BLACK);
+  int             found_read_result;
+  Read_result   * read_result = NULL;
 
-  if (stackp == 0 && safe_move_cache_when[i][j][color==BLACK] == movenum)
+  stats.safe_move_lookups[level]++;
+  if (stackp == 0 && safe_move_cache_when[i][j][color==BLACK] == movenum
+      && safe_move_cache_depth[i][j][color==BLACK] >= depth) {
+    stats.safe_move_hits[level]++;
     return safe_move_cache[i][j][color==BLACK];
+  }
+
+  if (stackp > 0 && stackp <= depth && (hashflags & HASH_SAFE_MOVE)) {
+    found_read_result = get_read_result(routine, &i, &j, &read_result);
+    if (found_read_result) {
+      stats.safe_move_hits[level]++;
+      return rr_get_result(*read_result);
+    }
+    if (read_result)
+      rr_set_routine_i_j_stackp(*read_result, routine, i, j, stackp);
+  }
 
   if (trymove(i, j, color, "safe_move", -1, -1)) {
     int acode = attack(i, j, NULL, NULL);
@@ -2742,9 +3235,15 @@ safe_move(int i, int j, int color)
     popgo();
   }
   
-  if (stackp == 0) {
+  /* Results read out of budget are not kept, see read_budget_exhausted(). */
+  if (stackp == 0 && !read_budget_spent) {
     safe_move_cache_when[i][j][color==BLACK] = movenum;
     safe_move_cache[i][j][color==BLACK] = safe;
+    safe_move_cache_depth[i][j][color==BLACK] = depth;
+  }
+  else if (read_result && !read_budget_spent) {
+    rr_set_result_ri_rj(*read_result, safe, 0, 0);
+    rr_set_depth(*read_result, depth);
   }
   return safe;
 }
@@ -2797,7 +3296,7 @@ naive_ladder(int si, int sj, int *i, int *j)
   int liberties;
   
   assert(p[si][sj] != EMPTY);
-  assert(approxlib(si, sj, p[si][sj], 3)==2);
+  assert(fastlib(si, sj, p[si][sj], 3)==2);
   DEBUG(DEBUG_LADDER, "naive_ladder(%m)\n", si, sj);
 
   RTRACE("checking ladder attack on %m with 2 liberties\n", si, sj);
@@ -2886,7 +3385,7 @@ naive_ladder_defense(int si, int sj, int ai, int aj, int bi, int bj,
 
   /* Try to run away by extending on the last liberty. */
   if (trymove(bi, bj, color, "naive_ladder_defense", si, sj)) {
-    liberties = approxlib(si, sj, color, 3);
+    liberties = fastlib(si, sj, color, 3);
     if (liberties >= 3
 	|| (liberties == 2
 	    && !naive_ladder(si, sj, NULL, NULL))) {
@@ -2938,6 +3437,7 @@ naive_ladder_break_through(int si, int sj, int ai, int aj,
 			   int color, int other)
 {
   int liberties;
+  int bi, bj;
   
   if (ai < 0
       || ai >= board_size
@@ -2948,11 +3448,11 @@ naive_ladder_break_through(int si, int sj, int ai, int aj,
   if (p[ai][aj] != other)
     return 0;
   
-  if (approxlib(ai, aj, other, 2) != 1)
+  if (findlib(ai, aj, other, 1, &bi, &bj) != 1)
     return 0;
 
-  if (trymove(libi[0], libj[0], color, "naive_ladder_break_through", si, sj)) {
-    liberties = approxlib(si, sj, color, 3);
+  if (trymove(bi, bj, color, "naive_ladder_break_through", si, sj)) {
+    liberties = fastlib(si, sj, color, 3);
     if (liberties >= 3
 	|| (liberties == 2
 	    && !naive_ladder(si, sj, NULL, NULL))) {
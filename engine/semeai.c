@@ -353,8 +353,8 @@ semeai_analyzer(int m, int n, int i, int j, int *ti, int *tj, int color)
 	      {
 		if (!attack(m, n, NULL, NULL)) {
 		  int delta;
-		  delta = (approxlib(m,n,color,worm[m][n].liberties+2) 
-			   - approxlib(i,j,other,worm[i][j].liberties) 
+		  delta = (fastlib(m,n,color,worm[m][n].liberties+2) 
+			   - fastlib(i,j,other,worm[i][j].liberties) 
 			   > worm[m][n].liberties - worm[i][j].liberties);
 		  if (delta > commonlib_value) {
 		    commonlibi=k;
@@ -377,7 +377,7 @@ semeai_analyzer(int m, int n, int i, int j, int *ti, int *tj, int color)
 	    yourlibs++;
 	    if (trymove(k, l, color, "semeai", -1, -1)) {
 	      if (!attack(m, n, NULL, NULL)) {
-		currentlib=approxlib(k, l, color, bestlib+1);
+		currentlib=fastlib(k, l, color, bestlib+1);
 		if ((yourlibi==-1) || (currentlib > bestlib)) {
 		  yourlibi=k;
 		  yourlibj=l;
@@ -31,10 +31,10 @@
 #include "patterns.h"
 
 /* to collect values across callbacks */
-static int shapes_i;
-static int shapes_j;
-static int shapes_val;
-static int shapes_equal_moves;
+static ENGINE_LOCAL int shapes_i;
+static ENGINE_LOCAL int shapes_j;
+static ENGINE_LOCAL int shapes_val;
+static ENGINE_LOCAL int shapes_equal_moves;
 
 
 /* 
@@ -191,6 +191,13 @@ shapes_callback(int m, int n, int color, struct pattern *pattern, int ll)
       goto match_failed;
     }
   }
+
+  /* Only now is the constraint worth checking. */
+  if (!pattern_constraint(m, n, color, pattern, ll)) {
+    DEBUG(DEBUG_HELPER, "  constraint of '%s'+%d rejects %m\n",
+	  pattern->name, ll, ti, tj);
+    goto match_failed;
+  }
   
 
   /* and work out the value of this move */
@@ -419,7 +426,7 @@ shapes_callback(int m, int n, int color, struct pattern *pattern, int ll)
   /* Add pattern dependent random variation. */
   tval += pattern->minrand;
   if (pattern->minrand != pattern->maxrand)
-    tval += rand() % (pattern->maxrand - pattern->minrand + 1);
+    tval += engine_random() % (pattern->maxrand - pattern->minrand + 1);
   
   if (tval >= shapes_val && confirm_safety(ti, tj, color, 0))
     if (BETTER_MOVE(tval, shapes_val, shapes_equal_moves)) {
@@ -455,14 +462,14 @@ shapes(int *i, int *j, int *val, int *equal_moves, int color)
   for (m = 0; m < board_size; m++)
     for (n = 0; n < board_size; n++)
       if (p[m][n])
-	matchpat(m, n, shapes_callback, color, shapes_val, pat);
+	matchpat(m, n, shapes_callback, color, shapes_val, &pat_db);
 
   if (shapes_val <= 0)
     return 0;
 
   if ((shapes_val > *val) 
       || ((shapes_val == *val)
-	  && ((rand() % (shapes_equal_moves + *equal_moves -2)) 
+	  && ((engine_random() % (shapes_equal_moves + *equal_moves -2)) 
 	      < (shapes_equal_moves -1)))) 
   {
     if (shapes_val == *val)
@@ -538,9 +545,9 @@ wind_assistance(int i, int j, int color, int *params)
  *
  */
 
-static int cached_at_move[MAX_BOARD][MAX_BOARD];
-static int cached_upower[MAX_BOARD][MAX_BOARD];
-static int cached_mypower[MAX_BOARD][MAX_BOARD];
+static ENGINE_LOCAL int cached_at_move[MAX_BOARD][MAX_BOARD];
+static ENGINE_LOCAL int cached_upower[MAX_BOARD][MAX_BOARD];
+static ENGINE_LOCAL int cached_mypower[MAX_BOARD][MAX_BOARD];
 
 /* 
  * This should be called after backstepping to invalidate old values. 
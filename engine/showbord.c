@@ -67,10 +67,10 @@
  */
 
 /* Element at origin of each worm stores allocated worm number. */
-static unsigned char dragon_num[MAX_BOARD][MAX_BOARD];
+static ENGINE_LOCAL unsigned char dragon_num[MAX_BOARD][MAX_BOARD];
 
-static int next_white;		/* next worm number to allocate */
-static int next_black;
+static ENGINE_LOCAL int next_white;		/* next worm number to allocate */
+static ENGINE_LOCAL int next_black;
 
 
 #ifdef CURSES
@@ -0,0 +1,723 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *\
+ * This is GNU GO, a Go program. Contact gnugo@gnu.org, or see   *
+ * http://www.gnu.org/software/gnugo/ for more information.      *
+ *                                                               *
+ * Copyright 1999 and 2000 by the Free Software Foundation.      *
+ *                                                               *
+ * This program is free software; you can redistribute it and/or *
+ * modify it under the terms of the GNU General Public License   *
+ * as published by the Free Software Foundation - version 2.     *
+ *                                                               *
+ * This program is distributed in the hope that it will be       *
+ * useful, but WITHOUT ANY WARRANTY; without even the implied    *
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR       *
+ * PURPOSE.  See the GNU General Public License in file COPYING  *
+ * for more details.                                             *
+ *                                                               *
+ * You should have received a copy of the GNU General Public     *
+ * License along with this program; if not, write to the Free    *
+ * Software Foundation, Inc., 59 Temple Place - Suite 330,       *
+ * Boston, MA 02111, USA                                         *
+\* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "liberty.h"
+
+
+/*
+ * This file keeps a table of the strings on the board up to date, so
+ * that the number of liberties, the size and the origin of a string
+ * can be found without flood filling p[][]. See the Texinfo
+ * documentation (Overview/Data Structures) for more information.
+ *
+ * updateboard() calls strings_add_stone() and strings_remove_string()
+ * for every change it makes. While reading (stackp > 0) the old value
+ * of every changed table entry is saved in a change log, and popgo()
+ * undoes the changes through strings_pop(). At stackp == 0 the board
+ * may also be changed directly, e.g. when setting up handicap stones
+ * or loading an sgf file, so there the table is checked against a
+ * copy of the board it was built from and rebuilt if needed.
+ *
+ * The liberties of each string, and the stones of each color, are
+ * kept as Bitboards (see bitboard.c), so that joining the liberties
+ * of several strings is a few word operations. The position itself
+ * is also kept on the padded board board[], whose border spares the
+ * callers the checks of the coordinates.
+ */
+
+struct string_data {
+  int       color;
+  int       size;                     /* number of stones */
+  int       libs;                     /* number of liberties */
+  int       origini;                  /* the topmost, then leftmost stone */
+  int       originj;
+  Bitboard  libset;                   /* the liberties */
+};
+
+/* After a rebuild there are at most MAX_BOARD*MAX_BOARD strings, and
+ * each move creates at most one new string. Strings which are merged
+ * or captured are not reused until the next rebuild.
+ */
+#define MAX_STRINGS (MAX_BOARD*MAX_BOARD + MAXSTACK + 1)
+
+static ENGINE_LOCAL struct string_data  string_table[MAX_STRINGS];
+static ENGINE_LOCAL int                 num_strings = 0;
+
+/* Number of the string at each intersection, -1 if it is empty. */
+static ENGINE_LOCAL int  string_number[MAX_BOARD][MAX_BOARD];
+
+/* The stones of a string are linked in a ring. */
+static ENGINE_LOCAL int  next_stonei[MAX_BOARD][MAX_BOARD];
+static ENGINE_LOCAL int  next_stonej[MAX_BOARD][MAX_BOARD];
+
+/* The stones of each color, indexed by WHITE and BLACK. */
+static ENGINE_LOCAL Bitboard  planes[3];
+
+/* The board the table was last built from or updated to at stackp == 0. */
+static ENGINE_LOCAL board_t  strings_board[MAX_BOARD][MAX_BOARD];
+static ENGINE_LOCAL int      strings_board_size = -1;
+
+
+/* Change log for undoing the table while reading. A move changes a
+ * bounded number of entries, except when it merges strings, where
+ * the stones of the smaller strings are renumbered. Since a string
+ * is always merged into the largest neighbor, each stone is
+ * renumbered at most log2(MAX_BOARD*MAX_BOARD) times during a read.
+ */
+#define CHANGE_LOG_SIZE (100*MAXSTACK + 20*MAX_BOARD*MAX_BOARD)
+
+struct change_entry {
+  int  *address;
+  int  value;
+};
+
+static ENGINE_LOCAL struct change_entry  change_log[CHANGE_LOG_SIZE];
+static ENGINE_LOCAL int                  change_top = 0;
+static ENGINE_LOCAL int                  change_stack[MAXSTACK];
+
+#define PUSH_VALUE(v) \
+  do { \
+    if (stackp > 0) { \
+      assert(change_top < CHANGE_LOG_SIZE); \
+      change_log[change_top].address = (int *) &(v); \
+      change_log[change_top].value = *(int *) &(v); \
+      change_top++; \
+    } \
+  } while (0)
+
+#define SET_VALUE(v, x)  do { PUSH_VALUE(v); (v) = (x); } while (0)
+
+/* The entries of board[] are smaller than an int, so they have a log
+ * of their own. A read places at most MAXSTACK stones and can only
+ * capture these and the stones which were on the board. Every change
+ * is also passed on to the grids of the pattern matcher.
+ */
+#define BOARD_LOG_SIZE (2*MAXSTACK + MAX_BOARD*MAX_BOARD)
+
+struct board_change {
+  int      pos;
+  board_t  value;
+};
+
+static ENGINE_LOCAL struct board_change  board_log[BOARD_LOG_SIZE];
+static ENGINE_LOCAL int                  board_top = 0;
+static ENGINE_LOCAL int                  board_stack[MAXSTACK];
+
+#define SET_BOARD(point, x) \
+  do { \
+    if (stackp > 0) { \
+      assert(board_top < BOARD_LOG_SIZE); \
+      board_log[board_top].pos = (point); \
+      board_log[board_top].value = board[point]; \
+      board_top++; \
+    } \
+    UPDATE_GRIDS(point, board[point] ^ (x)); \
+    board[point] = (x); \
+  } while (0)
+
+#if GRID_OPT > 0
+#define UPDATE_GRIDS(point, stone)  update_merged_board(I(point), J(point), stone)
+#else
+#define UPDATE_GRIDS(point, stone)  ((void) 0)
+#endif
+
+
+static ENGINE_LOCAL int  stonei[MAX_BOARD*MAX_BOARD];
+static ENGINE_LOCAL int  stonej[MAX_BOARD*MAX_BOARD];
+static ENGINE_LOCAL int  stones_stackp;
+
+
+/* Add (i, j) to the liberties of string s unless it is there already. */
+
+static void
+add_liberty(int s, int i, int j)
+{
+  struct string_data *sd = &string_table[s];
+
+  if (BB_TEST(&sd->libset, i, j))
+    return;
+  SET_VALUE(sd->libset.row[i], sd->libset.row[i] | BB_MASK(j));
+  SET_VALUE(sd->libs, sd->libs + 1);
+}
+
+
+/* Remove (i, j) from the liberties of string s if it is there. */
+
+static void
+remove_liberty(int s, int i, int j)
+{
+  struct string_data *sd = &string_table[s];
+
+  if (!BB_TEST(&sd->libset, i, j))
+    return;
+  SET_VALUE(sd->libset.row[i], sd->libset.row[i] & ~BB_MASK(j));
+  SET_VALUE(sd->libs, sd->libs - 1);
+}
+
+
+/* Start a new string consisting of the stone at (i, j). */
+
+static int
+new_string(int i, int j, int color)
+{
+  int s = num_strings;
+  struct string_data *sd = &string_table[s];
+
+  assert(num_strings < MAX_STRINGS);
+  SET_VALUE(num_strings, num_strings + 1);
+
+  /* The entry is beyond num_strings before this move, so it need not
+   * be saved.
+   */
+  sd->color = color;
+  sd->size = 1;
+  sd->libs = 0;
+  sd->origini = i;
+  sd->originj = j;
+  bitboard_clear(&sd->libset);
+
+  SET_VALUE(string_number[i][j], s);
+  SET_VALUE(next_stonei[i][j], i);
+  SET_VALUE(next_stonej[i][j], j);
+
+  return s;
+}
+
+
+/* Link the stone at (i, j) into the ring of (m, n). */
+
+static void
+link_stone(int i, int j, int m, int n)
+{
+  SET_VALUE(next_stonei[i][j], next_stonei[m][n]);
+  SET_VALUE(next_stonej[i][j], next_stonej[m][n]);
+  SET_VALUE(next_stonei[m][n], i);
+  SET_VALUE(next_stonej[m][n], j);
+}
+
+
+/* Make (i, j) the origin of string s if it comes before the old one. */
+
+static void
+update_origin(int s, int i, int j)
+{
+  struct string_data *sd = &string_table[s];
+
+  if (i < sd->origini || (i == sd->origini && j < sd->originj)) {
+    SET_VALUE(sd->origini, i);
+    SET_VALUE(sd->originj, j);
+  }
+}
+
+
+/* Merge string t into string s. */
+
+static void
+merge_strings(int s, int t)
+{
+  struct string_data *sd = &string_table[s];
+  struct string_data *td = &string_table[t];
+  int i = td->origini;
+  int j = td->originj;
+  int si = sd->origini;
+  int sj = sd->originj;
+  int ni, nj;
+  Bitboard added;
+  int libs;
+  int r;
+
+  /* Renumber the stones of t. */
+  do {
+    SET_VALUE(string_number[i][j], s);
+    ni = next_stonei[i][j];
+    nj = next_stonej[i][j];
+    i = ni;
+    j = nj;
+  } while (i != td->origini || j != td->originj);
+
+  /* Join the two rings by swapping the successors of the origins. */
+  ni = next_stonei[si][sj];
+  nj = next_stonej[si][sj];
+  SET_VALUE(next_stonei[si][sj], next_stonei[i][j]);
+  SET_VALUE(next_stonej[si][sj], next_stonej[i][j]);
+  SET_VALUE(next_stonei[i][j], ni);
+  SET_VALUE(next_stonej[i][j], nj);
+
+  SET_VALUE(sd->size, sd->size + td->size);
+  update_origin(s, td->origini, td->originj);
+
+  added = td->libset;
+  bitboard_andnot(&added, &sd->libset);
+  libs = bitboard_count(&added);
+  if (libs > 0) {
+    for (r = 0; r < board_size; r++)
+      if (added.row[r])
+	SET_VALUE(sd->libset.row[r], sd->libset.row[r] | added.row[r]);
+    SET_VALUE(sd->libs, sd->libs + libs);
+  }
+}
+
+
+/* Walk the ring of the string at (m, n). */
+
+static int
+ring_stones(int m, int n, int si[], int sj[])
+{
+  int i = m;
+  int j = n;
+  int ni;
+  int size = 0;
+
+  do {
+    si[size] = i;
+    sj[size] = j;
+    size++;
+    ni = next_stonei[i][j];
+    j = next_stonej[i][j];
+    i = ni;
+  } while (i != m || j != n);
+
+  return size;
+}
+
+
+/* Build the table from scratch. */
+
+static void
+build_strings(void)
+{
+  int i, j;
+  int m, n;
+  int s;
+
+  assert(stackp == 0);
+  num_strings = 0;
+  for (i = 0; i < MAX_BOARD; i++)
+    for (j = 0; j < MAX_BOARD; j++)
+      string_number[i][j] = -1;
+
+  bitboard_clear(&planes[WHITE]);
+  bitboard_clear(&planes[BLACK]);
+  memset(board, GRAY_BORDER, sizeof(board));
+  for (i = 0; i < board_size; i++)
+    for (j = 0; j < board_size; j++) {
+      board[POS(i, j)] = p[i][j];
+      if (p[i][j] != EMPTY)
+	BB_SET(&planes[p[i][j]], i, j);
+    }
+#if GRID_OPT > 0
+  build_merged_board();
+#endif
+
+  for (i = 0; i < board_size; i++)
+    for (j = 0; j < board_size; j++) {
+      if (p[i][j] == EMPTY || string_number[i][j] != -1)
+	continue;
+
+      /* Scanning in this order, the first stone found is the origin. */
+      s = new_string(i, j, p[i][j]);
+      stonei[0] = i;
+      stonej[0] = j;
+      stones_stackp = 1;
+      while (stones_stackp > 0) {
+	stones_stackp--;
+	m = stonei[stones_stackp];
+	n = stonej[stones_stackp];
+
+#define VISIT(a, b) \
+	do { \
+	  if (p[a][b] == EMPTY) \
+	    add_liberty(s, a, b); \
+	  else if (p[a][b] == p[i][j] && string_number[a][b] == -1) { \
+	    string_number[a][b] = s; \
+	    string_table[s].size++; \
+	    link_stone(a, b, i, j); \
+	    stonei[stones_stackp] = a; \
+	    stonej[stones_stackp] = b; \
+	    stones_stackp++; \
+	  } \
+	} while (0)
+
+	if (m > 0)
+	  VISIT(m-1, n);
+	if (m < board_size-1)
+	  VISIT(m+1, n);
+	if (n > 0)
+	  VISIT(m, n-1);
+	if (n < board_size-1)
+	  VISIT(m, n+1);
+#undef VISIT
+      }
+    }
+
+  memcpy(strings_board, p, sizeof(strings_board));
+  strings_board_size = board_size;
+}
+
+
+/*
+ * Make sure the table matches the board. Only needed at stackp == 0;
+ * while reading the table is kept up to date by updateboard().
+ */
+
+void
+strings_sync(void)
+{
+  if (stackp > 0)
+    return;
+  if (strings_board_size != board_size
+      || num_strings > MAX_BOARD*MAX_BOARD
+      || memcmp(strings_board, p, sizeof(strings_board)) != 0)
+    build_strings();
+}
+
+
+/* Remember the state of the table before pushing the board. */
+
+void
+strings_push(void)
+{
+  if (stackp == 0)
+    strings_sync();
+  change_stack[stackp] = change_top;
+  board_stack[stackp] = board_top;
+}
+
+
+/* Undo the changes since the matching strings_push(). Called after
+ * stackp has been decremented.
+ */
+
+void
+strings_pop(void)
+{
+  while (change_top > change_stack[stackp]) {
+    change_top--;
+    *(change_log[change_top].address) = change_log[change_top].value;
+  }
+  while (board_top > board_stack[stackp]) {
+    int pos = board_log[--board_top].pos;
+
+    UPDATE_GRIDS(pos, board[pos] ^ board_log[board_top].value);
+    board[pos] = board_log[board_top].value;
+  }
+}
+
+
+/*
+ * Update the table after a stone of color has been placed at (i, j).
+ * Captures are handled separately by strings_remove_string().
+ */
+
+void
+strings_add_stone(int i, int j, int color)
+{
+  int ni[4], nj[4];
+  int neighbors = 0;
+  int s = -1;
+  int k;
+
+  if (i > 0) {
+    ni[neighbors] = i-1;
+    nj[neighbors++] = j;
+  }
+  if (i < board_size-1) {
+    ni[neighbors] = i+1;
+    nj[neighbors++] = j;
+  }
+  if (j > 0) {
+    ni[neighbors] = i;
+    nj[neighbors++] = j-1;
+  }
+  if (j < board_size-1) {
+    ni[neighbors] = i;
+    nj[neighbors++] = j+1;
+  }
+
+  /* (i, j) is no longer a liberty of the neighboring strings. Find
+   * the largest friendly one for the stone to join.
+   */
+  for (k = 0; k < neighbors; k++) {
+    int t = string_number[ni[k]][nj[k]];
+    if (t == -1)
+      continue;
+    remove_liberty(t, i, j);
+    if (string_table[t].color == color
+	&& (s == -1 || string_table[t].size > string_table[s].size))
+      s = t;
+  }
+
+  if (s == -1)
+    s = new_string(i, j, color);
+  else {
+    SET_VALUE(string_number[i][j], s);
+    link_stone(i, j, string_table[s].origini, string_table[s].originj);
+    SET_VALUE(string_table[s].size, string_table[s].size + 1);
+    update_origin(s, i, j);
+  }
+
+  for (k = 0; k < neighbors; k++) {
+    int t = string_number[ni[k]][nj[k]];
+    if (t == -1)
+      add_liberty(s, ni[k], nj[k]);
+    else if (t != s && string_table[t].color == color)
+      merge_strings(s, t);
+  }
+
+  SET_VALUE(planes[color].row[i], planes[color].row[i] | BB_MASK(j));
+  SET_BOARD(POS(i, j), color);
+  if (stackp == 0)
+    strings_board[i][j] = color;
+}
+
+
+/* Update the table when the string at (m, n) is removed from the board. */
+
+void
+strings_remove_string(int m, int n)
+{
+  int s = string_number[m][n];
+  Bitboard *plane;
+  int size;
+  int i, j;
+  int k;
+
+  assert(s != -1);
+  size = ring_stones(m, n, stonei, stonej);
+  plane = &planes[string_table[s].color];
+
+  for (k = 0; k < size; k++) {
+    i = stonei[k];
+    j = stonej[k];
+    SET_VALUE(string_number[i][j], -1);
+    SET_VALUE(plane->row[i], plane->row[i] & ~BB_MASK(j));
+    SET_BOARD(POS(i, j), EMPTY);
+  }
+
+  /* The stones become liberties of their neighbors. */
+  for (k = 0; k < size; k++) {
+    i = stonei[k];
+    j = stonej[k];
+    if (i > 0 && string_number[i-1][j] != -1)
+      add_liberty(string_number[i-1][j], i, j);
+    if (i < board_size-1 && string_number[i+1][j] != -1)
+      add_liberty(string_number[i+1][j], i, j);
+    if (j > 0 && string_number[i][j-1] != -1)
+      add_liberty(string_number[i][j-1], i, j);
+    if (j < board_size-1 && string_number[i][j+1] != -1)
+      add_liberty(string_number[i][j+1], i, j);
+    if (stackp == 0)
+      strings_board[i][j] = EMPTY;
+  }
+}
+
+
+/*
+ * Return the stones of the string at (m, n) in stonei[] and stonej[].
+ * Returns the size of the string.
+ */
+
+int
+findstones(int m, int n, int si[], int sj[])
+{
+  if (stackp == 0)
+    strings_sync();
+  assert(p[m][n] != EMPTY);
+  return ring_stones(m, n, si, sj);
+}
+
+
+/* Set libs to the liberties a stone of color at the empty (i, j)
+ * would have.
+ */
+
+static void
+join_liberties(int i, int j, int color, Bitboard *libs)
+{
+  int pos = POS(i, j);
+
+  bitboard_clear(libs);
+
+#define JOIN(d, a, b) \
+  do { \
+    if (board[pos + (d)] == EMPTY) \
+      BB_SET(libs, a, b); \
+    else if (board[pos + (d)] == color) \
+      bitboard_or(libs, &string_table[string_number[a][b]].libset); \
+  } while (0)
+
+  JOIN(-NS, i-1, j);
+  JOIN(NS, i+1, j);
+  JOIN(-WE, i, j-1);
+  JOIN(WE, i, j+1);
+#undef JOIN
+
+  BB_CLEAR(libs, i, j);
+}
+
+
+/*
+ * Return the liberties of the string at (i, j), or if (i, j) is
+ * empty the liberties a stone of color would get there, counted up
+ * to maxlib. This returns the same as approxlib(), but it does not
+ * set lib, size, libi[] and libj[]. For a string it takes constant
+ * time.
+ */
+
+int
+fastlib(int i, int j, int color, int maxlib)
+{
+  Bitboard libset;
+  int libs = 0;
+
+  ASSERT(i>=0 && i < board_size && j >= 0 && j < board_size, i, j);
+  ASSERT(p[i][j] != OTHER_COLOR(color), i, j);
+
+  if (stackp == 0)
+    strings_sync();
+
+  if (p[i][j] == color)
+    libs = string_table[string_number[i][j]].libs;
+  else {
+    int pos = POS(i, j);
+
+    /* Count the empty neighbors first, which often is enough. */
+    libs = (board[pos-NS] == EMPTY) + (board[pos+NS] == EMPTY)
+	   + (board[pos-WE] == EMPTY) + (board[pos+WE] == EMPTY);
+    if (maxlib > 0 && libs >= maxlib)
+      return maxlib;
+
+    join_liberties(i, j, color, &libset);
+    libs = bitboard_count(&libset);
+  }
+
+  /* Like count(), a limit of zero or less means no limit. */
+  if (maxlib > 0 && libs > maxlib)
+    return maxlib;
+  return libs;
+}
+
+
+/*
+ * Return the number of liberties of the string at (i, j), or of a
+ * stone of color placed there if it is empty, like countlib(). Up to
+ * maxlib of them are stored in libi[] and libj[], row by row.
+ *
+ * Unlike approxlib() this does not flood fill the string, but the
+ * liberties come in a different order. Use it where the order does
+ * not matter, typically to find the last liberty of a string.
+ */
+
+int
+findlib(int i, int j, int color, int maxlib, int libi[], int libj[])
+{
+  Bitboard libset;
+
+  ASSERT(i>=0 && i < board_size && j >= 0 && j < board_size, i, j);
+  ASSERT(p[i][j] != OTHER_COLOR(color), i, j);
+
+  if (stackp == 0)
+    strings_sync();
+
+  if (p[i][j] == color) {
+    struct string_data *sd = &string_table[string_number[i][j]];
+    bitboard_points(&sd->libset, maxlib, libi, libj);
+    return sd->libs;
+  }
+
+  join_liberties(i, j, color, &libset);
+  bitboard_points(&libset, maxlib, libi, libj);
+  return bitboard_count(&libset);
+}
+
+
+/* Set b to the stones of color, or to the empty points of the board
+ * if color is EMPTY.
+ */
+
+void
+color_plane(int color, Bitboard *b)
+{
+  if (stackp == 0)
+    strings_sync();
+
+  if (color == EMPTY) {
+    bitboard_fill(b);
+    bitboard_andnot(b, &planes[WHITE]);
+    bitboard_andnot(b, &planes[BLACK]);
+  }
+  else
+    *b = planes[color];
+}
+
+
+/* Return the number of liberties of the string at (i, j), or of a
+ * stone of color placed there if it is empty.
+ */
+
+int
+countlib(int i, int j, int color)
+{
+  return fastlib(i, j, color, MAXLIBS);
+}
+
+
+/* Return the number of stones in the string at (i, j). */
+
+int
+countstones(int i, int j)
+{
+  if (stackp == 0)
+    strings_sync();
+  assert(p[i][j] != EMPTY);
+  return string_table[string_number[i][j]].size;
+}
+
+
+/* Find the origin of the string at (i, j), see find_origin(). */
+
+void
+string_origin(int i, int j, int *origini, int *originj)
+{
+  int s;
+
+  if (stackp == 0)
+    strings_sync();
+  s = string_number[i][j];
+  assert(s != -1);
+  *origini = string_table[s].origini;
+  *originj = string_table[s].originj;
+}
+
+
+/*
+ * Local Variables:
+ * tab-width: 8
+ * c-basic-offset: 2
+ * End:
+ */
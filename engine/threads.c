@@ -0,0 +1,310 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *\
+ * This is GNU GO, a Go program. Contact gnugo@gnu.org, or see   *
+ * http://www.gnu.org/software/gnugo/ for more information.      *
+ *                                                               *
+ * Copyright 1999 and 2000 by the Free Software Foundation.      *
+ *                                                               *
+ * This program is free software; you can redistribute it and/or *
+ * modify it under the terms of the GNU General Public License   *
+ * as published by the Free Software Foundation - version 2.     *
+ *                                                               *
+ * This program is distributed in the hope that it will be       *
+ * useful, but WITHOUT ANY WARRANTY; without even the implied    *
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR       *
+ * PURPOSE.  See the GNU General Public License in file COPYING  *
+ * for more details.                                             *
+ *                                                               *
+ * You should have received a copy of the GNU General Public     *
+ * License along with this program; if not, write to the Free    *
+ * Software Foundation, Inc., 59 Temple Place - Suite 330,       *
+ * Boston, MA 02111, USA                                         *
+\* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/*
+ * Reading threads.
+ *
+ * make_worms() reads the attack and defense of every string on the
+ * board, and attacker() and defender() read the safety of every
+ * candidate move. These readings are independent of each other, so
+ * with --threads N they are shared between the thread calling
+ * genmove() and N-1 reading threads.
+ *
+ * Each reading thread has an engine of its own (see context.c), so
+ * this needs ENGINE_THREADS. Before a batch of readings the threads
+ * copy the position, the reading depths, the hash flags, their share
+ * of the reading budget (see reading.c) and the worm data from the
+ * calling thread, and each has a hash table of its own.
+ *
+ * The readings are not handed out to whichever thread is free.
+ * Reading k goes to thread k modulo N, and each thread does its
+ * readings in order. So every thread sees the same readings, and
+ * builds the same hash table, whatever the scheduling, and the
+ * results, which the caller collects in board order, are the same
+ * from one run to the next. They may differ from those of one
+ * thread, since there a reading can find the results of the readings
+ * before it in the hash table.
+ *
+ * Readings are done by the calling thread alone while tracing or
+ * writing variations to an sgf file, so that the output stays in
+ * order.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "liberty.h"
+
+#if ENGINE_THREADS
+#include <pthread.h>
+
+
+/* The batch of readings being done, and the position to do it on. */
+
+static struct {
+  int            njobs;
+  reading_job    job;
+  void          *data;
+  board_t        p[MAX_BOARD][MAX_BOARD];
+  int            ko_i;
+  int            ko_j;
+  int            board_size;
+  int            movenum;
+  int            depth;
+  int            backfill_depth;
+  int            fourlib_depth;
+  int            ko_depth;
+  int            hashflags;
+  int            read_nodes;
+  double         read_deadline;
+  struct worm_data (*worm)[MAX_BOARD];
+} batch;
+
+static int num_threads = 1;        /* including the calling thread */
+static int hash_memory;            /* megabytes for each hash table */
+static int batch_number = 0;       /* counts the batches started */
+static int pending = 0;            /* reading threads still busy */
+static struct stats_data batch_stats;
+
+static pthread_mutex_t batch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  batch_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  batch_done = PTHREAD_COND_INITIALIZER;
+
+
+/* Add the reading statistics of one thread to those of another. */
+
+static void
+add_stats(struct stats_data *sum, const struct stats_data *s)
+{
+  int k;
+
+  sum->nodes += s->nodes;
+  sum->position_entered += s->position_entered;
+  sum->read_result_entered += s->read_result_entered;
+  sum->position_hits += s->position_hits;
+  sum->read_result_hits += s->read_result_hits;
+  sum->read_result_lookups += s->read_result_lookups;
+  sum->read_result_replaced += s->read_result_replaced;
+  sum->read_result_shallow += s->read_result_shallow;
+  sum->deepening_calls += s->deepening_calls;
+  sum->deepening_iterations += s->deepening_iterations;
+  sum->budget_cutoffs += s->budget_cutoffs;
+  for (k = 0; k < NUM_MATCH_STAGES; k++)
+    sum->matcher[k] += s->matcher[k];
+  for (k = 0; k < STATS_DEPTHS; k++) {
+    sum->safe_move_lookups[k] += s->safe_move_lookups[k];
+    sum->safe_move_hits[k] += s->safe_move_hits[k];
+  }
+  for (k = 0; k < NUM_READ_ROUTINES; k++) {
+    sum->read_lookups[k] += s->read_lookups[k];
+    sum->read_hits[k] += s->read_hits[k];
+  }
+}
+
+
+/*
+ * Set up the engine of a reading thread for the current batch. The
+ * caches are only kept while the position stays the same.
+ */
+
+static void
+load_batch(void)
+{
+  if (board_size != batch.board_size
+      || movenum != batch.movenum
+      || ko_i != batch.ko_i
+      || ko_j != batch.ko_j
+      || memcmp(p, batch.p, sizeof(p)) != 0) {
+    memcpy(p, batch.p, sizeof(p));
+    ko_i = batch.ko_i;
+    ko_j = batch.ko_j;
+    board_size = batch.board_size;
+    movenum = batch.movenum;
+    clear_safe_move_cache();
+#if HASHING
+    hashtable_age(movehash);
+    hashdata_init(&hashdata);
+#endif
+  }
+
+  depth = batch.depth;
+  backfill_depth = batch.backfill_depth;
+  fourlib_depth = batch.fourlib_depth;
+  ko_depth = batch.ko_depth;
+  hashflags = batch.hashflags;
+  memcpy(worm, batch.worm, sizeof(worm));
+}
+
+
+static void *
+reading_thread(void *arg)
+{
+  int n = (int) (long) arg;
+  int seen = 0;
+  int k;
+
+#if HASHING
+  movehash = hashtable_allocate(hash_memory);
+  if (movehash == NULL) {
+    fprintf(stderr, "Out of memory for the hash table of a reading thread\n");
+    exit(EXIT_FAILURE);
+  }
+#endif
+  board_size = 0;
+
+  for (;;) {
+    pthread_mutex_lock(&batch_lock);
+    while (batch_number == seen)
+      pthread_cond_wait(&batch_start, &batch_lock);
+    seen = batch_number;
+    pthread_mutex_unlock(&batch_lock);
+
+    load_batch();
+    memset(&stats, 0, sizeof(stats));
+    set_read_budget(batch.read_nodes, batch.read_deadline);
+    for (k = n; k < batch.njobs; k += num_threads)
+      batch.job(k, batch.data);
+
+    pthread_mutex_lock(&batch_lock);
+    add_stats(&batch_stats, &stats);
+    if (--pending == 0)
+      pthread_cond_signal(&batch_done);
+    pthread_mutex_unlock(&batch_lock);
+  }
+
+  return NULL;
+}
+
+
+/*
+ * Start threads-1 reading threads, each with a hash table of memory
+ * megabytes. Call this once, before the first genmove().
+ *
+ * Return 0 if the threads cannot be started.
+ */
+
+int
+start_reading_threads(int threads, int memory)
+{
+  pthread_t thread;
+  int n;
+
+  hash_memory = memory;
+  for (n = 1; n < threads; n++) {
+    if (pthread_create(&thread, NULL, reading_thread, (void *) (long) n) != 0)
+      break;
+    pthread_detach(thread);
+  }
+  num_threads = n;
+
+  return (n == threads);
+}
+
+
+/*
+ * Do the readings job(0, data) ... job(njobs-1, data), shared between
+ * the calling thread and the reading threads, and return 1 when all
+ * are done. A job may only write to its own part of data.
+ *
+ * Return 0 without doing anything if the readings should be done by
+ * the caller, in order.
+ */
+
+int
+parallel_reading(int njobs, reading_job job, void *data)
+{
+  int k;
+
+  if (num_threads == 1 || njobs < 2 || stackp > 0
+      || verbose || sgf_dump || count_variations)
+    return 0;
+
+  pthread_mutex_lock(&batch_lock);
+  batch.njobs = njobs;
+  batch.job = job;
+  batch.data = data;
+  memcpy(batch.p, p, sizeof(p));
+  batch.ko_i = ko_i;
+  batch.ko_j = ko_j;
+  batch.board_size = board_size;
+  batch.movenum = movenum;
+  batch.depth = depth;
+  batch.backfill_depth = backfill_depth;
+  batch.fourlib_depth = fourlib_depth;
+  batch.ko_depth = ko_depth;
+  batch.hashflags = hashflags;
+  get_read_budget(&batch.read_nodes, &batch.read_deadline);
+  if (batch.read_nodes != INT_MAX)
+    batch.read_nodes /= num_threads;
+  batch.worm = worm;
+  memset(&batch_stats, 0, sizeof(batch_stats));
+  pending = num_threads - 1;
+  batch_number++;
+  pthread_cond_broadcast(&batch_start);
+  pthread_mutex_unlock(&batch_lock);
+
+  for (k = 0; k < njobs; k += num_threads)
+    job(k, data);
+
+  pthread_mutex_lock(&batch_lock);
+  while (pending > 0)
+    pthread_cond_wait(&batch_done, &batch_lock);
+  add_stats(&stats, &batch_stats);
+  pthread_mutex_unlock(&batch_lock);
+
+  return 1;
+}
+
+
+#else /* !ENGINE_THREADS */
+
+
+/* Without ENGINE_THREADS the engine has no state to give a thread,
+ * so all readings are done by the caller.
+ */
+
+int
+start_reading_threads(int threads, int memory)
+{
+  return (threads <= 1);
+}
+
+
+int
+parallel_reading(int njobs, reading_job job, void *data)
+{
+  return 0;
+}
+
+
+#endif /* ENGINE_THREADS */
+
+
+/*
+ * Local Variables:
+ * tab-width: 8
+ * c-basic-offset: 2
+ * End:
+ */
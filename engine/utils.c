@@ -29,29 +29,64 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <assert.h>
+#include <time.h>
 #include "liberty.h"
 #include "ttsgf.h"
 #include "ttsgf_write.h"
 #include "interface.h"
 
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+
+#if UNDO_LOG
+
+/* Undo log for storing positions while reading. Instead of copying
+ * the whole board at each push, updateboard() records every
+ * intersection it changes while stackp > 0, and popgo() puts them
+ * back in reverse order. During a read at most MAXSTACK stones are
+ * placed, and each captured stone was either on the board before the
+ * read or placed during it, which bounds the size of the log.
+ */
+#define UNDO_LOG_SIZE (MAX_BOARD*MAX_BOARD + 2*MAXSTACK)
+
+struct undo_entry {
+  unsigned char  i;
+  unsigned char  j;
+  board_t        old;	/* value of p[i][j] before the change */
+};
+
+static ENGINE_LOCAL struct undo_entry  undo_log[UNDO_LOG_SIZE];
+static ENGINE_LOCAL int                undo_top = 0;
+
+/* Start of the undo log and hash value at each stack level. */
+static ENGINE_LOCAL int            undo_stack[MAXSTACK];
+static ENGINE_LOCAL Hashvalue      hashval_stack[MAXSTACK];
+static ENGINE_LOCAL int            hash_ko_stacki[MAXSTACK];
+static ENGINE_LOCAL int            hash_ko_stackj[MAXSTACK];
+
+#else
+
 /* Stack of boards for storing positions while reading. */
-static board_t  stack[MAXSTACK][MAX_BOARD][MAX_BOARD]; 
+static ENGINE_LOCAL board_t  stack[MAXSTACK][MAX_BOARD][MAX_BOARD]; 
+
+static ENGINE_LOCAL Hash_data  hashdata_stack[MAXSTACK];
+
+#endif
 
 /* Stack of trial moves to get to current position 
  * position and which color made them. Perhaps 
  * this should be one array of a structure 
  */
-static int      stacki[MAXSTACK];
-static int      stackj[MAXSTACK];      
-static int      move_color[MAXSTACK];  
-static int      ko_stacki[MAXSTACK];
-static int      ko_stackj[MAXSTACK];      
-
-static Hash_data  hashdata_stack[MAXSTACK];
+static ENGINE_LOCAL int      stacki[MAXSTACK];
+static ENGINE_LOCAL int      stackj[MAXSTACK];      
+static ENGINE_LOCAL int      move_color[MAXSTACK];  
+static ENGINE_LOCAL int      ko_stacki[MAXSTACK];
+static ENGINE_LOCAL int      ko_stackj[MAXSTACK];      
 
 /* Stack of black and white captured stones */
-static int      stackbc[MAXSTACK];     
-static int      stackwc[MAXSTACK];
+static ENGINE_LOCAL int      stackbc[MAXSTACK];     
+static ENGINE_LOCAL int      stackwc[MAXSTACK];
 
 
 /* pushgo pushes the position onto the stack. */
@@ -61,10 +96,18 @@ pushgo()
 {
   if (showstack)
     gprintf("        *** STACK before push: %d\n", stackp); 
+#if UNDO_LOG
+  undo_stack[stackp] = undo_top;
+  hashval_stack[stackp] = hashdata.hashval;
+  hash_ko_stacki[stackp] = hashdata.hashpos.ko_i;
+  hash_ko_stackj[stackp] = hashdata.hashpos.ko_j;
+#else
   memcpy(stack[stackp], p, sizeof(p));
+  memcpy(&hashdata_stack[stackp], &hashdata, sizeof(hashdata));
+#endif
   ko_stacki[stackp] = ko_i;
   ko_stackj[stackp] = ko_j;
-  memcpy(&hashdata_stack[stackp], &hashdata, sizeof(hashdata));
+  strings_push();
 
   stackbc[stackp]=black_captured;
   stackwc[stackp]=white_captured;
@@ -72,23 +115,54 @@ pushgo()
   return(stackp);
 }
 
-/* popgo pops the position from the stack. */
+/* undo_move restores the position from the stack. It does the work
+ * of popgo() except closing the variation in the sgf file.
+ */
 
-int 
-popgo()
+static void
+undo_move(void)
 {
   stackp--;
   if (showstack)
     gprintf("<=    *** STACK  after pop: %d\n", stackp);
-   
+
+#if UNDO_LOG
+  while (undo_top > undo_stack[stackp]) {
+    struct undo_entry *u = &undo_log[--undo_top];
+
+    /* Every logged change either puts a stone on an empty
+     * intersection or removes one, so inverting the stone that
+     * was there before or after the change restores the hash.
+     */
+    if (u->old == EMPTY)
+      hashdata_invert_stone(&hashdata, u->i, u->j, p[u->i][u->j]);
+    else
+      hashdata_invert_stone(&hashdata, u->i, u->j, u->old);
+    p[u->i][u->j] = u->old;
+  }
+  hashdata.hashval = hashval_stack[stackp];
+  hashdata.hashpos.ko_i = hash_ko_stacki[stackp];
+  hashdata.hashpos.ko_j = hash_ko_stackj[stackp];
+#else
   memcpy(p, stack[stackp], sizeof(p) );
+  memcpy(&hashdata, &(hashdata_stack[stackp]), sizeof(hashdata) );
+#endif
+
   ko_i = ko_stacki[stackp];
   ko_j = ko_stackj[stackp];
-
-  memcpy(&hashdata, &(hashdata_stack[stackp]), sizeof(hashdata) );
+  strings_pop();
 
   black_captured=stackbc[stackp];
   white_captured=stackwc[stackp];
+}
+
+
+/* popgo pops the position from the stack. */
+
+int 
+popgo()
+{
+  undo_move();
   if (count_variations) 
     sgf_write_line(")\n");
   return (stackp);
@@ -165,22 +239,12 @@ trymove(int i, int j, int color, const char *message, int k, int l)
      * make sure we do actually have some liberties !
      */
 
-    if (approxlib(i,j,color,1) == 0) {
+    if (fastlib(i, j, color, 1) == 0) {
       RTRACE("%m would be suicide\n", i, j);
 
       /* Almost do the work of popgo().  The only difference is that
 	 we don't close the variations in the sgf file. */
-      stackp--;
-      if (showstack)
-	gprintf("<=    *** STACK  after pop: %d\n", stackp);
-   
-      memcpy(p, stack[stackp], sizeof(p) );
-      ko_i = ko_stacki[stackp];
-      ko_j = ko_stackj[stackp];
-      memcpy(&hashdata, &(hashdata_stack[stackp]), sizeof(hashdata) );
-      black_captured = stackbc[stackp];
-      white_captured = stackwc[stackp];
-
+      undo_move();
       return 0;
     }
   }
@@ -294,8 +358,8 @@ dump_stack(void)
  * position without using the stack. They are used in counting
  * under the ascii interface by endgame().
  */
-static board_t p_backup[MAX_BOARD][MAX_BOARD];
-static int black_captured_backup, white_captured_backup;
+static ENGINE_LOCAL board_t p_backup[MAX_BOARD][MAX_BOARD];
+static ENGINE_LOCAL int black_captured_backup, white_captured_backup;
 
 void
 save_state()
@@ -468,49 +532,48 @@ DEBUG(int level, const char *fmt, ...)
  * the board. Return the number of stones captured.
  */
 
-static char check_mx[MAX_BOARD][MAX_BOARD];
-static char check_mark = -1;
+static ENGINE_LOCAL int capturei[MAX_BOARD*MAX_BOARD];
+static ENGINE_LOCAL int capturej[MAX_BOARD*MAX_BOARD];
 
-static void
-init_check_for_capture(void)
-{
-  /* set all pieces as unmarked */
-  memset(check_mx, 0, sizeof(check_mx));
-  check_mark = 1;
-}
+/* Change an intersection of the board, logging the old value if we
+ * are reading so that popgo() can undo it.
+ */
+#if UNDO_LOG
+#define UNDO_LOG_SET(m, n, c) \
+  do { \
+    if (stackp > 0) { \
+      assert(undo_top < UNDO_LOG_SIZE); \
+      undo_log[undo_top].i = (m); \
+      undo_log[undo_top].j = (n); \
+      undo_log[undo_top].old = p[m][n]; \
+      undo_top++; \
+    } \
+    p[m][n] = (c); \
+  } while (0)
+#else
+#define UNDO_LOG_SET(m, n, c)  (p[m][n] = (c))
+#endif
 
 static int 
 check_for_capture(int m, int n, int color)
 {
-  int i,j;
-  int captured=0; /* number captured */
+  int k;
+  int captured; /* number captured */
 
   ASSERT(p[m][n] == color, m,n);
 
   DEBUG(DEBUG_COUNT,"Checking %m for capture\n", m,n);
 
-  check_mark++;
-  if (check_mark == 0) { /* We have wrapped around, reinitialize. */
-    init_check_for_capture();
-  }
-
-  if (count(m, n, color, check_mx, 1, check_mark) > 0) {
+  if (fastlib(m, n, color, 1) > 0)
     return 0;
-  }
 
-  /* remove all the stones with mx[i][j] == 0,
-   *  (since these are the ones count() touched)
-   * - count also marks EMPTY stones, but there's
-   * no harm in resetting them to EMPTY
-   */
+  captured = findstones(m, n, capturei, capturej);
+  strings_remove_string(m, n);
 
-  for (i=0; i<board_size; ++i)
-    for (j=0; j<board_size; ++j)
-      if (check_mx[i][j] == check_mark) {
-	p[i][j] = EMPTY;
-	hashdata_invert_stone(&hashdata, i, j, color);
-	++captured;
-      }
+  for (k=0; k<captured; ++k) {
+    UNDO_LOG_SET(capturei[k], capturej[k], EMPTY);
+    hashdata_invert_stone(&hashdata, capturei[k], capturej[k], color);
+  }
   
   if (color == WHITE)
     white_captured += captured;
@@ -560,23 +623,13 @@ legal(int i, int j, int color)
   updateboard(i, j, color);
 
   /* only care about 0 or >=1 */
-  if (approxlib(i, j, color, 1)==0) {
+  if (fastlib(i, j, color, 1)==0) {
     RTRACE("%m would be suicide\n", i, j);
     legit = 0;
   } else
     legit = 1;
 
-  stackp--;
-  if (showstack)
-    gprintf("<=    *** STACK  after pop: %d\n", stackp);
-   
-  memcpy(p, stack[stackp], sizeof(p) );
-  ko_i = ko_stacki[stackp];
-  ko_j = ko_stackj[stackp];
-  memcpy(&hashdata, &(hashdata_stack[stackp]), sizeof(hashdata) );
-  black_captured=stackbc[stackp];
-  white_captured=stackwc[stackp];
-
+  undo_move();
   return legit;
 }
 
@@ -639,7 +692,7 @@ gnugo@gnu.org\n\n",VERSION);
  * (ie return of >0 is sufficient, though not necessary, test
  * for move not being a suicide.)
  *
- *  Globals affected : uses count(), so anything it affects
+ *  Also keeps the string table (strings.c) up to date.
  */
 
 int 
@@ -649,11 +702,12 @@ updateboard(int i, int j, int color)
   int obvious_liberties=0;
   int captures = 0;
   int tot_captures = 0;
+  int pos;
 
 #if CHECK_HASHING
   {
     Hashposition pos;
-    unsigned long hash;
+    Hashvalue hash;
 
     /* Check the hash table to see if we have had this position before. */
     board_to_position(p, ko_i, ko_j, /*color,*/ &pos);
@@ -677,95 +731,66 @@ updateboard(int i, int j, int color)
   assert(i>=0 && i<board_size && j>=0 && j<board_size);
   ASSERT( p[i][j] == EMPTY, i, j);
 
-  if (stackp==0) 
+  if (stackp==0) {
     color_has_played|=color;
+    strings_sync();
+  }
 
-  p[i][j] = color;
+  UNDO_LOG_SET(i, j, color);
   hashdata_invert_stone(&hashdata, i, j, color);
+  strings_add_stone(i, j, color);
 
   DEBUG(DEBUG_BOARD, "Update board : %m = %d\n", i,j, color);
 
+  /* The border of board[] is neither color nor EMPTY, so the
+   * neighbors need no bounds checks.
+   */
+  pos = POS(i, j);
+
   /* Check to the top. */
-  if (i>0) {
-    if (p[i-1][j] == other) {
-      tot_captures = check_for_capture(i-1, j, other);
-      obvious_liberties = tot_captures;
-    } else if (p[i-1][j] == EMPTY)
-      ++obvious_liberties;
-  }
+  if (board[pos-NS] == other) {
+    tot_captures = check_for_capture(i-1, j, other);
+    obvious_liberties = tot_captures;
+  } else if (board[pos-NS] == EMPTY)
+    ++obvious_liberties;
 
   /* Check to the bottom. */
-  if (i<board_size-1) {
-    if (p[i+1][j]==other) {
-      captures = check_for_capture(i+1, j, other);
-      tot_captures += captures;
-      obvious_liberties += captures;
-    } else if (p[i+1][j] == EMPTY)
-      ++obvious_liberties;
-  }
+  if (board[pos+NS] == other) {
+    captures = check_for_capture(i+1, j, other);
+    tot_captures += captures;
+    obvious_liberties += captures;
+  } else if (board[pos+NS] == EMPTY)
+    ++obvious_liberties;
 
   /* Check to the left. */
-  if (j>0) {
-    if (p[i][j-1]==other) {
-      captures = check_for_capture(i, j-1, other);
-      obvious_liberties += captures;
-      tot_captures += captures;
-    } else if (p[i][j-1]==EMPTY)
-      ++obvious_liberties;
-  }
+  if (board[pos-WE] == other) {
+    captures = check_for_capture(i, j-1, other);
+    obvious_liberties += captures;
+    tot_captures += captures;
+  } else if (board[pos-WE] == EMPTY)
+    ++obvious_liberties;
 
   /* Check to the right. */
-  if (j<board_size-1) {
-    if (p[i][j+1]==other) {
-      captures = check_for_capture(i, j+1, other);
-      obvious_liberties += captures;
-      tot_captures += captures;
-    } else if (p[i][j+1]==EMPTY)
-      ++obvious_liberties;
-  }
+  if (board[pos+WE] == other) {
+    captures = check_for_capture(i, j+1, other);
+    obvious_liberties += captures;
+    tot_captures += captures;
+  } else if (board[pos+WE] == EMPTY)
+    ++obvious_liberties;
 
   /* Check for possible ko and store it into the ko variables. */
   if (tot_captures == 1) {
     int  friends = 0;
     int  libs = 0;
-    int  libertyi = -1;
-    int  libertyj = -1;
+    int  liberty = 0;
+    int  k;
 
-    if (i > 0) {
-      if (p[i-1][j] == color) 
-	friends++;
-      if (p[i-1][j] == EMPTY) {
-	libs++;
-	libertyi = i - 1;
-	libertyj = j;
-      }
-    }
-    if (i < board_size - 1) {
-      if (p[i+1][j] == color) 
-	friends++;
-      if (p[i+1][j] == EMPTY) {
-	libs++;
-	libertyi = i + 1;
-	libertyj = j;
-      }
-    }
-    if (j > 0) {
-      if (p[i][j-1] == color) 
+    for (k = 0; k < 4; k++) {
+      if (board[pos + delta[k]] == color) 
 	friends++;
-      if (p[i][j-1] == EMPTY) {
+      if (board[pos + delta[k]] == EMPTY) {
 	libs++;
-	libertyi = i;
-	libertyj = j - 1;
-      }
-    }
-    if (j < board_size - 1) {
-      if (p[i][j+1] == color) 
-	friends++;
-      if (p[i][j+1] == EMPTY) {
-	libs++;
-	libertyi = i;
-	libertyj = j + 1;
-
+	liberty = pos + delta[k];
       }
     }
 
@@ -775,16 +800,16 @@ updateboard(int i, int j, int color)
      * a snapback, and not a ko, which is ok.  
      */
     if (libs == 1 && friends == 0) {
-      ko_i = libertyi;
-      ko_j = libertyj;
-      hashdata_set_ko(&hashdata, libertyi, libertyj);
+      ko_i = I(liberty);
+      ko_j = J(liberty);
+      hashdata_set_ko(&hashdata, ko_i, ko_j);
     }
   }
 
 #if CHECK_HASHING
   {
     Hashposition pos;
-    unsigned long hash;
+    Hashvalue hash;
 
     /* Check the hash table to see if we have had this position before. */
     board_to_position(p, ko_i, ko_j, /*color,*/ &pos);
@@ -813,6 +838,63 @@ init_board()
    init_moyo();
 }
 
+/*
+ * These exercise the board code on the current position, to measure
+ * its speed with --boardbench. exercise_trymove() tries and takes
+ * back a move of each color at every point, which is mostly
+ * updateboard() and popgo(), and exercise_approxlib() counts the
+ * liberties of every string and of a stone of each color at every
+ * empty point. Both return the number of calls made.
+ *
+ * They work one level down the stack, like the reading code, where
+ * the string table is not checked against the board.
+ */
+
+int
+exercise_trymove(void)
+{
+  int calls = 0;
+  int i, j;
+  int color;
+
+  pushgo();
+  for (i = 0; i < board_size; i++)
+    for (j = 0; j < board_size; j++)
+      for (color = WHITE; color <= BLACK; color++) {
+	if (trymove(i, j, color, NULL, -1, -1))
+	  popgo();
+	calls++;
+      }
+  popgo();
+
+  return calls;
+}
+
+
+int
+exercise_approxlib(void)
+{
+  int calls = 0;
+  int i, j;
+
+  pushgo();
+  for (i = 0; i < board_size; i++)
+    for (j = 0; j < board_size; j++)
+      if (p[i][j] != EMPTY) {
+	approxlib(i, j, p[i][j], MAXLIBS);
+	calls++;
+      }
+      else {
+	approxlib(i, j, WHITE, MAXLIBS);
+	approxlib(i, j, BLACK, MAXLIBS);
+	calls += 2;
+      }
+  popgo();
+
+  return calls;
+}
+
+
 /* count (minimum) liberty of color piece at m, n
  * m,n may contain either that color, or be empty, in which
  * case we get what the liberties would be if we were to place
@@ -822,11 +904,12 @@ init_board()
  * if/when we reach that number. (We may still return a larger
  * number if we feel like it. (The current implementation doesn't.))
  *
- * Note that countlib(i,j,c) is defined as approxlib(i,j,c,99999)
+ * Use fastlib() or countlib() instead if libi[] and libj[] are not
+ * needed.
  */
 
-static char approxlib_ml[MAX_BOARD][MAX_BOARD];
-static char approxlib_mark = -1;
+static ENGINE_LOCAL char approxlib_ml[BOARDMAX];
+static ENGINE_LOCAL char approxlib_mark = -1;
 
 static void
 init_approxlib(void)
@@ -886,9 +969,9 @@ approxlib(int m,     /* row number 0 to board_size-1 */
 
   ENTRY : mark is the current value of "mark"
   
-          mx[][] contains "mark" for stones and empty intersections that
+          mx[] contains "mark" for stones and empty intersections that
 	  may not be counted. Typically "mark" is a value that at calling
-	  time is absent from mx[][].
+	  time is absent from mx[]. It is indexed like board[].
 
           maxlib : typically, it is not necessary to get the
           exact number of liberties : we can stop when it
@@ -902,126 +985,103 @@ approxlib(int m,     /* row number 0 to board_size-1 */
   
           return group size in global "size"
 
-          updates mx[][], putting "mark" at all stones and empty
+          updates mx[], putting "mark" at all stones and empty
 	  intersections visited
 
-	  EITHER : return < maxlib, and mx[][] and l[][] fully updated
-	  OR     : return == maxlib, and mx[][] and l[][] partially updated
+	  EITHER : return < maxlib, and mx[] and l[][] fully updated
+	  OR     : return == maxlib, and mx[] and l[][] partially updated
 
   NOTE : intended as an internal helper for approxlib, but
          is exported as a general (though complex) function
          for efficiency.
 */
 
-static int count_stacki[MAXCHAIN];
-static int count_stackj[MAXCHAIN];
+static ENGINE_LOCAL int count_stack[MAXCHAIN];
 
 int 
 count(int i,     /* row number 0 to board_size-1 */
       int j,     /* column number 0 to board_size-1 */
       int color, /* BLACK or WHITE */
-      char mx[MAX_BOARD][MAX_BOARD],  /* workspace : mx[][]=0 means stone already visited */
+      char mx[BOARDMAX],  /* workspace : mx[]=mark means already visited */
       int maxlib,       /* often, we only care if liberties > some minimum (usually 1) */
       char mark) /* Value to mark visited points with. */
 {
   int count_stackp;
-  
-  mx[i][j] = mark;
-  count_stacki[0] = i;
-  count_stackj[0] = j;
+  int pos;
+  int c;
+
+  /* The border of board[] is neither EMPTY nor color, which stops
+   * the search without checking the coordinates.
+   */
+  if (stackp == 0)
+    strings_sync();
+
+  pos = POS(i, j);
+  mx[pos] = mark;
+  count_stack[0] = pos;
   count_stackp = 1;
   size = 0;
   lib = 0;
+
+#define LIBERTY(point) \
+  do { \
+    libi[lib] = I(point); \
+    libj[lib] = J(point); \
+    ++lib; \
+    if (lib == maxlib) \
+      return lib; \
+  } while (0)
   
   while (count_stackp>0) {
     count_stackp--;
-    i = count_stacki[count_stackp];
-    j = count_stackj[count_stackp];
+    pos = count_stack[count_stackp];
     size++;
 
     /* check West neighbor */
-    if (j != 0 && mx[i][j-1] != mark)
-    {
-      if (p[i][j-1] == EMPTY)
-      {
-	mx[i][j-1] = mark;
-	libi[lib] = i;
-	libj[lib] = j-1;
-	++lib;
-	if (lib == maxlib)
-	  return lib;
-      }
-      else if (p[i][j-1] == color) {
-	mx[i][j-1] = mark;
-	count_stacki[count_stackp] = i;
-	count_stackj[count_stackp] = j-1;
-	count_stackp++;
-      }
+    c = board[pos-WE];
+    if ((c == EMPTY || c == color) && mx[pos-WE] != mark) {
+      mx[pos-WE] = mark;
+      if (c == EMPTY)
+	LIBERTY(pos-WE);
+      else
+	count_stack[count_stackp++] = pos-WE;
     }
     
     while(1) {
       /* check North neighbor */
-      if (i != 0 && mx[i-1][j] != mark)
-      {
-	if (p[i-1][j] == EMPTY)
-	{
-	  mx[i-1][j] = mark;
-	  libi[lib] = i-1;
-	  libj[lib] = j;
-	  ++lib;
-	  if (lib == maxlib)
-	    return lib;
-	} 
-	else if (p[i-1][j] == color) {
-	  mx[i-1][j] = mark;
-	  count_stacki[count_stackp] = i-1;
-	  count_stackj[count_stackp] = j;
-	  count_stackp++;
-	}
+      c = board[pos-NS];
+      if ((c == EMPTY || c == color) && mx[pos-NS] != mark) {
+	mx[pos-NS] = mark;
+	if (c == EMPTY)
+	  LIBERTY(pos-NS);
+	else
+	  count_stack[count_stackp++] = pos-NS;
       }
 
       /* check South neighbor */
-      if (i != board_size-1 && mx[i+1][j] != mark)
-      {
-	if (p[i+1][j] == EMPTY) 
-	{
-	  mx[i+1][j] = mark;
-	  libi[lib] = i+1;
-	  libj[lib] = j;
-	  ++lib;
-	  if (lib == maxlib)
-	    return lib;
-	}
-	else if (p[i+1][j] == color) {
-	  mx[i+1][j] = mark;
-	  count_stacki[count_stackp] = i+1;
-	  count_stackj[count_stackp] = j;
-	  count_stackp++;
-	}
+      c = board[pos+NS];
+      if ((c == EMPTY || c == color) && mx[pos+NS] != mark) {
+	mx[pos+NS] = mark;
+	if (c == EMPTY)
+	  LIBERTY(pos+NS);
+	else
+	  count_stack[count_stackp++] = pos+NS;
       }
 
       /* check East neighbor */
-      if (j == board_size-1 || mx[i][j+1] == mark)
+      c = board[pos+WE];
+      if ((c != EMPTY && c != color) || mx[pos+WE] == mark)
 	break;
-      if (p[i][j+1] == EMPTY)
-      {
-	mx[i][j+1] = mark;
-	libi[lib] = i;
-	libj[lib] = j+1;
-	++lib;
-	if (lib == maxlib)
-	  return lib;
+      mx[pos+WE] = mark;
+      if (c == EMPTY) {
+	LIBERTY(pos+WE);
 	break;
       }
-      else if (p[i][j+1] == color) {
-	mx[i][j+1] = mark;
-	size++;
-	j++;
-      }
-      else
-	break;
+      size++;
+      pos += WE;
     }
   }
+#undef LIBERTY
 
   return lib;
 }  /* end count */
@@ -1033,86 +1093,22 @@ count(int i,     /* row number 0 to board_size-1 */
  * The idea is to have a canonical reference point for a string.
  */
 
-static int origin_stacki[MAXCHAIN];
-static int origin_stackj[MAXCHAIN];
-static char origin_mx[MAX_BOARD][MAX_BOARD];
-static char origin_mark = -1;
-
 void 
 find_origin(int i, int j, int *origini, int *originj)
 {
-  int origin_stackp;
-  int color = p[i][j];
+  Bitboard region;
+  Bitboard cavity;
 
-  origin_mark++;
-  if (origin_mark == 0) { /* We have wrapped around, reinitialize. */
-    memset(origin_mx, 0, sizeof(origin_mx));
-    origin_mark = 1;
+  /* The string table knows the origin of a worm. */
+  if (p[i][j] != EMPTY) {
+    string_origin(i, j, origini, originj);
+    return;
   }
-  
-  *origini = i;
-  *originj = j;
-  
-  origin_mx[i][j] = origin_mark;
-  origin_stacki[0] = i;
-  origin_stackj[0] = j;
-  origin_stackp = 1;
-  
-  while (origin_stackp>0) {
-    origin_stackp--;
-    i = origin_stacki[origin_stackp];
-    j = origin_stackj[origin_stackp];
-
-    /* Is this point a possible origin? */
-    if (i < *origini || (i == *origini && j < *originj)) {
-      *origini = i;
-      *originj = j;
-    }
-    
-    /* check West neighbor */
-    if (j != 0 && origin_mx[i][j-1] != origin_mark) {
-      if (p[i][j-1] == color) {
-	origin_mx[i][j-1] = origin_mark;
-	origin_stacki[origin_stackp] = i;
-	origin_stackj[origin_stackp] = j-1;
-	origin_stackp++;
-      }
-    }
-    
-    while(1) {
-      /* check North neighbor */
-      if (i != 0 && origin_mx[i-1][j] != origin_mark)
-      {
-	if (p[i-1][j] == color) {
-	  origin_mx[i-1][j] = origin_mark;
-	  origin_stacki[origin_stackp] = i-1;
-	  origin_stackj[origin_stackp] = j;
-	  origin_stackp++;
-	}
-      }
-
-      /* check South neighbor */
-      if (i != board_size-1 && origin_mx[i+1][j] != origin_mark)
-      {
-	if (p[i+1][j] == color) {
-	  origin_mx[i+1][j] = origin_mark;
-	  origin_stacki[origin_stackp] = i+1;
-	  origin_stackj[origin_stackp] = j;
-	  origin_stackp++;
-	}
-      }
 
-      /* check East neighbor */
-      if (j == board_size-1 || origin_mx[i][j+1] == origin_mark)
-	break;
-      if (p[i][j+1] == color) {
-	origin_mx[i][j+1] = origin_mark;
-	j++;
-      }
-      else
-	break;
-    }
-  }
+  /* The first point of a cavity is its origin. */
+  color_plane(EMPTY, &region);
+  bitboard_flood(&cavity, i, j, &region);
+  bitboard_points(&cavity, 1, origini, originj);
 }
 
 
@@ -1760,7 +1756,7 @@ is_ko(int i, int j, int color)
   if (i>0) {
     if (p[i-1][j] != other)
       return 0;
-    if (approxlib(i-1, j, other, 2)==1) {
+    if (fastlib(i-1, j, other, 2)==1) {
       if (!singleton(i-1, j))
 	return 0;
       captures++;
@@ -1770,7 +1766,7 @@ is_ko(int i, int j, int color)
   if (i<board_size-1) {
     if (p[i+1][j] != other)
       return 0;
-    if (approxlib(i+1, j, other, 2)==1) {
+    if (fastlib(i+1, j, other, 2)==1) {
       if (!singleton(i+1, j))
 	return 0;
       captures++;
@@ -1779,7 +1775,7 @@ is_ko(int i, int j, int color)
   if (j>0) {
     if (p[i][j-1] != other) 
       return 0;
-    if (approxlib(i, j-1, other, 2)==1) {
+    if (fastlib(i, j-1, other, 2)==1) {
       if (!singleton(i, j-1))
 	return 0;
       captures++;
@@ -1788,7 +1784,7 @@ is_ko(int i, int j, int color)
   if (j<board_size-1) {
     if (p[i][j+1] != other)
       return 0;
-    if (approxlib(i, j+1,other, 2)==1) {
+    if (fastlib(i, j+1,other, 2)==1) {
       if (!singleton(i, j+1))
 	return 0;
       captures++;
@@ -1856,6 +1852,21 @@ confirm_safety(int i, int j, int color, int value)
     }
   return issafe;
 }
+
+
+/* Wall clock time in seconds, at the best resolution available. */
+
+double
+gg_gettimeofday(void)
+{
+#ifdef HAVE_GETTIMEOFDAY
+  struct timeval tv;
+  gettimeofday(&tv,NULL);
+  return tv.tv_sec + 1.e-6*tv.tv_usec;
+#else
+  return time(NULL);
+#endif
+}
       
 		
     
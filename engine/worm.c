@@ -26,8 +26,7 @@
 #include <assert.h>
 #include "liberty.h"
 
-static void propagate_worm_recursive(int m, int n, 
-				     int mw[MAX_BOARD][MAX_BOARD]);
+static void propagate_worm_data(int m, int n, Bitboard *done);
 static int genus(int i, int j);
 static void markcomponent(int i, int j, int m, int n,
 			  int mg[MAX_BOARD][MAX_BOARD]);
@@ -43,6 +42,17 @@ static void ping_recurse(int i, int j, int *counter,
 			 int mr[MAX_BOARD][MAX_BOARD], int color);
 
 
+/* The attack and defense of a string, as read by read_worm(). */
+
+struct worm_reading {
+  int m, n;          /* origin of the string */
+  int attacki, attackj, attack_code;
+  int defendi, defendj, defend_code;
+};
+
+static void read_worm(int k, void *data);
+
+
 /* A STRING is a maximal connected set of stones of the same color, 
  * black or white. A WORM is the same thing as a string, except that
  * its color can be empty. An empty worm is called a CAVITY.
@@ -73,42 +83,56 @@ int
 make_worms(void)
 {
   int m,n; /* iterate over board */
-  int transferrable_distance_to_black[MAX_BOARD][MAX_BOARD];
-  int transferrable_distance_to_white[MAX_BOARD][MAX_BOARD];
   int board_not_empty=0;
 
-  /* Initialize distance_to_black[][], distance_to_white[][],
-   * strategic_distance_to_black[][], strategic_distance_to_white[][].
-   *
-   * transferrable_distance_to_black[][], and 
-   * transferrable_distance_to_white[][] are just temporary data. 
+  /* The distances are first computed on padded boards like board[],
+   * where the border is -1 and never matches, and then copied to
+   * distance_to_black[][] and so on. tdist_black[] and tdist_white[]
+   * are the transferrable distances, which are just temporary data.
    */
+  int dist_black[BOARDMAX];
+  int dist_white[BOARDMAX];
+  int sdist_black[BOARDMAX];
+  int sdist_white[BOARDMAX];
+  int tdist_black[BOARDMAX];
+  int tdist_white[BOARDMAX];
+  int pos;
+
+  if (stackp == 0)
+    strings_sync();
+
+  for (pos = 0; pos < BOARDMAX; pos++) {
+    dist_black[pos] = -1;
+    dist_white[pos] = -1;
+    sdist_black[pos] = -1;
+    sdist_white[pos] = -1;
+    tdist_black[pos] = -1;
+    tdist_white[pos] = -1;
+  }
+
   for (m=0;m<board_size;m++)
     for (n=0;n<board_size;n++) {
+      pos = POS(m, n);
       dragon[m][n].genus=0;
-      if (p[m][n] == BLACK) {
-	distance_to_black[m][n] = 0;
-	strategic_distance_to_black[m][n] = 0;
-	transferrable_distance_to_black[m][n] = 0;
-      } else {
-	distance_to_black[m][n] = -1;
-	strategic_distance_to_black[m][n] = -1;
-	transferrable_distance_to_black[m][n] = -1;
+      if (board[pos] == BLACK) {
+	dist_black[pos] = 0;
+	sdist_black[pos] = 0;
+	tdist_black[pos] = 0;
       }
-      if (p[m][n] == WHITE) {
-	distance_to_white[m][n] = 0;
-	strategic_distance_to_white[m][n] = 0;
-	transferrable_distance_to_white[m][n] = 0;
-      } else {
-	distance_to_white[m][n] = -1;
-	strategic_distance_to_white[m][n] = -1;
-	transferrable_distance_to_white[m][n] = -1;
+      if (board[pos] == WHITE) {
+	dist_white[pos] = 0;
+	sdist_white[pos] = 0;
+	tdist_white[pos] = 0;
       }
-      if (p[m][n]) 
+      if (board[pos]) 
 	board_not_empty=1;
     }
-  
-  /* Set rest of distance_to_black[][] and distance_to_white[][]. */
+
+#define NEXT_TO(d, pos, x) \
+  ((d)[(pos)-NS] == (x) || (d)[(pos)+NS] == (x) \
+   || (d)[(pos)-WE] == (x) || (d)[(pos)+WE] == (x))
+
+  /* Set rest of dist_black[] and dist_white[]. */
   {
     int c=0;
     int found_one=1;
@@ -117,34 +141,33 @@ make_worms(void)
       found_one=0;
       for (m=0;m<board_size;m++)
 	for (n=0;n<board_size;n++) {
-	  /* If empty and not already done and neighbour to a 
-	     finished intersection, set distance. */
-	  if (p[m][n] == EMPTY && distance_to_black[m][n] == -1)
-	    if ((m>0 && distance_to_black[m-1][n] == c-1) 
-		|| (m<board_size-1 && distance_to_black[m+1][n] == c-1) 
-		|| (n>0 && distance_to_black[m][n-1] == c-1) 
-		|| (n<board_size-1 && distance_to_black[m][n+1] == c-1)) 
-	    {
-	      found_one=1;
-	      distance_to_black[m][n]=c;
-	    }
+	  pos = POS(m, n);
+	  if (board[pos] != EMPTY)
+	    continue;
+
+	  /* If not already done and neighbour to a finished
+	     intersection, set distance. */
+	  if (dist_black[pos] == -1 && NEXT_TO(dist_black, pos, c-1)) {
+	    found_one=1;
+	    dist_black[pos]=c;
+	  }
 
-	  if (p[m][n] == EMPTY && distance_to_white[m][n] == -1)
-	    if ((m>0 && distance_to_white[m-1][n] == c-1)
-		|| (m<board_size-1 && distance_to_white[m+1][n] == c-1) 
-		|| (n>0 && distance_to_white[m][n-1] == c-1) 
-		|| (n<board_size-1 && distance_to_white[m][n+1] == c-1)) 
-	    {
-	      found_one=1;
-	      distance_to_white[m][n]=c;
-	    }
+	  if (dist_white[pos] == -1 && NEXT_TO(dist_white, pos, c-1)) {
+	    found_one=1;
+	    dist_white[pos]=c;
+	  }
 	}
     }
   }
-  
-  /* Set rest of strategic_distance_to_black[][] and 
-   * strategic_distance_to_white[][], using
-   * transferrable_distance_to_{black|white}[][] as temporary data. 
+
+  /* A transferrable distance is only passed on by a point which is
+   * not next to the other color.
+   */
+#define TRANSFER(t, s, pos, d, x) \
+  ((t)[(pos)+(d)] == (x) && (s)[(pos)+(d)] != 1)
+
+  /* Set rest of sdist_black[] and sdist_white[], using
+   * tdist_black[] and tdist_white[] as temporary data. 
    */
   {
     int c=0;
@@ -154,162 +177,117 @@ make_worms(void)
       found_one=0;
       for (m=0;m<board_size;m++)
 	for (n=0;n<board_size;n++) {
+	  pos = POS(m, n);
+	  if (board[pos] != EMPTY)
+	    continue;
 
-	  if (p[m][n] == EMPTY && strategic_distance_to_black[m][n] == -1)
-	    if ((m>0 && transferrable_distance_to_black[m-1][n] == c-1) 
-		|| (m<board_size-1 &&
-		    transferrable_distance_to_black[m+1][n] == c-1) 
-		|| (n>0 && transferrable_distance_to_black[m][n-1] == c-1) 
-		|| (n<board_size-1 &&
-		    transferrable_distance_to_black[m][n+1] == c-1)) 
-	    {
-	      found_one=1;
-	      strategic_distance_to_black[m][n]=c;
-	    }
+	  if (sdist_black[pos] == -1 && NEXT_TO(tdist_black, pos, c-1)) {
+	    found_one=1;
+	    sdist_black[pos]=c;
+	  }
 
-	  if (p[m][n] == EMPTY && transferrable_distance_to_black[m][n] == -1)
-	    if (   (m>0
-		    && transferrable_distance_to_black[m-1][n] == c-1 
-		    && strategic_distance_to_white[m-1][n] != 1) 
-		|| (m<board_size-1 
-		    && transferrable_distance_to_black[m+1][n] == c-1
-		    && strategic_distance_to_white[m+1][n] != 1) 
-		|| (n>0
-		    && transferrable_distance_to_black[m][n-1] == c-1
-		    && strategic_distance_to_white[m][n-1] != 1) 
-		|| (n<board_size-1 
-		    && transferrable_distance_to_black[m][n+1] == c-1 
-		    && strategic_distance_to_white[m][n+1] != 1)) 
-	    {
-	      found_one=1;
-	      transferrable_distance_to_black[m][n]=c;
-	    }
+	  if (tdist_black[pos] == -1
+	      && (TRANSFER(tdist_black, sdist_white, pos, -NS, c-1)
+		  || TRANSFER(tdist_black, sdist_white, pos, NS, c-1)
+		  || TRANSFER(tdist_black, sdist_white, pos, -WE, c-1)
+		  || TRANSFER(tdist_black, sdist_white, pos, WE, c-1))) {
+	    found_one=1;
+	    tdist_black[pos]=c;
+	  }
 
-	  if (p[m][n] == EMPTY && strategic_distance_to_white[m][n] == -1)
-	    if ((m>0 && transferrable_distance_to_white[m-1][n] == c-1) 
-		|| (m<board_size-1 
-		    && transferrable_distance_to_white[m+1][n] == c-1) 
-		|| (n>0 && transferrable_distance_to_white[m][n-1] == c-1) 
-		|| (n<board_size-1 
-		    && transferrable_distance_to_white[m][n+1] == c-1)) 
-	    {
-	      found_one=1;
-	      strategic_distance_to_white[m][n]=c;
-	    }
+	  if (sdist_white[pos] == -1 && NEXT_TO(tdist_white, pos, c-1)) {
+	    found_one=1;
+	    sdist_white[pos]=c;
+	  }
 
-	  if (p[m][n] == EMPTY && transferrable_distance_to_white[m][n] == -1)
-	    if ((m>0 
-		 && transferrable_distance_to_white[m-1][n] == c-1 
-		 && strategic_distance_to_black[m-1][n] != 1) 
-		|| (m<board_size-1 
-		    && transferrable_distance_to_white[m+1][n] == c-1
-		    && strategic_distance_to_black[m+1][n] != 1) 
-		|| (n>0 
-		    && transferrable_distance_to_white[m][n-1] == c-1
-		    && strategic_distance_to_black[m][n-1] != 1) 
-		|| (n<board_size-1 
-		    && transferrable_distance_to_white[m][n+1] == c-1 
-		    && strategic_distance_to_black[m][n+1] != 1)) 
-	    {
-	      found_one=1;
-	      transferrable_distance_to_white[m][n]=c;
-	    }
+	  if (tdist_white[pos] == -1
+	      && (TRANSFER(tdist_white, sdist_black, pos, -NS, c-1)
+		  || TRANSFER(tdist_white, sdist_black, pos, NS, c-1)
+		  || TRANSFER(tdist_white, sdist_black, pos, -WE, c-1)
+		  || TRANSFER(tdist_white, sdist_black, pos, WE, c-1))) {
+	    found_one=1;
+	    tdist_white[pos]=c;
+	  }
 	}
     }
   }
+#undef NEXT_TO
+#undef TRANSFER
+
+  for (m=0;m<board_size;m++)
+    for (n=0;n<board_size;n++) {
+      pos = POS(m, n);
+      distance_to_black[m][n] = dist_black[pos];
+      distance_to_white[m][n] = dist_white[pos];
+      strategic_distance_to_black[m][n] = sdist_black[pos];
+      strategic_distance_to_white[m][n] = sdist_white[pos];
+    }
   
   /* Initialize the worm data for each worm. */
   {
-    int mw[MAX_BOARD][MAX_BOARD];
-    memset(mw, 0, sizeof(mw));
+    Bitboard done;
+    bitboard_clear(&done);
     
     for (m=0;m<board_size;m++)
       for (n=0;n<board_size;n++)
-	if (!mw[m][n]) {
+	if (!BB_TEST(&done, m, n)) {
 	  worm[m][n].color=p[m][n];
 	  worm[m][n].origini=m;
 	  worm[m][n].originj=n;
 	  worm[m][n].ko=0;
 	  worm[m][n].inessential=0;
-	  propagate_worm_recursive(m, n, mw);
+	  propagate_worm_data(m, n, &done);
 	}
-  } /* scope of mw */
+  } /* scope of done */
 
   if (!board_not_empty)
     return (0);
 
-  for (m=0;m<board_size;m++)
-    for (n=0;n<board_size;n++) {
-      if ((worm[m][n].origini!=m) || (worm[m][n].originj!=n))
-	continue;
+  /* Read the attack and defense of every string. The readings are
+   * independent of each other and may be done by several threads
+   * (see threads.c).
+   */
+  {
+    struct worm_reading readings[MAX_BOARD*MAX_BOARD];
+    int num_readings = 0;
+    int done;
+    int k = 0;
+
+    for (m=0;m<board_size;m++)
+      for (n=0;n<board_size;n++)
+	if (p[m][n] != EMPTY
+	    && worm[m][n].origini == m && worm[m][n].originj == n) {
+	  readings[num_readings].m = m;
+	  readings[num_readings].n = n;
+	  num_readings++;
+	}
 
-      if (p[m][n] == EMPTY) {
+    done = parallel_reading(num_readings, read_worm, readings);
+
+    for (m=0;m<board_size;m++)
+      for (n=0;n<board_size;n++) {
+	if ((worm[m][n].origini!=m) || (worm[m][n].originj!=n))
+	  continue;
+
+	if (p[m][n] == EMPTY) {
 	  worm[m][n].color=find_border(m, n, NULL);
 	  worm[m][n].size=size;
 	} else {
-	  int ti,tj;
-	  int acode, dcode;
-	  TRACE ("considering attack and defense of %m\n", m, n);
-	  worm[m][n].attacki=-1;
-	  worm[m][n].defendi=-1;
-	  worm[m][n].liberties=countlib(m, n, p[m][n]);
+	  worm[m][n].liberties=approxlib(m, n, p[m][n], MAXLIBS);
 	  worm[m][n].size=size;
-	  worm[m][n].attack_code=0;
-	  worm[m][n].defend_code=0;
-	  acode=attack(m, n, &ti, &tj);
-	  if (acode) {
-	    TRACE ("worm at %m can be attacked at %m\n", m,n,ti,tj);
-	    worm[m][n].attacki = ti;
-	    worm[m][n].attackj = tj;
-	    worm[m][n].attack_code=acode;
-	    dcode=find_defense(m, n, &ti, &tj);
-	    if (dcode) {
-	      TRACE ("worm at %m can be defended at %m\n", m,n,ti,tj);
-	      worm[m][n].defendi = ti;
-	      worm[m][n].defendj = tj;
-	      worm[m][n].defend_code=dcode;
-	    } else {
-	      /* If the point of attack is not adjacent to the worm, 
-	       * it is possible that this is an overlooked point of
-	       * defense, so we try and see if it defends.
-	       */
-	      int ai = worm[m][n].attacki;
-	      int aj = worm[m][n].attackj;
-	      if (((ai == 0) 
-		   || (worm[ai-1][aj].origini != m)
-		   || (worm[ai-1][aj].originj != n))
-		  &&
-		  ((ai == board_size-1)
-		   || (worm[ai+1][aj].origini != m)
-		   || (worm[ai+1][aj].originj != n))
-		  &&
-		  ((aj == 0)
-		   || (worm[ai][aj-1].origini != m)
-		   || (worm[ai][aj-1].originj != n))
-		  &&
-		  ((aj == board_size-1)
-		   || (worm[ai][aj+1].origini != m)
-		   || (worm[ai][aj+1].originj != n)))
-		if (trymove(ai, aj, worm[m][n].color, "make_worms", -1, -1)) {
-		  acode=attack(m, n, NULL, NULL);
-		  if (acode != 1) {
-		    worm[m][n].defendi=ai;
-		    worm[m][n].defendj=aj;
-		    if (acode==0)
-		      worm[m][n].defend_code=1;
-		    else if (acode==2)
-		      worm[m][n].defend_code=3;
-		    else if (acode==3)
-		      worm[m][n].defend_code=2;
-		    TRACE ("worm at %m can be defended at %m\n", m,n,ai,aj);
-		  }	 
-		  popgo();
-		}
-	    }
-	  }
+	  if (!done)
+	    read_worm(k, readings);
+	  worm[m][n].attacki=readings[k].attacki;
+	  worm[m][n].attackj=readings[k].attackj;
+	  worm[m][n].attack_code=readings[k].attack_code;
+	  worm[m][n].defendi=readings[k].defendi;
+	  worm[m][n].defendj=readings[k].defendj;
+	  worm[m][n].defend_code=readings[k].defend_code;
+	  k++;
 	}
 	propagate_worm(m, n);
       }
+  }
   
   /* Find kos. Check carefully that the purported ko move doesn't actually
    * capture more than one stone.
@@ -862,53 +840,126 @@ worm[m][n].cutstone=0.
 }
 
 
+/*
+ * Read whether the string readings[k] can be attacked and defended.
+ * This is a reading job for parallel_reading() and must not change
+ * anything but readings[k].
+ */
+
+static void
+read_worm(int k, void *data)
+{
+  struct worm_reading *r = (struct worm_reading *) data + k;
+  int m = r->m;
+  int n = r->n;
+  int ti, tj;
+  int acode, dcode;
+
+  TRACE ("considering attack and defense of %m\n", m, n);
+  r->attacki=-1;
+  r->attackj=-1;
+  r->attack_code=0;
+  r->defendi=-1;
+  r->defendj=-1;
+  r->defend_code=0;
+  acode=iterative_attack(m, n, &ti, &tj, read_node_budget, read_time_budget);
+  if (acode) {
+    TRACE ("worm at %m can be attacked at %m\n", m,n,ti,tj);
+    r->attacki = ti;
+    r->attackj = tj;
+    r->attack_code=acode;
+    dcode=iterative_find_defense(m, n, &ti, &tj,
+				 read_node_budget, read_time_budget);
+    if (dcode) {
+      TRACE ("worm at %m can be defended at %m\n", m,n,ti,tj);
+      r->defendi = ti;
+      r->defendj = tj;
+      r->defend_code=dcode;
+    } else {
+      /* If the point of attack is not adjacent to the worm, 
+       * it is possible that this is an overlooked point of
+       * defense, so we try and see if it defends.
+       */
+      int ai = r->attacki;
+      int aj = r->attackj;
+      if (((ai == 0) 
+	   || (worm[ai-1][aj].origini != m)
+	   || (worm[ai-1][aj].originj != n))
+	  &&
+	  ((ai == board_size-1)
+	   || (worm[ai+1][aj].origini != m)
+	   || (worm[ai+1][aj].originj != n))
+	  &&
+	  ((aj == 0)
+	   || (worm[ai][aj-1].origini != m)
+	   || (worm[ai][aj-1].originj != n))
+	  &&
+	  ((aj == board_size-1)
+	   || (worm[ai][aj+1].origini != m)
+	   || (worm[ai][aj+1].originj != n)))
+	if (trymove(ai, aj, p[m][n], "make_worms", -1, -1)) {
+	  acode=attack(m, n, NULL, NULL);
+	  if (acode != 1) {
+	    r->defendi=ai;
+	    r->defendj=aj;
+	    if (acode==0)
+	      r->defend_code=1;
+	    else if (acode==2)
+	      r->defend_code=3;
+	    else if (acode==3)
+	      r->defend_code=2;
+	    TRACE ("worm at %m can be defended at %m\n", m,n,ai,aj);
+	  }	 
+	  popgo();
+	}
+    }
+  }
+}
+
+
 /* 
  * propagate_worm() takes the worm data at one stone and copies it to 
- * the remaining members of the worm.  It uses propagate_worm_recursive()
+ * the remaining members of the worm.  It uses propagate_worm_data()
  * to do the actual work.
  */
 
 void 
 propagate_worm(int m, int n)
 {
-  int mw[MAX_BOARD][MAX_BOARD];
+  Bitboard done;
   assert(stackp==0);
 
-  memset(mw, 0, sizeof(mw));
-  propagate_worm_recursive(m, n, mw);
+  bitboard_clear(&done);
+  propagate_worm_data(m, n, &done);
 }
 
 
-/* Recursive worker function called by propagate_worms() and make_worms(). 
+/* Worker function called by propagate_worms() and make_worms(). It
+ * flood fills the worm at (m, n) on the bitboard of its color, copies
+ * the worm data to each point and adds the worm to done.
  *
  * Even though we don't need to copy all the fields, it's probably
  * better to do a structure copy which should compile to a block copy.
  */
 
 static void 
-propagate_worm_recursive(int m, int n, int mw[MAX_BOARD][MAX_BOARD])
+propagate_worm_data(int m, int n, Bitboard *done)
 {
-  mw[m][n]=1;
-
-  if (m>0 && (!mw[m-1][n]) && (p[m-1][n]==p[m][n])) {
-    worm[m-1][n]=worm[m][n];
-    propagate_worm_recursive(m-1, n, mw);
-  }
-
-  if ((m<board_size-1) && (!mw[m+1][n]) && (p[m+1][n]==p[m][n])) {
-    worm[m+1][n]=worm[m][n];
-    propagate_worm_recursive(m+1, n, mw);
-  }
-
-  if ((n>0) && (!mw[m][n-1]) && (p[m][n-1]==p[m][n])) {
-    worm[m][n-1]=worm[m][n];
-    propagate_worm_recursive(m, n-1, mw);
-  }
-
-  if ((n<board_size-1) && (!mw[m][n+1]) && (p[m][n+1]==p[m][n])) {
-    worm[m][n+1]=worm[m][n];
-    propagate_worm_recursive(m, n+1, mw);
-  }
+  Bitboard region;
+  Bitboard points;
+  int pi[MAX_BOARD*MAX_BOARD];
+  int pj[MAX_BOARD*MAX_BOARD];
+  int size;
+  int k;
+
+  color_plane(p[m][n], &region);
+  bitboard_flood(&points, m, n, &region);
+  bitboard_or(done, &points);
+
+  size = bitboard_points(&points, MAX_BOARD*MAX_BOARD, pi, pj);
+  for (k = 0; k < size; k++)
+    if (pi[k] != m || pj[k] != n)
+      worm[pi[k]][pj[k]] = worm[m][n];
 }
 
 
@@ -0,0 +1,449 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *\
+ * This is GNU GO, a Go program. Contact gnugo@gnu.org, or see   *
+ * http://www.gnu.org/software/gnugo/ for more information.      *
+ *                                                               *
+ * Copyright 1999 and 2000 by the Free Software Foundation.      *
+ *                                                               *
+ * This program is free software; you can redistribute it and/or *
+ * modify it under the terms of the GNU General Public License   *
+ * as published by the Free Software Foundation - version 2.     *
+ *                                                               *
+ * This program is distributed in the hope that it will be       *
+ * useful, but WITHOUT ANY WARRANTY; without even the implied    *
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR       *
+ * PURPOSE.  See the GNU General Public License in file COPYING  *
+ * for more details.                                             *
+ *                                                               *
+ * You should have received a copy of the GNU General Public     *
+ * License along with this program; if not, write to the Free    *
+ * Software Foundation, Inc., 59 Temple Place - Suite 330,       *
+ * Boston, MA 02111, USA                                         *
+\* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+
+/*
+ * gnugo-bench: load each sgf file given on the command line, let
+ * genmove() play a few moves from the final position with a fixed
+ * random seed, and write the time spent in each phase of genmove()
+ * together with the reading and pattern matcher statistics as JSON
+ * on stdout. `make benchmark' runs it on the regression games and
+ * the fuseki files in patterns/. With --elements, it also times the
+ * element checkers of the pattern matcher against each other on the
+ * loaded positions.
+ */
+
+#ifndef _NO_PROTO
+#define _NO_PROTO
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#define BUILDING_GNUGO_ENGINE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "getopt.h"
+
+#include "interface.h"
+#include "sgf.h"
+#include "ttsgf_read.h"
+#include "sgfana.h"
+#include "liberty.h"
+#include "hash.h"
+
+
+#define DEFAULT_MOVES 10
+#define DEFAULT_SEED  1
+
+int memory = MEMORY;		/* Megabytes of memory used for hash table. */
+
+volatile int  time_to_die = 0;   /* set by signal handlers */
+
+
+/* Statistics summed over all moves, of one file or of the whole run. */
+
+struct bench_totals {
+  double moves;
+  double seconds;
+  double phase_time[NUM_PHASES];
+  double nodes;
+  double position_entered;
+  double position_hits;
+  double read_result_entered;
+  double read_result_hits;
+  double read_result_lookups;
+  double read_result_replaced;
+  double read_result_shallow;
+  double budget_moves;
+  double budget_cutoffs;
+  double matcher[NUM_MATCH_STAGES];
+  double safe_move_lookups[STATS_DEPTHS];
+  double safe_move_hits[STATS_DEPTHS];
+  double read_lookups[NUM_READ_ROUTINES];
+  double read_hits[NUM_READ_ROUTINES];
+};
+
+
+static void
+add_move_stats(struct bench_totals *sum)
+{
+  int k;
+
+  sum->nodes += stats.nodes;
+  sum->position_entered += stats.position_entered;
+  sum->position_hits += stats.position_hits;
+  sum->read_result_entered += stats.read_result_entered;
+  sum->read_result_hits += stats.read_result_hits;
+  sum->read_result_lookups += stats.read_result_lookups;
+  sum->read_result_replaced += stats.read_result_replaced;
+  sum->read_result_shallow += stats.read_result_shallow;
+  if (stats.budget_cutoffs > 0)
+    sum->budget_moves++;
+  sum->budget_cutoffs += stats.budget_cutoffs;
+  for (k = 0; k < NUM_PHASES; k++)
+    sum->phase_time[k] += stats.phase_time[k];
+  for (k = 0; k < NUM_MATCH_STAGES; k++)
+    sum->matcher[k] += stats.matcher[k];
+  for (k = 0; k < STATS_DEPTHS; k++) {
+    sum->safe_move_lookups[k] += stats.safe_move_lookups[k];
+    sum->safe_move_hits[k] += stats.safe_move_hits[k];
+  }
+  for (k = 0; k < NUM_READ_ROUTINES; k++) {
+    sum->read_lookups[k] += stats.read_lookups[k];
+    sum->read_hits[k] += stats.read_hits[k];
+  }
+}
+
+
+static void
+add_totals(struct bench_totals *sum, const struct bench_totals *t)
+{
+  int k;
+
+  sum->moves += t->moves;
+  sum->seconds += t->seconds;
+  sum->nodes += t->nodes;
+  sum->position_entered += t->position_entered;
+  sum->position_hits += t->position_hits;
+  sum->read_result_entered += t->read_result_entered;
+  sum->read_result_hits += t->read_result_hits;
+  sum->read_result_lookups += t->read_result_lookups;
+  sum->read_result_replaced += t->read_result_replaced;
+  sum->read_result_shallow += t->read_result_shallow;
+  sum->budget_moves += t->budget_moves;
+  sum->budget_cutoffs += t->budget_cutoffs;
+  for (k = 0; k < NUM_PHASES; k++)
+    sum->phase_time[k] += t->phase_time[k];
+  for (k = 0; k < NUM_MATCH_STAGES; k++)
+    sum->matcher[k] += t->matcher[k];
+  for (k = 0; k < STATS_DEPTHS; k++) {
+    sum->safe_move_lookups[k] += t->safe_move_lookups[k];
+    sum->safe_move_hits[k] += t->safe_move_hits[k];
+  }
+  for (k = 0; k < NUM_READ_ROUTINES; k++) {
+    sum->read_lookups[k] += t->read_lookups[k];
+    sum->read_hits[k] += t->read_hits[k];
+  }
+}
+
+
+/* The element checker micro-benchmark, summed over all files. */
+
+struct element_totals {
+  double seconds;
+  double checks;
+  double matches;
+};
+
+
+static void
+time_element_checkers(int rounds, struct element_totals *t)
+{
+  int k;
+
+  for (k = 0; k < NUM_ELEMENT_CHECKERS; k++) {
+    double seconds, checks, matches;
+
+    if (!element_checker_available(k))
+      continue;
+    time_element_checker(k, rounds, &seconds, &checks, &matches);
+    t[k].seconds += seconds;
+    t[k].checks += checks;
+    t[k].matches += matches;
+  }
+}
+
+
+/* Write s as a JSON string. */
+
+static void
+json_string(const char *s)
+{
+  putchar('"');
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\')
+      printf("\\%c", *s);
+    else if ((unsigned char) *s < ' ')
+      printf("\\u%04x", (unsigned char) *s);
+    else
+      putchar(*s);
+  }
+  putchar('"');
+}
+
+
+/* Write the members of a JSON object for the totals t, indented by
+ * indent spaces. The matcher counts are reported as the number of
+ * pattern rotations tried and rejected at each check, and the
+ * number finally accepted. The last check is made by the callback,
+ * which looks up the autohelper verdict in a cache. The calls of
+ * safe_move() are listed by stackp, the last entry counting all
+ * deeper ones.
+ */
+
+static void
+json_totals(const struct bench_totals *t, int indent)
+{
+  static const char *const rejects[NUM_MATCH_STAGES - 1] = {
+    "anchor", "grid", "edge", "elements", "callback"
+  };
+  int k;
+
+  printf("%*s\"moves\": %.0f,\n", indent, "", t->moves);
+  printf("%*s\"seconds\": %.6f,\n", indent, "", t->seconds);
+  printf("%*s\"phases\": {", indent, "");
+  for (k = 0; k < NUM_PHASES; k++)
+    printf("%s\n%*s  \"%s\": %.6f", k ? "," : "", indent, "",
+	   phase_name[k], t->phase_time[k]);
+  printf("\n%*s},\n", indent, "");
+  printf("%*s\"nodes\": %.0f,\n", indent, "", t->nodes);
+  printf("%*s\"nodes_per_second\": %.0f,\n", indent, "",
+	 t->seconds > 0 ? t->nodes / t->seconds : 0.0);
+  printf("%*s\"hash\": {\n", indent, "");
+  printf("%*s  \"lookups\": %.0f,\n", indent, "", t->read_result_lookups);
+  printf("%*s  \"hits\": %.0f,\n", indent, "", t->read_result_hits);
+  printf("%*s  \"hit_rate\": %.4f,\n", indent, "",
+	 t->read_result_lookups > 0
+	 ? t->read_result_hits / t->read_result_lookups : 0.0);
+  printf("%*s  \"position_hits\": %.0f,\n", indent, "", t->position_hits);
+  printf("%*s  \"positions_entered\": %.0f,\n", indent, "",
+	 t->position_entered);
+  printf("%*s  \"results_entered\": %.0f,\n", indent, "",
+	 t->read_result_entered);
+  printf("%*s  \"results_replaced\": %.0f,\n", indent, "",
+	 t->read_result_replaced);
+  printf("%*s  \"results_shallow\": %.0f,\n", indent, "",
+	 t->read_result_shallow);
+  printf("%*s  \"routines\": {", indent, "");
+  for (k = 0; k < NUM_READ_ROUTINES; k++)
+    printf("%s\n%*s    \"%s\": {\"lookups\": %.0f, \"hits\": %.0f}",
+	   k ? "," : "", indent, "", read_routine_name[k],
+	   t->read_lookups[k], t->read_hits[k]);
+  printf("\n%*s  }\n", indent, "");
+  printf("%*s},\n", indent, "");
+  printf("%*s\"budget\": {\"moves_used_up\": %.0f, \"cutoffs\": %.0f},\n",
+	 indent, "", t->budget_moves, t->budget_cutoffs);
+  printf("%*s\"safe_move\": [", indent, "");
+  for (k = 0; k < STATS_DEPTHS; k++)
+    printf("%s\n%*s  {\"stackp\": %d, \"lookups\": %.0f, \"hits\": %.0f}",
+	   k ? "," : "", indent, "", k, t->safe_move_lookups[k],
+	   t->safe_move_hits[k]);
+  printf("\n%*s],\n", indent, "");
+  printf("%*s\"matcher\": {\n", indent, "");
+  printf("%*s  \"tried\": %.0f,\n", indent, "", t->matcher[MATCH_TRIED]);
+  printf("%*s  \"rejected\": {", indent, "");
+  for (k = 0; k < NUM_MATCH_STAGES - 1; k++)
+    printf("%s\n%*s    \"%s\": %.0f", k ? "," : "", indent, "",
+	   rejects[k], t->matcher[k] - t->matcher[k+1]);
+  printf("\n%*s  },\n", indent, "");
+  printf("%*s  \"accepted\": %.0f\n", indent, "", t->matcher[MATCH_HELPER]);
+  printf("%*s}", indent, "");
+}
+
+
+/*
+ * Set up the position at the end of the main line of head, time the
+ * element checkers there if element_rounds > 0, then let genmove()
+ * play up to moves moves, stopping after two passes.
+ */
+
+static void
+bench_file(SGFNodeP head, int moves, int seed, int element_rounds,
+	   struct element_totals *elements, struct bench_totals *t)
+{
+  int pass = 0;
+  int color;
+  int i, j;
+  double t1, t2;
+
+  init_board();
+  init_ginfo();
+  set_seed(seed, 1);
+  clear_board(NULL);
+#if HASHING
+  hashtable_clear(movehash);
+#endif
+
+  sgf_root = head;
+  load_sgf_header(head);
+  color = load_sgf_file(head, NULL);
+  srand(seed);
+
+  if (element_rounds > 0)
+    time_element_checkers(element_rounds, elements);
+
+  memset(t, 0, sizeof(*t));
+  while (pass < 2 && --moves >= 0 && !time_to_die) {
+    t1 = gg_gettimeofday();
+    if (genmove(&i, &j, color) < 0)
+      ++pass;
+    else
+      pass = 0;
+    t2 = gg_gettimeofday();
+    updateboard(i, j, color);
+
+    t->moves++;
+    t->seconds += t2 - t1;
+    add_move_stats(t);
+    color = OTHER_COLOR(color);
+  }
+}
+
+
+static void
+show_usage(void)
+{
+  fprintf(stderr,
+"Usage: gnugo-bench [--moves num] [--seed num] [--memory megabytes]\n\
+                   [--elements rounds] [--ordering 0|1]\n\
+                   [--movenodes num] [--movetime ms] file.sgf...\n\
+\n\
+Plays num moves (default %d) with genmove() from the end of each game\n\
+and writes the time per phase, reading and pattern matcher statistics\n\
+as JSON on stdout. With --elements, each element checker of the pattern\n\
+matcher is first run rounds times on all patterns at every point of\n\
+each game's final position. --ordering 0 turns off the move ordering\n\
+of the reading code, to compare the reading nodes. --movenodes and\n\
+--movetime give each move a reading budget, and the moves which used\n\
+it up are counted.\n", DEFAULT_MOVES);
+}
+
+
+static struct option const long_options[] =
+{
+  {"moves",  required_argument, 0, 'n'},
+  {"seed",   required_argument, 0, 'r'},
+  {"memory", required_argument, 0, 'M'},
+  {"elements", required_argument, 0, 'e'},
+  {"ordering", required_argument, 0, 'o'},
+  {"movenodes", required_argument, 0, 'N'},
+  {"movetime", required_argument, 0, 'T'},
+  {"help",   no_argument,       0, 'h'},
+  {NULL, 0, NULL, 0}
+};
+
+
+int
+main(int argc, char *argv[])
+{
+  int moves = DEFAULT_MOVES;
+  int seed = DEFAULT_SEED;
+  int element_rounds = 0;
+  struct element_totals elements[NUM_ELEMENT_CHECKERS];
+  struct bench_totals total;
+  struct bench_totals *per_file;
+  int files;
+  int k;
+  int c;
+
+  while ((c = getopt_long(argc, argv, "n:r:M:e:o:N:T:h", long_options, NULL)) != EOF)
+    switch (c) {
+    case 'n': moves = atoi(optarg); break;
+    case 'r': seed = atoi(optarg); break;
+    case 'M': memory = atoi(optarg); break;
+    case 'e': element_rounds = atoi(optarg); break;
+    case 'o': move_ordering = atoi(optarg); break;
+    case 'N': move_node_budget = atoi(optarg); break;
+    case 'T': move_time_budget = atoi(optarg); break;
+    case 'h': show_usage(); return EXIT_SUCCESS;
+    default:  show_usage(); return EXIT_FAILURE;
+    }
+
+  files = argc - optind;
+  if (files <= 0) {
+    show_usage();
+    return EXIT_FAILURE;
+  }
+
+  hash_init();
+  init_board();
+  init_ginfo();
+  init_gopt();
+#if HASHING
+  movehash = hashtable_allocate(memory);
+#endif
+
+  per_file = malloc(files * sizeof(*per_file));
+  if (per_file == NULL) {
+    fprintf(stderr, "gnugo-bench: out of memory\n");
+    return EXIT_FAILURE;
+  }
+
+  memset(&total, 0, sizeof(total));
+  memset(elements, 0, sizeof(elements));
+  for (k = 0; k < files; k++) {
+    SGFNodeP head = readsgffile(argv[optind + k]);
+
+    if (head == NULL) {
+      fprintf(stderr, "Cannot open or parse '%s'\n", argv[optind + k]);
+      return EXIT_FAILURE;
+    }
+    bench_file(head, moves, seed, element_rounds, elements, &per_file[k]);
+    add_totals(&total, &per_file[k]);
+  }
+
+  printf("{\n");
+  printf("  \"seed\": %d,\n", seed);
+  printf("  \"moves_per_file\": %d,\n", moves);
+  printf("  \"move_ordering\": %d,\n", move_ordering);
+  printf("  \"move_node_budget\": %d,\n", move_node_budget);
+  printf("  \"move_time_budget\": %d,\n", move_time_budget);
+  if (element_rounds > 0) {
+    printf("  \"element_checkers\": {");
+    for (k = 0; k < NUM_ELEMENT_CHECKERS; k++) {
+      printf("%s\n    \"%s\": ", k ? "," : "", element_checker_name[k]);
+      if (!element_checker_available(k))
+	printf("null");
+      else
+	printf("{\"seconds\": %.6f, \"checks\": %.0f, \"matches\": %.0f}",
+	       elements[k].seconds, elements[k].checks, elements[k].matches);
+    }
+    printf("\n  },\n");
+  }
+  json_totals(&total, 2);
+  printf(",\n  \"files\": [");
+  for (k = 0; k < files; k++) {
+    printf("%s\n    {\n      \"file\": ", k ? "," : "");
+    json_string(argv[optind + k]);
+    printf(",\n");
+    json_totals(&per_file[k], 6);
+    printf("\n    }");
+  }
+  printf("\n  ]\n}\n");
+
+  free(per_file);
+  return EXIT_SUCCESS;
+}
+
+
+/*
+ * Local Variables:
+ * tab-width: 8
+ * c-basic-offset: 2
+ * End:
+ */
@@ -182,6 +182,17 @@ set_komi(float num)
 }
 
 
+	/* reading budget of each move, 0 for no limit */
+int 
+set_move_budget(int nodes, int msec)
+{
+  if(nodes<0 || msec<0) return 0;
+  move_node_budget = nodes;
+  move_time_budget = msec;
+  return 1;
+}
+
+
 	/* move number changing */
 int 
 get_movenumber()
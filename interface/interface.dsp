@@ -109,6 +109,10 @@ SOURCE=.\play_gtp.c
 # End Source File
 # Begin Source File
 
+SOURCE=.\play_batch.c
+# End Source File
+# Begin Source File
+
 SOURCE=.\play_solo.c
 # End Source File
 # Begin Source File
@@ -43,12 +43,14 @@ void play_ascii(char * filename);
 void play_ascii_emacs(char * filename);
 void play_gmp(void);
 void play_gtp(void);
+void play_batch(void);
 void play_solo(int);
 void play_test(struct SGFNode *, enum testmode);
 int load_sgf_file(struct SGFNode *, const char *untilstr);
 void load_sgf_header(struct SGFNode *);
 void load_and_analyze_sgf_file(struct SGFNode *, const char *untilstr, int benchmark);
 void load_and_score_sgf_file(struct SGFNode *, const char *untilstr);
+void board_benchmark(struct SGFNode *, const char *untilstr, int iterations);
 
 
 /* ---------------------------------------------------------------
@@ -61,6 +63,7 @@ int set_boardsize(int);
 int get_handicap(void);
 int set_handicap(int);
 int set_komi(float);
+int set_move_budget(int, int);
 int get_movenumber(void);
 int set_movenumber(int);
 int dec_movenumber(void);
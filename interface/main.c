@@ -79,8 +79,9 @@
 Usage : gnugo [-opts]\n\
 \n\
 Main Options:\n\
-       --mode <mode>     Force the playing mode ('ascii', 'test' or 'gmp').\n\
-                         Default is ASCII.\n\
+       --mode <mode>     Force the playing mode ('ascii', 'test', 'gmp'\n\
+                         or 'batch'). Default is ASCII.\n\
+                         'batch' analyzes the positions listed on stdin.\n\
                          If no terminal is detected GMP (Go Modem Protocol)\n\
                          will be assumed.\n\
        --quiet           Don't print copyright and other messages\n\
@@ -95,9 +96,16 @@ Options that affect strength (higher=stronger, slower):\n\
    -B, --backfill_depth [depth] deep reading cutoff (default %d)\n\
    -F, --fourlib_depth [depth]  deep reading cutoff (default %d)\n\
    -K, --ko_depth [depth]       deep reading cutoff (default %d)\n\
+       --readnodes num          read worms with increasing depth,\n\
+       --readtime ms            within this budget per string\n\
+       --movenodes num          reading nodes and ms allowed\n\
+       --movetime ms            for each move (default no limit)\n\
 \n\
-Option that affects speed (higher=faster, more memory usage):\n\
-   -M, --memory [megabytes]     hash memory (default %d)\n\n\
+Options that affect speed (higher=faster, more memory usage):\n\
+   -M, --memory [megabytes]     hash memory (default %d)\n\
+       --threads num            threads for reading (default 1)\n\
+       --ponder                 read ahead while the opponent thinks\n\
+       --ordering 0             no killer or history move ordering\n\n\
 Game Options: (--mode ascii)\n\
        --boardsize num   Set the board size to use (%d--%d)\n\
        --color <color>   Choose your color ('black' or 'white')\n\
@@ -145,10 +153,12 @@ Debugging Options:\n\
    -T, --printboard             colored display of dragons\n\
    -E                           colored display of eye spaces\n\
    -d, --debug [level]          debugging output (see liberty.h for bits)\n\
-   -H, --hash [level]		hash (see liberty.h for bits)\n\
+   -H, --hash [level]		hash (see liberty.h for bits, default adaptive)\n\
    -w, --worms                  worm debugging\n\
    -m, --moyo [level]           moyo debugging, show moyo board\n\
    -b, --benchmark num          benchmarking mode - can be used with -l\n\
+       --boardbench num         time num passes of the board code - can be\n\
+                                used with -l\n\
    -s, --stack                  stack trace (for debugging purposes)\n\n\
    -S, --statistics             print statistics (for debugging purposes)\n\n\
    -t, --trace                  verbose tracing (use twice or more to trace reading)\n\
@@ -176,6 +186,14 @@ enum {OPT_BOARDSIZE=1,
       OPT_ANALYZER_FILE,
       OPT_ANALYZE,
       OPT_HELPANALYZE,
+      OPT_THREADS,
+      OPT_BOARDBENCH,
+      OPT_READNODES,
+      OPT_READTIME,
+      OPT_MOVENODES,
+      OPT_MOVETIME,
+      OPT_ORDERING,
+      OPT_PONDER
 };
 
 /* names of playing modes */
@@ -192,7 +210,9 @@ enum mode {
   MODE_SOLO,
   MODE_TEST,
   MODE_GTP,
-  MODE_DECIDE_STRING
+  MODE_BATCH,
+  MODE_DECIDE_STRING,
+  MODE_BOARD_BENCHMARK
 };
 
 
@@ -234,9 +254,17 @@ static struct option const long_options[] =
   {"memory",         required_argument, 0, 'M'},
   {"hash",           required_argument, 0, 'H'},
 #endif
+  {"threads",        required_argument, 0, OPT_THREADS},
+  {"ponder",         no_argument,       0, OPT_PONDER},
   {"worms",          no_argument,       0, 'w'},
   {"moyo",           required_argument, 0, 'm'},
   {"benchmark",      required_argument, 0, 'b'},
+  {"boardbench",     required_argument, 0, OPT_BOARDBENCH},
+  {"readnodes",      required_argument, 0, OPT_READNODES},
+  {"readtime",       required_argument, 0, OPT_READTIME},
+  {"movenodes",      required_argument, 0, OPT_MOVENODES},
+  {"movetime",       required_argument, 0, OPT_MOVETIME},
+  {"ordering",       required_argument, 0, OPT_ORDERING},
   {"stack",          no_argument,       0, 's'},
   {"statistics",     no_argument,       0, 'S'},
   {"trace",          no_argument,       0, 't'},
@@ -251,6 +279,8 @@ static struct option const long_options[] =
 };
 
 int memory = MEMORY;		/* Megabytes of memory used for hash table. */
+int threads = 1;		/* Threads used for reading. */
+int ponder = 0;			/* Read ahead while the opponent thinks. */
 
 /* 
  * Cgoban sends us a sigterm when it wants us to die. But it doesn't
@@ -417,6 +447,10 @@ main(int argc, char *argv[])
 	 break;
 	 
        case 'b' : benchmark = atoi(optarg); playmode=MODE_SOLO; break;
+       case OPT_BOARDBENCH :
+	 benchmark = atoi(optarg);
+	 playmode = MODE_BOARD_BENCHMARK;
+	 break;
        case 'r' : seed = atoi(optarg); seed_specified=1; break;
        case 'p' : set_style(optarg); break;
        case 's' : showstack = 1; break;
@@ -427,12 +461,22 @@ main(int argc, char *argv[])
        case 'D' : depth=atoi(optarg); break;
 #if HASHING
        case 'M' : memory = strtol(optarg, NULL, 0); break;
-       case 'H' : hashflags = strtol(optarg, NULL, 0);  /* allows 0x... */ break;
+       case 'H' :
+	 hashflags = strtol(optarg, NULL, 0);  /* allows 0x... */
+	 adaptive_hashflags = 0;
+	 break;
 #endif
+       case OPT_THREADS : threads = strtol(optarg, NULL, 0); break;
+       case OPT_PONDER : ponder = 1; break;
        case 'E' : printboard=2; set_opt_display_board(1); break;
        case 'B' : backfill_depth=atoi(optarg); break;
        case 'F' : fourlib_depth=atoi(optarg); break;
        case 'K' : fourlib_depth=atoi(optarg); break;
+       case OPT_READNODES : read_node_budget = atoi(optarg); break;
+       case OPT_READTIME : read_time_budget = atoi(optarg); break;
+       case OPT_MOVENODES : move_node_budget = atoi(optarg); break;
+       case OPT_MOVETIME : move_time_budget = atoi(optarg); break;
+       case OPT_ORDERING : move_ordering = atoi(optarg); break;
        case 'L' : until = optarg;
 	 if (playmode == MODE_UNKNOWN)
 	   playmode = MODE_LOAD_AND_ANALYZE;
@@ -486,6 +530,7 @@ main(int argc, char *argv[])
 	 else if (strcmp(optarg,"gmp")==0) playmode = MODE_GMP;
 	 else if (strcmp(optarg,"gtp")==0) playmode = MODE_GTP;
 	 else if (strcmp(optarg,"test")==0) playmode = MODE_TEST;
+	 else if (strcmp(optarg,"batch")==0) playmode = MODE_BATCH;
 	 else {
 	   fprintf(stderr,"Invalid mode selection: %s\n",optarg);
 	   fprintf(stderr, "Try `gnugo --help' for more information.\n");
@@ -615,15 +660,15 @@ Done in init_board()
 #endif
 
 #if HASHING
-  {
-    float nodes;
-    
-    nodes = (float)( (memory * 1024 * 1024)
-	     / (sizeof(Hashnode) + sizeof(Read_result) * 1.4));
-    movehash = hashtable_new((int) (1.5 * nodes), (int)(nodes), (int)(nodes * 1.4) );
-  } 
+  movehash = hashtable_allocate(memory);
 #endif
 
+   if (threads > 1 && !start_reading_threads(threads, memory))
+     fprintf(stderr, "Warning: could not start %d threads for reading\n",
+	     threads);
+   if (ponder && !start_ponder_thread())
+     fprintf(stderr, "Warning: could not start a thread for pondering\n");
+
    /* clear some caches */
    clear_wind_cache();
    clear_safe_move_cache();
@@ -658,6 +703,9 @@ Done in init_board()
          sgfCreateHeaderNode(komi);
        play_gtp();
        break;
+     case MODE_BATCH:
+       play_batch();
+       break;
      case MODE_SOLO:
        if(!sgf_root)
          sgfCreateHeaderNode(komi);
@@ -697,6 +745,9 @@ Done in init_board()
        sgf_printboard(next);
      }
      break;
+   case MODE_BOARD_BENCHMARK:
+     board_benchmark(sgf_root, until, benchmark);
+     break;
    case MODE_DECIDE_STRING:
      {
        int m, n;
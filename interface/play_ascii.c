@@ -672,7 +672,7 @@ play_ascii(char *fname)
 	
       case SETDEPTH:
 	{
-	  extern int depth;	/* ugly hack */
+	  extern ENGINE_LOCAL int depth;	/* ugly hack */
 	  
 	  command += 6;
 	  if (sscanf(command, "%d", &num) != 1) {
@@ -0,0 +1,165 @@
+/* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * *\
+ * This is GNU GO, a Go program. Contact gnugo@gnu.org, or see   *
+ * http://www.gnu.org/software/gnugo/ for more information.      *
+ *                                                               *
+ * Copyright 1999 and 2000 by the Free Software Foundation.      *
+ *                                                               *
+ * This program is free software; you can redistribute it and/or *
+ * modify it under the terms of the GNU General Public License   *
+ * as published by the Free Software Foundation - version 2.     *
+ *                                                               *
+ * This program is distributed in the hope that it will be       *
+ * useful, but WITHOUT ANY WARRANTY; without even the implied    *
+ * warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR       *
+ * PURPOSE.  See the GNU General Public License in file COPYING  *
+ * for more details.                                             *
+ *                                                               *
+ * You should have received a copy of the GNU General Public     *
+ * License along with this program; if not, write to the Free    *
+ * Software Foundation, Inc., 59 Temple Place - Suite 330,       *
+ * Boston, MA 02111, USA                                         *
+\* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
+
+
+/*
+ * Batch mode.
+ *
+ * With --mode batch, GNU Go reads a list of positions from stdin,
+ * one per line: the name of an sgf file, optionally followed by a
+ * move as for --until. The position is loaded up to that move, or
+ * to the end of the main line, and genmove() is run on it. For each
+ * position one line is written to stdout:
+ *
+ *   file until color move value score seconds
+ *
+ * where move is the move generated or PASS, value is the value
+ * genmove() gave it, score is the estimate of evaluate_territory()
+ * in the form of final_score in GTP mode (e.g. B+3.5), and seconds
+ * is the time spent on genmove() and the estimate. A file which
+ * cannot be read gives the line "file until ? cannot open or parse".
+ *
+ * The positions are read by one process, so that the hash table,
+ * the reading threads and the patterns compiled by the first
+ * genmove() are set up only once. The hash table is cleared before
+ * each position, so that the result does not depend on the order
+ * of the list: it is what "gnugo -l file -L until" finds with the
+ * same options. An sgf file is only read again if the name differs
+ * from that on the line before.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#define BUILDING_GNUGO_ENGINE  /* to reset the hash table and caches */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "interface.h"
+#include "sgf.h"
+#include "ttsgf.h"
+#include "ttsgf_read.h"
+#include "sgfana.h"
+#include "liberty.h"
+
+
+#define BATCH_LINE 1024
+
+
+/* Set up an empty board as the command line leaves it, before
+ * loading the next position.
+ */
+
+static void
+batch_reset(float komi)
+{
+  clear_board(NULL);
+  hashdata_init(&hashdata);
+  init_moyo();
+  set_movenumber(0);
+  set_handicap(0);
+  set_komi(komi);
+#if HASHING
+  hashtable_clear(movehash);
+#endif
+}
+
+
+void
+play_batch(void)
+{
+  char line[BATCH_LINE];
+  char last_file[BATCH_LINE];
+  SGFNodeP head = NULL;
+  float komi = get_komi();
+
+  last_file[0] = 0;
+  while (!time_to_die && fgets(line, sizeof(line), stdin)) {
+    char *file = strtok(line, " \t\r\n");
+    char *until = strtok(NULL, " \t\r\n");
+    int color;
+    int i, j;
+    int val;
+    int white_points, black_points;
+    float score;
+    double t1, t2;
+
+    if (file == NULL || file[0] == '#')
+      continue;
+
+    if (head == NULL || strcmp(file, last_file) != 0) {
+      sgf_root = NULL;
+      sgfFreeNode(head);
+      head = readsgffile(file);
+      if (head == NULL) {
+	last_file[0] = 0;
+	printf("%s %s ? cannot open or parse\n", file, until ? until : "end");
+	fflush(stdout);
+	continue;
+      }
+      strcpy(last_file, file);
+    }
+
+    batch_reset(komi);
+    sgf_root = head;
+    load_sgf_header(head);
+    color = load_sgf_file(head, until);
+    srand(get_seed());
+
+    t1 = gg_gettimeofday();
+    val = genmove(&i, &j, color);
+    evaluate_territory(&white_points, &black_points);
+    t2 = gg_gettimeofday();
+    score = black_points - white_points - black_captured + white_captured
+	    - get_komi();
+
+    printf("%s %s %c ", file, until ? until : "end",
+	   color == WHITE ? 'W' : 'B');
+    if (val < 0)
+      printf("PASS");
+    else
+      printf("%c%d", 'A' + j + (j >= 8), board_size - i);
+    printf(" %d ", val);
+    if (score > 0)
+      printf("B+%.1f", score);
+    else if (score < 0)
+      printf("W+%.1f", -score);
+    else
+      printf("0");
+    printf(" %.3f\n", t2 - t1);
+    fflush(stdout);
+  }
+
+  sgf_root = NULL;
+  sgfFreeNode(head);
+}
+
+
+/*
+ * Local Variables:
+ * tab-width: 8
+ * c-basic-offset: 2
+ * End:
+ */
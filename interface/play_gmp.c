@@ -147,6 +147,13 @@ void play_gmp()
 	 sgf_close_file();
 	 return;
        }
+       if (message == gmp_move)
+         ponder_reply(i, j);
+       else if (message == gmp_pass)
+         ponder_reply(board_size, board_size);
+       else
+         stop_pondering();
+
        if (message==gmp_undo)
        {
            int movenumber=get_movenumber();
@@ -200,6 +207,8 @@ void play_gmp()
 	 TRACE("\nmy move: %m\n\n", i, j);
        }
 
+       /* read ahead while the opponent thinks */
+       start_pondering(umove);
      }
 
      who = OTHER_COLOR(who);
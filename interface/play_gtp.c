@@ -98,6 +98,7 @@ do_move(char *command, int *pass)
   }
   else {
     *pass = 0;
+    ponder_reply(i, j);
     inc_movenumber();
     updateboard(i, j, get_tomove());
     switch_tomove();
@@ -105,6 +106,22 @@ do_move(char *command, int *pass)
 }
 
 
+/* BLACK or WHITE for a GTP color, EMPTY if it is none. */
+static int
+gtp_color(const char *str)
+{
+  if (str == NULL)
+    return EMPTY;
+  if (strcmp(str, "b") == 0 || strcmp(str, "B") == 0
+      || strcmp(str, "black") == 0 || strcmp(str, "BLACK") == 0)
+    return BLACK;
+  if (strcmp(str, "w") == 0 || strcmp(str, "W") == 0
+      || strcmp(str, "white") == 0 || strcmp(str, "WHITE") == 0)
+    return WHITE;
+  return EMPTY;
+}
+
+
 /* --------------------------------------------------------------*/
 /* play a game as GTP client, fork from play_ascii                           */
 /* --------------------------------------------------------------*/
@@ -112,7 +129,8 @@ void
 play_gtp()
 {
   char *known_commands="\nboardsize\ngenmove\nhelp\nknown_command"
-  "\nkomi\nlist_commands\nname\nplay\nprotocol_version\nquit\nversion\nfinal_score\n";
+  "\nkomi\nlist_commands\nname\nplay\nprotocol_version\nquit\nversion\nfinal_score"
+  "\ngnugo-move_budget\ntime_settings\ntime_left\nkgs-time_settings\n";
 
 
   int pass = 0;  /* two passes and its over */
@@ -126,6 +144,9 @@ play_gtp()
 
   int setting = 1;
 
+  /* with kgs-time_settings byoyomi, time_left gives periods, not stones */
+  int byoyomi_periods = 0;
+
   while(!time_to_die)
   {
     /* read the line of input */
@@ -164,6 +185,13 @@ play_gtp()
     } else if (strcmp(command, "quit") == 0) {
       break;
     }
+
+    /* the engine is needed, unless the opponent's move was pondered;
+     * genmove waits for the answer itself, and the clock is not used
+     * while pondering */
+    if (strcmp(command, "play") != 0 && strcmp(command, "genmove") != 0
+        && strcmp(command, "time_left") != 0)
+      stop_pondering();
     
     // setting commands
     if (strcmp(command, "clear_board") == 0) {
@@ -183,6 +211,73 @@ play_gtp()
     	set_komi(komi);
       replyf("");
       continue;
+    } else if (strcmp(command, "time_settings") == 0) {
+      char *main_time = strtok(NULL, " \t\n");
+      char *byo_time = strtok(NULL, " \t\n");
+      char *byo_stones = strtok(NULL, " \t\n");
+      if (byo_stones == NULL) {
+        failf("Error: invalid time settings format.");
+        continue;
+      }
+      /* byo-yomi time without stones means no time limit */
+      if (atoi(byo_time) > 0 && atoi(byo_stones) == 0)
+        clock_settings(-1, 0, 0);
+      else
+        clock_settings(atoi(main_time), atoi(byo_time), atoi(byo_stones));
+      byoyomi_periods = 0;
+      replyf("");
+      continue;
+    } else if (strcmp(command, "kgs-time_settings") == 0) {
+      char *type = strtok(NULL, " \t\n");
+      char *main_time = strtok(NULL, " \t\n");
+      char *byo_time = strtok(NULL, " \t\n");
+      char *byo_count = strtok(NULL, " \t\n");
+      byoyomi_periods = 0;
+      if (type != NULL && strcmp(type, "none") == 0)
+        clock_settings(-1, 0, 0);
+      else if (type != NULL && strcmp(type, "absolute") == 0 
+               && main_time != NULL)
+        clock_settings(atoi(main_time), 0, 0);
+      else if (type != NULL && strcmp(type, "byoyomi") == 0
+               && byo_count != NULL) {
+        /* only plan with one period, the others are for emergencies */
+        clock_settings(atoi(main_time), atoi(byo_time), 1);
+        byoyomi_periods = 1;
+      }
+      else if (type != NULL && strcmp(type, "canadian") == 0
+               && byo_count != NULL)
+        clock_settings(atoi(main_time), atoi(byo_time), atoi(byo_count));
+      else {
+        failf("Error: invalid time settings format.");
+        continue;
+      }
+      replyf("");
+      continue;
+    } else if (strcmp(command, "time_left") == 0) {
+      int color = gtp_color(strtok(NULL, " \t\n"));
+      char *time_left = strtok(NULL, " \t\n");
+      char *stones = strtok(NULL, " \t\n");
+      if (color == EMPTY || stones == NULL) {
+        failf("Error: invalid time left format.");
+        continue;
+      }
+      if (byoyomi_periods && atoi(stones) > 0)
+        clock_time_left(color, atoi(time_left), 1);
+      else
+        clock_time_left(color, atoi(time_left), atoi(stones));
+      replyf("");
+      continue;
+    } else if (strcmp(command, "gnugo-move_budget") == 0) {
+      /* reading nodes and ms for each genmove, 0 for no limit */
+      char *nodes = strtok(NULL, " \t\n");
+      char *msec = strtok(NULL, " \t\n");
+      if (nodes == NULL || msec == NULL
+          || !set_move_budget(atoi(nodes), atoi(msec))) {
+        failf("Error: invalid move budget format.");
+        continue;
+      }
+      replyf("");
+      continue;
     } else if (strcmp(command, "boardsize") == 0) {
       if (!setting)
       {
@@ -240,6 +335,7 @@ play_gtp()
 
       if ((strcmp(str, "pass") == 0) || strcmp(str, "PASS") == 0){
         pass++;
+        ponder_reply(get_boardsize(), get_boardsize());
         updateboard(get_boardsize(), get_boardsize(), get_tomove());
         inc_movenumber();
         switch_tomove();
@@ -267,6 +363,7 @@ play_gtp()
       int i, j;
       int move_val;
       move_val = get_move(&i, &j, cur_color);
+      start_pondering(OTHER_COLOR(cur_color));
       if (move_val) {
         switch_tomove();
 
@@ -46,18 +46,6 @@
 #include "sgfana.h"
 #include "liberty.h"
 
-double gg_gettimeofday(void);
-
-double gg_gettimeofday(void)
-{
-#ifdef HAVE_GETTIMEOFDAY
-  struct timeval tv;
-  gettimeofday(&tv,NULL);
-  return tv.tv_sec + 1.e-6*tv.tv_usec;
-#else
-  return time(NULL);
-#endif
-}
 
 void play_solo(int moves)
 {
@@ -67,6 +55,7 @@ void play_solo(int moves)
   int mymove;
   double t1, t2;
   int benchmark = moves;
+  double nodes = 0;   /* reading nodes visited by genmove() */
   
   /* It tends not to be very imaginative in the opening,
    * so we scatter a few stones randomly to start with.
@@ -120,6 +109,7 @@ void play_solo(int moves)
   while (pass < 2 && --moves >= 0 && !time_to_die)
     {
       moval=genmove(&i, &j, who);
+      nodes += stats.nodes;
       updateboard(i,j,who);
       if (moval < 0) {
 	++pass;
@@ -145,6 +135,7 @@ void play_solo(int moves)
     printf("%.3f moves played\n", (double) (benchmark-moves));
   } else {
     printf("%.3f moves/sec\n", (benchmark-moves)/(t2-t1));
+    printf("%.0f nodes/sec\n", nodes/(t2-t1));
   }
   
 }
@@ -153,6 +144,45 @@ void play_solo(int moves)
 
 
 
+/*
+ * Time the board code on the position of the sgf file (if any),
+ * with --boardbench. Each iteration tries every move and counts the
+ * liberties at every point once, see exercise_trymove() and
+ * exercise_approxlib().
+ */
+
+void
+board_benchmark(SGFNodeP head, const char *untilstr, int iterations)
+{
+  double t1, t2, t3;
+  double moves = 0;
+  double libs = 0;
+  int k;
+
+  if (head) {
+    load_sgf_header(head);
+    load_sgf_file(head, untilstr);
+  }
+
+  t1 = gg_gettimeofday();
+  for (k = 0; k < iterations; k++)
+    moves += exercise_trymove();
+  t2 = gg_gettimeofday();
+  for (k = 0; k < iterations; k++)
+    libs += exercise_approxlib();
+  t3 = gg_gettimeofday();
+
+  printf("%.0f trymove/popgo\n", moves);
+  printf("%.0f approxlib\n", libs);
+  if (t2 > t1 && t3 > t2) {
+    printf("%.0f trymove/popgo per sec\n", moves/(t2-t1));
+    printf("%.0f approxlib per sec\n", libs/(t3-t2));
+  }
+}
+
+
+
+
 /* FIXME : this should be in a separate source file, but it
  * is easier to send diffs when there are no new source
  * files to add.
@@ -59,6 +59,9 @@ static void cut_connect_callback(int m, int n, int color,
       return;
   }
 
+  if (!pattern_constraint(m, n, color, pattern, ll))
+    return;
+
   if (pattern->helper) {
     if (!pattern->helper(pattern, ll, stari, starj, color))
       return;
@@ -194,7 +197,7 @@ find_cuts(void)
   for (m = 0; m < board_size; m++)
     for (n = 0; n < board_size; n++)
       if (p[m][n])
-	matchpat(m, n, cut_callback, p[m][n], 0, conn);
+	matchpat(m, n, cut_callback, p[m][n], 0, &conn_db);
 }
 
 /* Find explicit connection patterns and amalgamate the involved dragons. */
@@ -205,7 +208,7 @@ find_connections(void)
   for (m = 0; m < board_size; m++)
     for (n = 0; n < board_size; n++)
       if (p[m][n])
-	matchpat(m, n, conn_callback, p[m][n], 0, conn);
+	matchpat(m, n, conn_callback, p[m][n], 0, &conn_db);
 }
 
 
@@ -118,7 +118,7 @@ double_atari_helper (ARGS)
 
   if ((alib == 2) && (blib < 5))
     if (TRYMOVE(ti, tj, ccolor)) {
-      if (countlib(ai, aj, acolor) == 1) {
+      if (approxlib(ai, aj, acolor, MAXLIBS) == 1) {
 	if (TRYMOVE(libi[0], libj[0], acolor)) {
 	  if (p[bi][bj] && attack(bi, bj, NULL, NULL)) {
 	    popgo();
@@ -136,7 +136,7 @@ double_atari_helper (ARGS)
 
   if ((blib == 2) && (alib < 5))
     if (TRYMOVE(ti, tj, ccolor)) {
-      if (countlib(bi, bj, acolor)==1) {
+      if (approxlib(bi, bj, acolor, MAXLIBS)==1) {
 	if (TRYMOVE(libi[0], libj[0], acolor)) {
 	  if (p[ai][aj] && attack(ai, aj, NULL, NULL)) {
 	    popgo();
@@ -1400,13 +1400,13 @@ peep_connect_helper (ARGS)
 
   if (TRYMOVE(ti, tj, other)) {
     if (TRYMOVE(bi, bj, color)) {
-      if (approxlib(ai, aj, other, 3) < 2)
+      if (fastlib(ai, aj, other, 3) < 2)
 	if (TRYMOVE(ci, cj, other)) {
 	  if (!p[ci][cj] || attack(ci, cj, NULL, NULL))
 	    tval=0;
 	  popgo();
 	}
-      if (approxlib(ci, cj, other, 3)<2)
+      if (fastlib(ci, cj, other, 3)<2)
 	if (TRYMOVE(ai, aj, other)) {
 	  if (attack(ai, aj, NULL, NULL))
 	    tval=0;
@@ -1606,13 +1606,13 @@ backfire_helper (ARGS)
   OFFSET(1, 0, ei, ej);
   OFFSET(-1, 1, fi, fj);
 
-  if (approxlib(ai, aj, color,2) == 1)
+  if (fastlib(ai, aj, color,2) == 1)
     return (0);
 
   if (TRYMOVE(ai, aj, color)) {
     if (TRYMOVE(bi, bj, other)) {
       if (attack(di, dj, NULL, NULL) && TRYMOVE(ci, cj, color)) {
-	if ((approxlib(ti, tj, other, 2) >1) && TRYMOVE(ti, tj, other)) {
+	if ((fastlib(ti, tj, other, 2) >1) && TRYMOVE(ti, tj, other)) {
 	  if (TRYMOVE(fi, fj, color)) {
 	    if (p[ei][ej] && attack(ei, ej, NULL, NULL))
 	      tval = COMPUTE_SCORE;
@@ -2331,7 +2331,7 @@ only_atari_helper (ARGS)
 	ci=libi[1];
 	cj=libj[1];
       }
-    if (approxlib(ci, cj, color, 2)==1)
+    if (fastlib(ci, cj, color, 2)==1)
       tval=min(COMPUTE_SCORE, worm[ai][aj].value);
   }
   return tval;
@@ -2697,7 +2697,7 @@ straight_connect_helper (ARGS)
 
     /* avoid pattern if X can't cut */
 
-    if (approxlib(ti, tj, other, 2)==1)
+    if (fastlib(ti, tj, other, 2)==1)
       return (0);
 
     if ((worm[ci][cj].color != other) && (worm[di][dj].color != other) &&
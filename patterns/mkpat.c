@@ -342,14 +342,16 @@ find_extents(void)
 
 
 /* For good performance, we want to reject patterns as quickly as
- * possible. For each pattern, this combines 16 positions around
- * the anchor stone into a 32-bit mask and value. In the matcher,
- * the same 4x4 grid is precomputed, and then we can quickly
- * test 16 board positions with one test.
+ * possible. For each pattern, this combines the 25 positions of
+ * a 5x5 grid centred on the anchor stone into a 64-bit mask and
+ * value. In the matcher, the same 5x5 grid is precomputed, and
+ * then we can quickly test 25 board positions with one test.
  * See matchpat.c for details of how this works - basically, if
  * we AND what is on the board with the and_mask, and get the
  * value in the val_mask, we have a match. This test can be
- * applied in parallel : 2 bits per posn x 16 posns = 32 bits.
+ * applied in parallel : 2 bits per posn x 25 posns = 50 bits.
+ * The point at offset (di,dj) from the anchor is at bit
+ * 24 - 10*di - 2*dj, so the top left corner has the highest bits.
  * "Don't care" has and_mask = val_mask = 0, which is handy !
  */
 
@@ -358,8 +360,8 @@ compute_grids(void)
 {
 #ifdef GRID_OPT
   /*                       element : .  X  O  x  o  h  a  ! */
-  static const uint32 and_mask[] = { 3, 3, 3, 1, 2, 1, 3, 1 };
-  static const uint32 val_mask[] = { 0, 2, 1, 0, 0, 0, 0, 0 };
+  static const uint64 and_mask[] = { 3, 3, 3, 1, 2, 1, 3, 1 };
+  static const uint64 val_mask[] = { 0, 2, 1, 0, 0, 0, 0, 0 };
 
   int ll;  /* iterate over rotations */
   int k;   /* iterate over elements */
@@ -369,13 +371,11 @@ compute_grids(void)
       int di, dj;
 
       TRANSFORM(elements[k].x - ci, elements[k].y - cj, &di, &dj, ll);
-      ++di;
-      ++dj;
-      if (di >= 0 && di < 4 && dj >= 0 && dj < 4) {
+      if (di >= -2 && di <= 2 && dj >= -2 && dj <= 2) {
 	pattern[patno].and_mask[ll]
-	  |= and_mask[elements[k].att] << (30 - di * 8 - dj * 2);
+	  |= and_mask[elements[k].att] << (24 - di * 10 - dj * 2);
 	pattern[patno].val_mask[ll]
-	  |= val_mask[elements[k].att] << (30 - di * 8 - dj * 2);
+	  |= val_mask[elements[k].att] << (24 - di * 10 - dj * 2);
       }
     }
   }
@@ -1076,6 +1076,20 @@ write_elements(char *name)
 	   elements[node].x - ci, elements[node].y - cj, elements[node].att,
 	   node < el-1 ? ",\n" : "};\n\n");
   }
+
+#if TREE_MATCHER
+  /* keep the elements, relative to the anchor, for write_tree() */
+  pattern[patno].patn = malloc(el * sizeof(struct patval));
+  if (pattern[patno].patn == NULL) {
+    fprintf(stderr, "mkpat: out of memory\n");
+    exit(EXIT_FAILURE);
+  }
+  for (node = 0; node < el; node++) {
+    pattern[patno].patn[node].x = elements[node].x - ci;
+    pattern[patno].patn[node].y = elements[node].y - cj;
+    pattern[patno].patn[node].att = elements[node].att;
+  }
+#endif
 }
 
 
@@ -1104,6 +1118,285 @@ compare_patterns(const void *a, const void *b)
 }
 
 
+/* Write the index of the patterns, which were written in the order
+ * given by indices. For each value of GRID_KEY() on the board, it
+ * lists the rotations whose grid is consistent with it, so that
+ * matchpat() need not look at the others. See patterns.h. The
+ * entries fit in an unsigned short since 8*MAXPATNO < 65536.
+ */
+
+static void
+write_index(char *name, int *indices)
+{
+  int key;
+  int i;
+  int ll;
+  int entries = 0;
+
+  printf("\nstatic const unsigned short %s_candidates[]={\n", name);
+  for (key = 0; key < GRID_KEYS; ++key) {
+    for (i = 0; i < patno; ++i) {
+      struct pattern *p = pattern + indices[i];
+
+      for (ll = 0; ll < p->trfno; ++ll)
+	if ((key & GRID_KEY(p->and_mask[ll])) == GRID_KEY(p->val_mask[ll])) {
+	  printf("%s%d", entries % 12 ? "," : entries ? ",\n  " : "  ",
+		 8*i + ll);
+	  ++entries;
+	}
+    }
+  }
+  printf("%s\n};\n\n", entries ? "" : "  0");
+
+  printf("struct pattern_index %s_index={\n  %s_candidates,\n  {",
+	 name, name);
+  entries = 0;
+  for (key = 0; key < GRID_KEYS; ++key) {
+    printf("%s%d", key % 12 ? "," : key ? ",\n   " : "", entries);
+    for (i = 0; i < patno; ++i) {
+      struct pattern *p = pattern + indices[i];
+
+      for (ll = 0; ll < p->trfno; ++ll)
+	if ((key & GRID_KEY(p->and_mask[ll])) == GRID_KEY(p->val_mask[ll]))
+	  ++entries;
+    }
+  }
+  printf(",%d}\n};\n\n", entries);
+
+#if TREE_MATCHER
+  printf("struct pattern_db %s_db={%s, &%s_index, &%s_tree, NULL};\n",
+	 name, name, name, name);
+#else
+  printf("struct pattern_db %s_db={%s, &%s_index, NULL, NULL};\n",
+	 name, name, name);
+#endif
+}
+
+
+#if TREE_MATCHER
+
+/* The decision tree of the database (see patterns.h) is built
+ * greedily. A set of rotations is split at the point where their
+ * elements rule out the most values, summed over the set, and the
+ * rotations which do not care about that point go to every child.
+ * A set becomes a leaf when it has at most TREE_LEAF rotations, when
+ * TREE_DEPTH points have been looked at, or when no point is left
+ * which rules out anything. The size of the tree is thus bounded by
+ * 4^TREE_DEPTH leaves, while the automaton which would test every
+ * element exactly once grows far too large for the full databases.
+ */
+
+#define TREE_DEPTH 6
+#define TREE_LEAF  32
+#define TREE_NODES ((1 << 2*TREE_DEPTH) / 3 + 1)
+#define TREE_LEAVES (1 << 2*TREE_DEPTH)
+#define TREE_SPAN  (2*MAX_BOARD - 1)  /* offsets are -MAX_BOARD+1 to MAX_BOARD-1 */
+
+/* one transformed element of a rotation: the values (as bits 1<<v)
+ * it allows at (di,dj)
+ */
+struct tree_element {
+  int di, dj;
+  int allowed;
+};
+
+static struct tree_element *tree_elements[8*MAXPATNO];
+static int tree_patlen[8*MAXPATNO];
+static int tree_tested[TREE_SPAN][TREE_SPAN];
+static struct pattern_tree_node tree_nodes[TREE_NODES];
+static int tree_node_count;
+static int tree_leaf_start[TREE_LEAVES + 1];
+static int tree_leaf_count;
+static int tree_entries;
+
+
+/* The values rotation c allows at (di,dj), or all four if it has
+ * no element there.
+ */
+
+static int
+tree_allowed(int c, int di, int dj)
+{
+  int k;
+
+  for (k = 0; k < tree_patlen[c]; ++k)
+    if (tree_elements[c][k].di == di && tree_elements[c][k].dj == dj)
+      return tree_elements[c][k].allowed;
+  return 0xf;
+}
+
+
+/* Order of the points when the gain of splitting is the same:
+ * closer to the anchor first.
+ */
+
+static int
+tree_closer(int di, int dj, int bi, int bj)
+{
+  int d1 = abs(di) > abs(dj) ? abs(di) : abs(dj);
+  int d2 = abs(bi) > abs(bj) ? abs(bi) : abs(bj);
+
+  if (d1 != d2)
+    return d1 < d2;
+  return abs(di) + abs(dj) < abs(bi) + abs(bj);
+}
+
+
+/* Build the tree for the n rotations in cand[] and return the child
+ * value of the root of it. The candidates of leaves are written out
+ * as we go.
+ */
+
+static int
+build_tree(int *cand, int n, int depth)
+{
+  static int gain[TREE_SPAN][TREE_SPAN];
+  int besti = 0, bestj = 0, bestgain = -1;
+  int node;
+  int *sub;
+  int c, k, v;
+  int di, dj;
+
+  if (n == 0)
+    return 0;
+
+  if (depth > 0 && (depth >= TREE_DEPTH || n <= TREE_LEAF))
+    goto leaf;
+
+  memset(gain, 0, sizeof(gain));
+  for (c = 0; c < n; ++c)
+    for (k = 0; k < tree_patlen[cand[c]]; ++k) {
+      struct tree_element *e = &tree_elements[cand[c]][k];
+      int ruled_out = 4;
+
+      for (v = 0; v < 4; ++v)
+	if (e->allowed & (1 << v))
+	  --ruled_out;
+      gain[e->di + MAX_BOARD-1][e->dj + MAX_BOARD-1] += ruled_out;
+    }
+
+  for (di = -MAX_BOARD+1; di < MAX_BOARD; ++di)
+    for (dj = -MAX_BOARD+1; dj < MAX_BOARD; ++dj) {
+      int g = gain[di + MAX_BOARD-1][dj + MAX_BOARD-1];
+
+      if (tree_tested[di + MAX_BOARD-1][dj + MAX_BOARD-1])
+	continue;
+      if (g > bestgain || (g == bestgain && tree_closer(di, dj, besti, bestj))) {
+	besti = di;
+	bestj = dj;
+	bestgain = g;
+      }
+    }
+
+  /* The root is always a node, so that matchpat() can start there. */
+  if (depth > 0 && bestgain <= 0)
+    goto leaf;
+
+  node = tree_node_count++;
+  assert(tree_node_count <= TREE_NODES);
+  tree_nodes[node].di = besti;
+  tree_nodes[node].dj = bestj;
+
+  sub = malloc(n * sizeof(int));
+  if (sub == NULL) {
+    fprintf(stderr, "mkpat: out of memory\n");
+    exit(EXIT_FAILURE);
+  }
+  tree_tested[besti + MAX_BOARD-1][bestj + MAX_BOARD-1] = 1;
+  for (v = 0; v < 4; ++v) {
+    int m = 0;
+
+    for (c = 0; c < n; ++c)
+      if (tree_allowed(cand[c], besti, bestj) & (1 << v))
+	sub[m++] = cand[c];
+    tree_nodes[node].child[v] = build_tree(sub, m, depth + 1);
+  }
+  tree_tested[besti + MAX_BOARD-1][bestj + MAX_BOARD-1] = 0;
+  free(sub);
+  return node;
+
+ leaf:
+  assert(tree_leaf_count < TREE_LEAVES);
+  tree_leaf_start[tree_leaf_count] = tree_entries;
+  for (c = 0; c < n; ++c, ++tree_entries)
+    printf("%s%d", tree_entries % 12 ? "," : tree_entries ? ",\n  " : "  ",
+	   cand[c]);
+  tree_leaf_start[++tree_leaf_count] = tree_entries;
+  return -tree_leaf_count;
+}
+
+
+/* Write the decision tree of the patterns, which were written in the
+ * order given by indices.
+ */
+
+static void
+write_tree(char *name, int *indices)
+{
+  /*                        element : .  X  O  x  o  h  a  ! */
+  static const int and_mask[] = { 3, 3, 3, 1, 2, 1, 3, 1 };
+  static const int val_mask[] = { 0, 2, 1, 0, 0, 0, 0, 0 };
+  static int cand[8*MAXPATNO];
+  int n = 0;
+  int i, k, ll, v;
+
+  for (i = 0; i < patno; ++i) {
+    struct pattern *p = pattern + indices[i];
+
+    for (ll = 0; ll < p->trfno; ++ll) {
+      int c = 8*i + ll;
+
+      tree_patlen[c] = p->patlen;
+      tree_elements[c] = malloc(p->patlen * sizeof(struct tree_element));
+      if (tree_elements[c] == NULL) {
+	fprintf(stderr, "mkpat: out of memory\n");
+	exit(EXIT_FAILURE);
+      }
+      for (k = 0; k < p->patlen; ++k) {
+	struct tree_element *e = &tree_elements[c][k];
+
+	TRANSFORM(p->patn[k].x, p->patn[k].y, &e->di, &e->dj, ll);
+	e->allowed = 0;
+	/* an element never matches off the board (value 3) */
+	for (v = 0; v < 3; ++v)
+	  if ((v & and_mask[p->patn[k].att]) == val_mask[p->patn[k].att])
+	    e->allowed |= 1 << v;
+      }
+      cand[n++] = c;
+    }
+  }
+
+  tree_node_count = 0;
+  tree_leaf_count = 0;
+  tree_entries = 0;
+  printf("\nstatic const unsigned short %s_tree_candidates[]={\n", name);
+  build_tree(cand, n, 0);
+  printf("%s\n};\n\n", tree_entries ? "" : "  0");
+
+  printf("static const int %s_tree_leaf_start[]={", name);
+  for (k = 0; k <= tree_leaf_count; ++k)
+    printf("%s%d", k % 12 ? "," : k ? ",\n  " : "\n  ", tree_leaf_start[k]);
+  printf("\n};\n\n");
+
+  printf("static const struct pattern_tree_node %s_tree_nodes[]={\n", name);
+  for (k = 0; k < tree_node_count; ++k)
+    printf("  {%d,%d,{%d,%d,%d,%d}}%s\n",
+	   tree_nodes[k].di, tree_nodes[k].dj,
+	   tree_nodes[k].child[0], tree_nodes[k].child[1],
+	   tree_nodes[k].child[2], tree_nodes[k].child[3],
+	   k < tree_node_count-1 ? "," : "");
+  printf("};\n\n");
+
+  printf("struct pattern_tree %s_tree={%s_tree_nodes, %s_tree_leaf_start, %s_tree_candidates};\n\n",
+	 name, name, name, name);
+
+  for (i = 0; i < n; ++i)
+    free(tree_elements[cand[i]]);
+}
+
+#endif /* TREE_MATCHER */
+
+
 /* sort and write out the patterns */
 static int
 write_patterns(char *name)
@@ -1151,10 +1444,12 @@ write_patterns(char *name)
       int ll;
 
       for (ll=0; ll<8; ++ll)
-	printf(" 0x%08x%s", p->and_mask[ll], ll<7 ? "," : "");
+	printf(" GRID(0x%05x,0x%08x)%s", (uint32) (p->and_mask[ll] >> 32),
+	       (uint32) p->and_mask[ll], ll<7 ? "," : "");
       printf("},\n    {");
       for (ll=0; ll<8; ++ll)
-	printf(" 0x%08x%s", p->val_mask[ll], ll<7 ? "," : "");
+	printf(" GRID(0x%05x,0x%08x)%s", (uint32) (p->val_mask[ll] >> 32),
+	       (uint32) p->val_mask[ll], ll<7 ? "," : "");
     }
     printf("}\n   ");
 #endif
@@ -1201,6 +1496,11 @@ write_patterns(char *name)
   }
 
   printf("  {NULL, 0,0,NULL,0,0,0,0,0,0,0,{0,0,0,0,0,0,0,0},{0,0,0,0,0,0,0,0},0,0,0,NULL,0,0,0,0,0,0,NULL,NULL,0}\n};\n");
+
+#if TREE_MATCHER
+  write_tree(name, indices);
+#endif
+  write_index(name, indices);
   return maxpat;
 }
 
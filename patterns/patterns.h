@@ -56,6 +56,16 @@ struct _unused_patterns_h {
   int unused[ sizeof(uint32) >= 4 ? 1 : -1];
 };
 
+/* a 64-bit unsigned int, for the grids of the matcher */
+#ifdef _MSC_VER
+typedef unsigned __int64 uint64;
+#else
+typedef unsigned long long uint64;
+#endif
+
+/* mkpat writes the grids in two halves, to avoid 64-bit constants */
+#define GRID(hi, lo)  (((uint64) (hi) << 32) | (uint64) (lo))
+
 /* transformation stuff */
 extern const int transformations[8][2][2];
 
@@ -151,7 +161,7 @@ struct pattern {
   int movei, movej;     /* position of the suggested move (relative to anchor) */
 
 #ifdef GRID_OPT
-  uint32 and_mask[8], val_mask[8];  /* for each rotation, masks for a 4x4 grid around anchor */
+  uint64 and_mask[8], val_mask[8];  /* for each rotation, masks for a 5x5 grid around anchor */
 #endif
 
   /* the following apply to patterns only, not half-eyes */
@@ -176,6 +186,78 @@ struct pattern {
 
 };
 
+/* The patterns are indexed by the anchor and its four neighbors in
+ * the 5x5 grid of each rotation (see compute_grids() in mkpat.c).
+ * GRID_KEY() collects these five points of a grid into a 10-bit
+ * number. A rotation can only match at a point if GRID_KEY() of the
+ * grid on the board there, anded with GRID_KEY() of its and_mask,
+ * gives GRID_KEY() of its val_mask.
+ */
+
+#define GRID_KEYS 1024
+
+#define GRID_KEY(grid) \
+  ((int) ((((grid) >> 22) & 0x03f) | (((grid) >> 8) & 0x0c0) \
+	  | (((grid) >> 26) & 0x300)))
+
+/* For each key, the rotations which can match there, as 8 times the
+ * number of the pattern plus the rotation, in the order matchpat()
+ * would try them in a scan of the whole array.
+ */
+
+struct pattern_index {
+  const unsigned short *candidates;
+  int start[GRID_KEYS + 1];  /* candidates of key k are start[k] to start[k+1]-1 */
+};
+
+/* With TREE_MATCHER, mkpat also writes a decision tree for the
+ * database. Each node looks at the board at offset (di,dj) from the
+ * anchor, coded 0 for empty, 1 for O, 2 for X and 3 for off the
+ * board, and goes on to child[value]. A positive child is another
+ * node, 0 means that no rotation can match, and -k-1 is leaf k. The
+ * candidates of leaf k, coded as in the index, are
+ * candidates[leaf_start[k]] to candidates[leaf_start[k+1]-1]. They
+ * include every rotation whose elements agree with the points
+ * looked at on the way, again in the order of the pattern array.
+ */
+
+struct pattern_tree_node {
+  int di, dj;
+  int child[4];
+};
+
+struct pattern_tree {
+  const struct pattern_tree_node *nodes;
+  const int *leaf_start;
+  const unsigned short *candidates;
+};
+
+/* One rotation of a pattern, transformed once and for all by
+ * compile_for_match() so that matchpat() need not use TRANSFORM().
+ * The elements are given as offsets in board[] from the anchor, in
+ * the order of the patn[] array, together with their attributes.
+ * Both arrays are padded to a multiple of 8 entries with elements
+ * at the anchor which match anything, for the vector checker.
+ */
+
+struct pattern_rotation {
+  int mini, minj;   /* top left and bottom right corner, */
+  int maxi, maxj;   /* relative to the anchor */
+  int movei, movej; /* the suggested move, relative to the anchor */
+  int *deltas;      /* offsets of the elements in board[] */
+  unsigned char *atts; /* attributes of the elements, the same for all rotations */
+};
+
+/* a pattern array with its index and tree, as written by mkpat */
+
+struct pattern_db {
+  struct pattern *patterns;
+  struct pattern_index *index;
+  struct pattern_tree *tree;  /* NULL unless TREE_MATCHER */
+  struct pattern_rotation *rotations;  /* 8 per pattern, see compile_for_match() */
+};
+
+
 int compute_score(int i,int j,int color,struct pattern *pat);
 int compute_score_sub(int i,int j,int color,struct pattern *pat,int *upower,int *mypower);
 
@@ -290,6 +372,8 @@ int seki_helper(int ai, int aj);
 /* pattern arrays themselves */
 extern struct pattern pat[];
 extern struct pattern conn[];
+extern struct pattern_db pat_db;
+extern struct pattern_db conn_db;
 
 /* not sure if this is the best way of doing this, but... */
 #define UNUSED(x)  x=x
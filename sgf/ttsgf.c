@@ -38,7 +38,7 @@
 #include "sgf_properties.h"
 #include "liberty.h"
 
-PUBLIC_VARIABLE int board_size;
+ENGINE_VARIABLE int board_size;
 
 
 SGFNodeP lastnode=0; /*last node where move was placed*/
@@ -89,6 +89,30 @@ sgfNewNode()
 }
 
 
+/*
+ * Free a node with its properties, its children and the nodes
+ * following it.
+ */
+
+void
+sgfFreeNode(SGFNodeP node)
+{
+  while (node) {
+    SGFNodeP next = node->next;
+    SGFPropertyP prop = node->prop;
+
+    while (prop) {
+      SGFPropertyP next_prop = prop->next;
+      free(prop);
+      prop = next_prop;
+    }
+    sgfFreeNode(node->child);
+    free(node);
+    node = next;
+  }
+}
+
+
 void
 sgfSetLastNode(SGFNodeP last_node)
 {
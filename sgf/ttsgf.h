@@ -77,6 +77,7 @@ struct SGFNode {
 SGFNodeP sgfPrev(SGFNodeP);
 SGFNodeP sgfRoot(SGFNodeP);
 SGFNodeP sgfNewNode(void);
+void sgfFreeNode(SGFNodeP);
 int sgfGetIntProperty(SGFNodeP n, const UCHAR_ALIAS *, int *);
 int sgfGetFloatProperty(SGFNodeP, const UCHAR_ALIAS *, float *);
 int sgfGetCharProperty(SGFNodeP, const UCHAR_ALIAS *, char **);